@@ -49,6 +49,34 @@ inline void concurrent_queue_stl_mut<T, ThreadModel, Allocator>::push(T element)
     }
 }
 
+template <typename T, typename ThreadModel, typename Allocator>
+inline bool concurrent_queue_stl_mut<T, ThreadModel, Allocator>::try_push(T& element) {
+    push(std::move(element));
+    return true;
+}
+
+
+template <typename T, typename ThreadModel, typename Allocator>
+template <typename Iterator>
+inline void concurrent_queue_stl_mut<T, ThreadModel, Allocator>::push(Iterator first, Iterator last) {
+    {
+        std::lock_guard<std::mutex> l(_qmut);
+
+        for (; first != last; ++first) {
+            _dek.push_back(std::move(*first));
+        }
+        _buffer_capacity = std::max<std::uint64_t>(_dek.size(), _buffer_capacity);
+        _qcond.notify_all();
+    }
+}
+
+template <typename T, typename ThreadModel, typename Allocator>
+template <typename Iterator>
+inline Iterator concurrent_queue_stl_mut<T, ThreadModel, Allocator>::try_push(Iterator first, Iterator last) {
+    push(first, last);
+    return last;
+}
+
 
 template <typename T, typename ThreadModel, typename Allocator>
 template <typename Duration>
@@ -87,7 +115,19 @@ inline optional<T> concurrent_queue_stl_mut<T, ThreadModel, Allocator>::try_pop(
 
 template <typename T, typename ThreadModel, typename Allocator>
 inline optional<T> concurrent_queue_stl_mut<T, ThreadModel, Allocator>::try_pop() {
-    return try_pop(std::chrono::milliseconds(0));
+    optional<T> res;
+
+    // non blocking version, do not touch the condition variable
+    std::lock_guard<decltype(_qmut)> l(_qmut);
+    if (!_dek.empty()) {
+        res = std::move(_dek.front());
+        _dek.pop_front();
+    } else if (_buffer_capacity > _small_allocation) {
+        decltype(_dek) tmp;
+        _dek.swap(tmp);
+        _buffer_capacity = 0;
+    }
+    return res;
 }
 
 
@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef HADOKEN_CONCURRENT_RING_QUEUE_BITS_HPP
+#define HADOKEN_CONCURRENT_RING_QUEUE_BITS_HPP
+
+#include <new>
+#include <thread>
+
+#include "../concurrent_ring_queue.hpp"
+
+namespace hadoken {
+
+
+template <typename T, std::size_t Capacity>
+inline concurrent_ring_queue<T, Capacity>::concurrent_ring_queue()
+    : _pad_front(), _enqueue_pos(0), _pad_enqueue(), _dequeue_pos(0), _pad_dequeue(), _cells(new cell[Capacity]) {
+    for (std::size_t i = 0; i < Capacity; ++i) {
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T, std::size_t Capacity>
+inline concurrent_ring_queue<T, Capacity>::~concurrent_ring_queue() {
+    while (try_pop()) {
+    }
+}
+
+
+template <typename T, std::size_t Capacity>
+inline bool concurrent_ring_queue<T, Capacity>::try_push(T& element) {
+    std::size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+    cell* c;
+
+    while (1) {
+        c = &_cells[pos & (Capacity - 1)];
+        const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+        const std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos);
+
+        if (diff == 0) {
+            if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // full
+            return false;
+        } else {
+            pos = _enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    new (&c->storage) T(std::move(element));
+    c->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+
+template <typename T, std::size_t Capacity>
+inline void concurrent_ring_queue<T, Capacity>::push(T element) {
+    std::uint64_t counter = 1;
+    while (try_push(element) == false) {
+        // full queue: wait for the consumers
+        if (counter % 128 == 0) {
+            std::this_thread::yield();
+        }
+        counter++;
+    }
+}
+
+
+template <typename T, std::size_t Capacity>
+template <typename Iterator>
+inline void concurrent_ring_queue<T, Capacity>::push(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+        push(std::move(*first));
+    }
+}
+
+
+template <typename T, std::size_t Capacity>
+template <typename Iterator>
+inline Iterator concurrent_ring_queue<T, Capacity>::try_push(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+        if (try_push(*first) == false) {
+            break;
+        }
+    }
+    return first;
+}
+
+
+template <typename T, std::size_t Capacity>
+inline optional<T> concurrent_ring_queue<T, Capacity>::try_pop() {
+    std::size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+    cell* c;
+
+    while (1) {
+        c = &_cells[pos & (Capacity - 1)];
+        const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+        const std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos + 1);
+
+        if (diff == 0) {
+            if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // empty
+            return empty_optional<T>();
+        } else {
+            pos = _dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    T* elem = reinterpret_cast<T*>(&c->storage);
+    optional<T> res(std::move(*elem));
+    elem->~T();
+    c->sequence.store(pos + Capacity, std::memory_order_release);
+    return res;
+}
+
+
+template <typename T, std::size_t Capacity>
+template <typename Duration>
+inline optional<T> concurrent_ring_queue<T, Capacity>::try_pop(const Duration& d) {
+    const auto deadline = std::chrono::steady_clock::now() + d;
+    std::uint64_t counter = 1;
+
+    // no condition variable to wait on: spin, then yield, then sleep until the deadline
+    while (1) {
+        optional<T> res = try_pop();
+        if (res || std::chrono::steady_clock::now() >= deadline) {
+            return res;
+        }
+
+        if (counter < 64) {
+            // spin
+        } else if (counter < 128) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        counter++;
+    }
+}
+
+
+template <typename T, std::size_t Capacity>
+inline bool concurrent_ring_queue<T, Capacity>::empty() const {
+    return size() == 0;
+}
+
+template <typename T, std::size_t Capacity>
+inline std::size_t concurrent_ring_queue<T, Capacity>::size() const {
+    const std::size_t dequeue_pos = _dequeue_pos.load(std::memory_order_relaxed);
+    const std::size_t enqueue_pos = _enqueue_pos.load(std::memory_order_relaxed);
+    return (enqueue_pos > dequeue_pos) ? (enqueue_pos - dequeue_pos) : 0;
+}
+
+
+} // namespace hadoken
+
+#endif // HADOKEN_CONCURRENT_RING_QUEUE_BITS_HPP
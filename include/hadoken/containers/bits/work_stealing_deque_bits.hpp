@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef HADOKEN_WORK_STEALING_DEQUE_BITS_HPP
+#define HADOKEN_WORK_STEALING_DEQUE_BITS_HPP
+
+#include "../work_stealing_deque.hpp"
+
+namespace hadoken {
+
+
+template <typename T>
+inline work_stealing_deque<T>::work_stealing_deque(std::size_t log_capacity)
+    : _top(0), _pad_top(), _bottom(0), _pad_bottom(), _array(new circular_array(log_capacity)), _garbage() {}
+
+template <typename T>
+inline work_stealing_deque<T>::~work_stealing_deque() {
+    delete _array.load(std::memory_order_relaxed);
+}
+
+
+template <typename T>
+inline void work_stealing_deque<T>::push(T element) {
+    const std::int64_t b = _bottom.load(std::memory_order_relaxed);
+    const std::int64_t t = _top.load(std::memory_order_acquire);
+    circular_array* a = _array.load(std::memory_order_relaxed);
+
+    if (b - t > std::int64_t(a->capacity()) - 1) {
+        circular_array* bigger = a->grow(b, t);
+        _garbage.emplace_back(a);
+        _array.store(bigger, std::memory_order_release);
+        a = bigger;
+    }
+
+    a->put(b, element);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+
+template <typename T>
+inline optional<T> work_stealing_deque<T>::pop() {
+    const std::int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+    circular_array* a = _array.load(std::memory_order_relaxed);
+    _bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = _top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        _bottom.store(b + 1, std::memory_order_relaxed);
+        return empty_optional<T>();
+    }
+
+    T elem = a->get(b);
+    if (t == b) {
+        // last element, compete with the thieves
+        const bool won = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+        if (won == false) {
+            return empty_optional<T>();
+        }
+    }
+    return optional<T>(std::move(elem));
+}
+
+
+template <typename T>
+inline optional<T> work_stealing_deque<T>::steal() {
+    std::int64_t t = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::int64_t b = _bottom.load(std::memory_order_acquire);
+
+    if (t < b) {
+        circular_array* a = _array.load(std::memory_order_acquire);
+        T elem = a->get(t);
+        if (_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return optional<T>(elem);
+        }
+    }
+    return empty_optional<T>();
+}
+
+
+template <typename T>
+inline bool work_stealing_deque<T>::empty() const {
+    return size() == 0;
+}
+
+
+template <typename T>
+inline std::size_t work_stealing_deque<T>::size() const {
+    const std::int64_t b = _bottom.load(std::memory_order_relaxed);
+    const std::int64_t t = _top.load(std::memory_order_relaxed);
+    return (b > t) ? std::size_t(b - t) : 0;
+}
+
+
+} // namespace hadoken
+
+#endif // HADOKEN_WORK_STEALING_DEQUE_BITS_HPP
@@ -46,10 +46,23 @@ namespace hadoken {
 template <typename T, typename ThreadModel = std_thread_model, typename Allocator = std::allocator<T>>
 class concurrent_queue_stl_mut {
   public:
+    using value_type = T;
+
     explicit concurrent_queue_stl_mut(const Allocator& allocator = Allocator());
 
     void push(T element);
 
+    /// unbounded queue: always succeed, element is moved from
+    bool try_push(T& element);
+
+    /// push a range of elements with a single lock acquisition
+    template <typename Iterator>
+    void push(Iterator first, Iterator last);
+
+    /// unbounded queue: push the whole range, return last
+    template <typename Iterator>
+    Iterator try_push(Iterator first, Iterator last);
+
 
     template <typename Duration>
     optional<T> try_pop(const Duration& d);
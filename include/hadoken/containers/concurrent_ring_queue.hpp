@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef HADOKEN_CONCURRENT_RING_QUEUE_HPP
+#define HADOKEN_CONCURRENT_RING_QUEUE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include <hadoken/utility/optional.hpp>
+
+namespace hadoken {
+
+///
+/// bounded lock-free multi-producer / multi-consumer queue
+///
+/// ring buffer where each slot carries a sequence number,
+/// producers and consumers claim slots with a single CAS
+/// ( "Bounded MPMC queue", D. Vyukov )
+///
+/// push() never allocates, Capacity must be a power of two
+///
+template <typename T, std::size_t Capacity = 4096>
+class concurrent_ring_queue {
+  public:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "concurrent_ring_queue Capacity must be a power of two");
+
+    using value_type = T;
+
+    concurrent_ring_queue();
+
+    ~concurrent_ring_queue();
+
+    /// push an element, wait for a free slot if the queue is full
+    void push(T element);
+
+    /// push an element if a slot is available, return false if the queue is full
+    ///
+    /// element is moved from only when the push succeeds: on failure it is left untouched
+    /// and the caller can still use it, e.g. execute a task inline
+    bool try_push(T& element);
+
+    /// push a range of elements, wait for free slots if the queue is full
+    template <typename Iterator>
+    void push(Iterator first, Iterator last);
+
+    /// push elements of the range while slots are available, return the first element not pushed
+    ///
+    /// only the pushed elements are moved from, [result, last) is left untouched
+    template <typename Iterator>
+    Iterator try_push(Iterator first, Iterator last);
+
+    template <typename Duration>
+    optional<T> try_pop(const Duration& d);
+
+    optional<T> try_pop();
+
+    bool empty() const;
+
+    std::size_t size() const;
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+  private:
+    concurrent_ring_queue(const concurrent_ring_queue&) = delete;
+    concurrent_ring_queue& operator=(const concurrent_ring_queue&) = delete;
+
+    struct cell {
+        std::atomic<std::size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    static constexpr std::size_t cache_line_size = 64;
+
+    // producers and consumers counters on separate cache lines
+    char _pad_front[cache_line_size];
+    std::atomic<std::size_t> _enqueue_pos;
+    char _pad_enqueue[cache_line_size - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> _dequeue_pos;
+    char _pad_dequeue[cache_line_size - sizeof(std::atomic<std::size_t>)];
+    std::unique_ptr<cell[]> _cells;
+};
+
+} // namespace hadoken
+
+
+#include "bits/concurrent_ring_queue_bits.hpp"
+
+#endif // HADOKEN_CONCURRENT_RING_QUEUE_HPP
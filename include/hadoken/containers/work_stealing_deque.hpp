@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef HADOKEN_WORK_STEALING_DEQUE_HPP
+#define HADOKEN_WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <hadoken/utility/optional.hpp>
+
+namespace hadoken {
+
+///
+/// \brief lock-free work stealing deque
+///
+/// Chase-Lev dynamic circular work stealing deque
+/// ( "Correct and Efficient Work-Stealing for Weak Memory Models", Le et al., PPoPP 2013 )
+///
+/// The owner thread push and pop at the bottom of the deque ( LIFO ),
+/// any other thread can steal at the top of the deque ( FIFO )
+///
+/// T must be trivially copyable, usually a pointer to a work item
+///
+template <typename T>
+class work_stealing_deque {
+  public:
+    static_assert(std::is_trivially_copyable<T>::value, "work_stealing_deque requires a trivially copyable type");
+
+    explicit work_stealing_deque(std::size_t log_capacity = 8);
+
+    ~work_stealing_deque();
+
+    /// push an element at the bottom, owner thread only
+    void push(T element);
+
+    /// pop an element from the bottom, owner thread only
+    optional<T> pop();
+
+    /// steal an element from the top, can be called by any thread
+    ///
+    /// return an empty optional if the deque is empty or if the steal
+    /// lost a race against an other thief or the owner
+    optional<T> steal();
+
+    bool empty() const;
+
+    std::size_t size() const;
+
+  private:
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    class circular_array {
+      public:
+        explicit inline circular_array(std::size_t log_capacity)
+            : _capacity(std::size_t(1) << log_capacity), _log_capacity(log_capacity),
+              _elems(new std::atomic<T>[std::size_t(1) << log_capacity]) {}
+
+        inline std::size_t capacity() const { return _capacity; }
+
+        inline T get(std::int64_t pos) const { return _elems[pos & (_capacity - 1)].load(std::memory_order_relaxed); }
+
+        inline void put(std::int64_t pos, T elem) { _elems[pos & (_capacity - 1)].store(elem, std::memory_order_relaxed); }
+
+        inline circular_array* grow(std::int64_t bottom, std::int64_t top) const {
+            circular_array* res = new circular_array(_log_capacity + 1);
+            for (std::int64_t i = top; i != bottom; ++i) {
+                res->put(i, get(i));
+            }
+            return res;
+        }
+
+      private:
+        std::size_t _capacity, _log_capacity;
+        std::unique_ptr<std::atomic<T>[]> _elems;
+    };
+
+    static constexpr std::size_t cache_line_size = 64;
+
+    // top is modified by the thieves, bottom by the owner: keep them on separate cache lines
+    std::atomic<std::int64_t> _top;
+    char _pad_top[cache_line_size - sizeof(std::atomic<std::int64_t>)];
+    std::atomic<std::int64_t> _bottom;
+    char _pad_bottom[cache_line_size - sizeof(std::atomic<std::int64_t>)];
+    std::atomic<circular_array*> _array;
+
+    // previous arrays can still be read by thieves after a resize
+    // they are released only at destruction time
+    std::vector<std::unique_ptr<circular_array>> _garbage;
+};
+
+} // namespace hadoken
+
+
+#include "bits/work_stealing_deque_bits.hpp"
+
+#endif // HADOKEN_WORK_STEALING_DEQUE_HPP
@@ -0,0 +1,367 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+//
+// opt-in C++20 coroutine support, the rest of hadoken stays C++11
+//
+#if __cplusplus < 202002L || !defined(__cpp_impl_coroutine)
+#error "hadoken/executor/coroutine.hpp requires C++20 coroutines"
+#endif
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include <hadoken/thread/future.hpp>
+
+
+namespace hadoken {
+
+
+namespace details {
+
+// resume a coroutine from an executor, fits in the small buffer of unique_task
+struct resume_handle {
+    inline void operator()() const { handle.resume(); }
+
+    std::coroutine_handle<> handle;
+};
+
+} // namespace details
+
+
+///
+/// \brief awaitable resuming the awaiting coroutine on exec
+///
+/// co_await schedule_on(pool) continues the coroutine in a task submitted with pool.execute(),
+/// no thread waits for the executor.
+///
+template <typename Executor>
+class schedule_awaitable {
+  public:
+    explicit inline schedule_awaitable(Executor& exec) noexcept : _exec(&exec) {}
+
+    inline bool await_ready() const noexcept { return false; }
+
+    inline void await_suspend(std::coroutine_handle<> handle) { _exec->execute(details::resume_handle{handle}); }
+
+    inline void await_resume() const noexcept {}
+
+  private:
+    Executor* _exec;
+};
+
+
+/// continue the awaiting coroutine on exec
+template <typename Executor>
+inline schedule_awaitable<Executor> schedule_on(Executor& exec) noexcept {
+    return schedule_awaitable<Executor>(exec);
+}
+
+
+template <typename T = void>
+class task;
+
+
+namespace details {
+
+
+// resume the awaiting coroutine when a task completes asynchronously, see task_promise_base
+struct task_final_awaiter {
+    inline bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+    inline void await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+        Promise& promise = handle.promise();
+        if (promise.arrived.exchange(true, std::memory_order_acq_rel)) {
+            promise.continuation.resume();
+        }
+    }
+
+    inline void await_resume() const noexcept {}
+};
+
+
+///
+/// the awaiting coroutine starts the task then tries to suspend, the task reaches
+/// its final suspension point: whoever arrives second continues the awaiting coroutine.
+/// A task completing synchronously never grows the stack, compilers do not
+/// always turn a symmetric transfer into a tail call
+///
+class task_promise_base {
+  public:
+    inline task_promise_base() noexcept : continuation(), arrived(false) {}
+
+    inline std::suspend_always initial_suspend() const noexcept { return {}; }
+
+    inline task_final_awaiter final_suspend() const noexcept { return {}; }
+
+    std::coroutine_handle<> continuation;
+    std::atomic<bool> arrived;
+};
+
+
+template <typename T>
+class task_promise : public task_promise_base {
+  public:
+    inline task<T> get_return_object() noexcept;
+
+    template <typename Value>
+    inline void return_value(Value&& v) {
+        _result.template emplace<1>(std::forward<Value>(v));
+    }
+
+    inline void unhandled_exception() noexcept { _result.template emplace<2>(std::current_exception()); }
+
+    inline T result() {
+        if (_result.index() == 2) {
+            std::rethrow_exception(std::get<2>(_result));
+        }
+        return std::move(std::get<1>(_result));
+    }
+
+  private:
+    std::variant<std::monostate, T, std::exception_ptr> _result;
+};
+
+
+template <>
+class task_promise<void> : public task_promise_base {
+  public:
+    inline task<void> get_return_object() noexcept;
+
+    inline void return_void() noexcept {}
+
+    inline void unhandled_exception() noexcept { _error = std::current_exception(); }
+
+    inline void result() {
+        if (_error) {
+            std::rethrow_exception(_error);
+        }
+    }
+
+  private:
+    std::exception_ptr _error;
+};
+
+
+} // namespace details
+
+
+///
+/// \brief lazy coroutine producing a T
+///
+/// the coroutine starts when awaited, in the awaiting thread. The awaiting coroutine continues
+/// in the thread completing the task, without suspension if the task completed synchronously.
+/// Combined with schedule_on, thousands of tasks share the threads of a pool without
+/// blocking any of them. Exceptions are rethrown to the awaiting coroutine.
+///
+/// start a task from a non-coroutine context with spawn() or sync_wait()
+///
+template <typename T>
+class task {
+  public:
+    using promise_type = details::task_promise<T>;
+    using value_type = T;
+
+    inline task() noexcept : _handle() {}
+
+    explicit inline task(std::coroutine_handle<promise_type> handle) noexcept : _handle(handle) {}
+
+    inline task(task&& other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+
+    inline task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    inline ~task() { reset(); }
+
+    /// true if the task refers to a coroutine
+    inline bool valid() const noexcept { return static_cast<bool>(_handle); }
+
+    /// true if the coroutine completed
+    inline bool done() const noexcept { return _handle && _handle.done(); }
+
+    inline auto operator co_await() noexcept {
+        struct awaiter {
+            inline bool await_ready() const noexcept { return !handle || handle.done(); }
+
+            inline bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                handle.resume();
+                return handle.promise().arrived.exchange(true, std::memory_order_acq_rel) == false;
+            }
+
+            inline T await_resume() {
+                if (!handle) {
+                    throw std::future_error(std::future_errc::no_state);
+                }
+                return handle.promise().result();
+            }
+
+            std::coroutine_handle<promise_type> handle;
+        };
+        return awaiter{_handle};
+    }
+
+  private:
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    inline void reset() {
+        if (_handle) {
+            _handle.destroy();
+            _handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> _handle;
+};
+
+
+namespace details {
+
+
+template <typename T>
+inline task<T> task_promise<T>::get_return_object() noexcept {
+    return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept {
+    return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+
+// eager coroutine destroying itself at completion
+struct detached_task {
+    struct promise_type {
+        inline detached_task get_return_object() const noexcept { return {}; }
+
+        inline std::suspend_never initial_suspend() const noexcept { return {}; }
+
+        inline std::suspend_never final_suspend() const noexcept { return {}; }
+
+        inline void return_void() const noexcept {}
+
+        inline void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+
+// the frame owns the task and the promise, the promise is set by the last statement
+template <typename T>
+inline detached_task run_task(task<T> t, promise<T> result) {
+    try {
+        if constexpr (std::is_void<T>::value) {
+            co_await t;
+            result.set_value();
+        } else {
+            result.set_value(co_await t);
+        }
+    } catch (...) {
+        result.set_exception(std::current_exception());
+    }
+}
+
+
+///
+/// awaiter of a hadoken::future, registered as a continuation on its shared state
+/// whoever of await_suspend and the completion comes second resumes the coroutine
+///
+template <typename T>
+class future_awaiter : public continuation_base {
+  public:
+    explicit inline future_awaiter(future<T>&& f) noexcept : _future(std::move(f)), _handle(), _arrived(false) {}
+
+    inline bool await_ready() const { return !_future.valid() || _future.is_ready(); }
+
+    inline bool await_suspend(std::coroutine_handle<> handle) {
+        _handle = handle;
+        future_access::state(_future)->add_continuation(this);
+        return _arrived.exchange(true, std::memory_order_acq_rel) == false;
+    }
+
+    inline T await_resume() { return _future.get(); }
+
+    inline void on_ready() override {
+        if (_arrived.exchange(true, std::memory_order_acq_rel)) {
+            _handle.resume();
+        }
+    }
+
+  private:
+    future<T> _future;
+    std::coroutine_handle<> _handle;
+    std::atomic<bool> _arrived;
+};
+
+
+} // namespace details
+
+
+///
+/// co_await on a hadoken::future, the coroutine is resumed in the thread completing the future
+///
+template <typename T>
+inline details::future_awaiter<T> operator co_await(future<T>&& f) noexcept {
+    return details::future_awaiter<T>(std::move(f));
+}
+
+
+///
+/// \brief start a task in the calling thread, return a future of its result
+///
+/// the calling thread runs the task until its first suspension point, a co_await schedule_on()
+/// moves the rest of the task to an executor
+///
+template <typename T>
+inline future<T> spawn(task<T> t) {
+    promise<T> result;
+    future<T> res = result.get_future();
+    details::run_task(std::move(t), std::move(result));
+    return res;
+}
+
+
+/// start a task and block the calling thread until its completion, return its result
+template <typename T>
+inline T sync_wait(task<T> t) {
+    return spawn(std::move(t)).get();
+}
+
+
+} // namespace hadoken
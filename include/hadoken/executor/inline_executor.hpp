@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+#include <hadoken/thread/future.hpp>
+
+
+namespace hadoken {
+
+
+///
+/// \brief Executor running every task in the calling thread
+///
+/// useful to force the serial execution of the parallel algorithms
+/// through an executor bound policy, or for debugging
+///
+class inline_executor {
+  public:
+    template <typename T>
+    using future = hadoken::future<T>;
+
+    template <typename T>
+    using promise = hadoken::promise<T>;
+
+    template <typename Function>
+    inline void execute(Function&& fun) {
+        fun();
+    }
+
+    template <typename Function>
+    inline future<typename details::task_result<Function>::type> twoway_execute(Function&& func) {
+        auto task = make_task(std::forward<Function>(func));
+        task.second();
+        return std::move(task.first);
+    }
+
+    template <typename Function>
+    inline future<void> bulk_execute(std::size_t n, Function&& fun) {
+        promise<void> prom;
+        future<void> res = prom.get_future();
+
+        try {
+            bulk_sync_execute(n, std::forward<Function>(fun));
+            prom.set_value();
+        } catch (...) {
+            prom.set_exception(std::current_exception());
+        }
+        return res;
+    }
+
+    template <typename Function>
+    inline void bulk_sync_execute(std::size_t n, Function&& fun) {
+        for (std::size_t i = 0; i < n; ++i) {
+            fun(i);
+        }
+    }
+
+    inline std::size_t size() const { return 1; }
+};
+
+
+} // namespace hadoken
@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <hadoken/executor/thread_pool_executor.hpp>
+#include <hadoken/os/topology.hpp>
+
+
+namespace hadoken {
+
+
+///
+/// \brief thread pool with one shard per NUMA node
+///
+/// each shard is a thread pool whose workers are pinned to the cpus of one node,
+/// see basic_thread_pool_executor::affinity
+///
+/// bulk executions are divided in contiguous ranges of indices, one per shard,
+/// proportional to the number of workers of the shards: a given index always runs
+/// on the same node. The parallel algorithms with static chunking, the default,
+/// process a given slice of a range on the same node at every call. The pages first
+/// touched by a parallel::fill are then read and written from their own node.
+///
+/// Single tasks go to the shard of the submitting worker, round robin on the shards otherwise
+///
+template <typename Queue>
+class basic_numa_thread_pool_executor : public std_thread_model, public details::thread_pool_options {
+  public:
+    using shard_type = basic_thread_pool_executor<Queue>;
+
+    template <typename T>
+    using future = hadoken::future<T>;
+
+    /// one shard per NUMA node of the machine, threads_per_node = 0: one worker per cpu of the node
+    explicit inline basic_numa_thread_pool_executor(scheduling mode = scheduling::shared_queue,
+                                                    affinity placement = affinity::cpu, std::size_t threads_per_node = 0)
+        : basic_numa_thread_pool_executor(get_numa_nodes(), mode, placement, threads_per_node) {}
+
+    /// one shard per given node
+    explicit inline basic_numa_thread_pool_executor(std::vector<numa_node> nodes, scheduling mode = scheduling::shared_queue,
+                                                    affinity placement = affinity::cpu, std::size_t threads_per_node = 0)
+        : _nodes(std::move(nodes)), _shards(), _next_shard(0) {
+        for (const numa_node& node : _nodes) {
+            _shards.emplace_back(new shard_type(threads_per_node, mode, placement, node.cpus));
+        }
+    }
+
+    template <typename Function>
+    inline void execute(Function&& fun) {
+        _shards[select_shard()]->execute(std::forward<Function>(fun));
+    }
+
+    template <typename Function>
+    inline future<typename details::task_result<Function>::type> twoway_execute(Function&& fun) {
+        return _shards[select_shard()]->twoway_execute(std::forward<Function>(fun));
+    }
+
+    ///
+    /// \brief execute fun(i) for each i in [0, n) and wait for the completion
+    ///
+    /// each shard executes a contiguous range of indices. A nested call from a
+    /// worker stays on the shard of the worker: a worker never blocks on another shard.
+    /// Rethrow the first exception thrown by fun
+    ///
+    template <typename Function>
+    inline void bulk_sync_execute(std::size_t n, Function&& fun) {
+        const std::size_t own_shard = current_shard();
+        if (own_shard < _shards.size()) {
+            _shards[own_shard]->bulk_sync_execute(n, std::forward<Function>(fun));
+            return;
+        }
+
+        const std::size_t n_workers = size();
+
+        std::vector<future<void>> results;
+        results.reserve(_shards.size());
+
+        std::size_t begin = 0, workers_before = 0;
+        for (std::size_t s = 0; s < _shards.size(); ++s) {
+            workers_before += _shards[s]->size();
+            const std::size_t end = n * workers_before / n_workers;
+            if (end > begin) {
+                results.push_back(_shards[s]->bulk_execute(end - begin, [&fun, begin](std::size_t i) { fun(begin + i); }));
+            }
+            begin = end;
+        }
+
+        // wait for all the shards before to report any error, fun is still in use
+        std::exception_ptr error;
+        for (auto& result : results) {
+            try {
+                result.get();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /// total number of workers
+    inline std::size_t size() const {
+        std::size_t n_workers = 0;
+        for (auto& shard : _shards) {
+            n_workers += shard->size();
+        }
+        return n_workers;
+    }
+
+    /// number of shards, one per node
+    inline std::size_t shards() const { return _shards.size(); }
+
+    inline shard_type& shard(std::size_t shard_id) { return *_shards[shard_id]; }
+
+    /// node of a shard
+    inline const numa_node& node(std::size_t shard_id) const { return _nodes[shard_id]; }
+
+    /// shard of the calling worker, shards() if the calling thread is not part of the pool
+    inline std::size_t current_shard() const {
+        std::size_t s = 0;
+        while (s < _shards.size() && _shards[s]->running_in_this_thread() == false) {
+            ++s;
+        }
+        return s;
+    }
+
+    /// block until all the submitted tasks completed, must not be called from a task running in this pool
+    inline void wait() {
+        for (auto& shard : _shards) {
+            shard->wait();
+        }
+    }
+
+  private:
+    inline std::size_t select_shard() {
+        const std::size_t own_shard = current_shard();
+        if (own_shard < _shards.size()) {
+            return own_shard;
+        }
+        return _next_shard.fetch_add(1, std::memory_order_relaxed) % _shards.size();
+    }
+
+    std::vector<numa_node> _nodes;
+    std::vector<std::unique_ptr<shard_type>> _shards;
+    std::atomic<std::size_t> _next_shard;
+};
+
+
+/// default NUMA thread pool, one mutex based shared queue per node
+using numa_thread_pool_executor = basic_numa_thread_pool_executor<concurrent_queue<unique_task>>;
+
+
+} // namespace hadoken
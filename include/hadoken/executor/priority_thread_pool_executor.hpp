@@ -0,0 +1,472 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include <hadoken/executor/thread_pool_executor.hpp>
+#include <hadoken/executor/unique_task.hpp>
+#include <hadoken/thread/eventcount.hpp>
+#include <hadoken/thread/future.hpp>
+#include <hadoken/threading/std_thread_model.hpp>
+
+
+namespace hadoken {
+
+
+///
+/// \brief occupancy of a lane of a priority_thread_pool_executor
+///
+struct lane_status {
+    /// tasks waiting in the lane
+    std::size_t queued;
+    /// tasks of the lane started since the creation of the pool
+    std::size_t executed;
+    /// waiting time of the oldest task of the lane, zero if the lane is empty
+    std::chrono::nanoseconds oldest_wait;
+};
+
+
+///
+/// \brief thread pool with priority lanes and an earliest deadline first lane
+///
+/// lane 0 has the highest priority. Workers drain the lanes by strict priority, with aging:
+/// the rank of a lane is its index + 1, minus one for each aging period waited by its oldest task.
+/// The lane of lowest rank is served first, the highest priority lane on a tie. A burst of
+/// background tasks can not starve the request path, and a task of the last lane waits at most
+/// about lanes() aging periods before it competes with new tasks of lane 0.
+///
+/// The optional deadline lane executes its tasks by earliest deadline first, it has rank 0:
+/// it comes before all the lanes that did not age.
+///
+/// execute() and twoway_execute() without lane submit to the last lane, the lowest priority.
+/// Like basic_thread_pool_executor, a twoway_execute from a worker runs inline,
+/// the pending tasks are executed before the pool is destroyed, and wait(), wait_for()
+/// and the complete_all_before_delete flag track the tasks in flight.
+///
+/// Lane occupancy is available without lock through status(), for monitoring and backlog alerts
+///
+class priority_thread_pool_executor : public std_thread_model, public details::thread_pool_options {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    template <typename T>
+    using future = hadoken::future<T>;
+
+    template <typename T>
+    using promise = hadoken::promise<T>;
+
+    ///
+    /// \param n_thread number of workers, one per hardware thread by default
+    /// \param n_lanes number of priority lanes, at least one
+    /// \param aging_period waiting time that raises the priority of a lane by one step
+    /// \param deadline_lane enable the earliest deadline first lane
+    ///
+    explicit inline priority_thread_pool_executor(std::size_t n_thread = 0, std::size_t n_lanes = 3,
+                                                  clock::duration aging_period = std::chrono::milliseconds(100),
+                                                  bool deadline_lane = true)
+        : _flags(0), _lanes(), _deadlines(), _aging_period(std::max<std::int64_t>(1, to_ns(aging_period))),
+          _has_deadline_lane(deadline_lane), _workers(), _idle_event(), _shutdown(false), _queued(0), _completion() {
+        if (n_lanes == 0) {
+            throw std::invalid_argument("priority_thread_pool_executor: at least one lane is required");
+        }
+
+        pthread_key_create(&_recursive_key, NULL);
+
+        for (std::size_t i = 0; i < n_lanes; ++i) {
+            _lanes.emplace_back(new fifo_lane());
+        }
+
+        const std::size_t n_workers = (n_thread > 0) ? n_thread : std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 0; i < n_workers; ++i) {
+            _workers.emplace_back([this]() { run(); });
+        }
+    }
+
+    inline ~priority_thread_pool_executor() {
+        if (_flags[static_cast<std::size_t>(flags::complete_all_before_delete)]) {
+            wait();
+        }
+
+        _shutdown.store(true);
+        _idle_event.notify_all();
+
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+        pthread_key_delete(_recursive_key);
+    }
+
+    /// execute fun in the lowest priority lane
+    template <typename Function>
+    inline void execute(Function&& fun) {
+        execute(lanes() - 1, std::forward<Function>(fun));
+    }
+
+    /// execute fun in a lane, 0 is the highest priority
+    template <typename Function>
+    inline void execute(std::size_t lane, Function&& fun) {
+        check_lane(lane);
+        push(lane, unique_task(std::forward<Function>(fun)));
+    }
+
+    /// execute fun in the deadline lane, tasks of earliest deadline first
+    template <typename Function>
+    inline void execute_before(clock::time_point deadline, Function&& fun) {
+        check_deadline_lane();
+        push_deadline(deadline, unique_task(std::forward<Function>(fun)));
+    }
+
+    template <typename Function>
+    inline future<typename details::task_result<Function>::type> twoway_execute(Function&& fun) {
+        return twoway_execute(lanes() - 1, std::forward<Function>(fun));
+    }
+
+    template <typename Function>
+    inline future<typename details::task_result<Function>::type> twoway_execute(std::size_t lane, Function&& fun) {
+        check_lane(lane);
+        auto task = make_task(std::forward<Function>(fun));
+
+        // a worker waiting on the result would hold a thread of the pool: execute inline
+        if (running_in_this_thread()) {
+            task.second();
+        } else {
+            push(lane, unique_task(std::move(task.second)));
+        }
+        return std::move(task.first);
+    }
+
+    template <typename Function>
+    inline future<typename details::task_result<Function>::type> twoway_execute_before(clock::time_point deadline,
+                                                                                      Function&& fun) {
+        check_deadline_lane();
+        auto task = make_task(std::forward<Function>(fun));
+
+        if (running_in_this_thread()) {
+            task.second();
+        } else {
+            push_deadline(deadline, unique_task(std::move(task.second)));
+        }
+        return std::move(task.first);
+    }
+
+    /// number of priority lanes
+    inline std::size_t lanes() const { return _lanes.size(); }
+
+    inline bool has_deadline_lane() const { return _has_deadline_lane; }
+
+    inline clock::duration aging_period() const {
+        return std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(_aging_period));
+    }
+
+    /// occupancy of a priority lane
+    inline lane_status status(std::size_t lane) const {
+        check_lane(lane);
+        return _lanes[lane]->status(now_ns());
+    }
+
+    /// occupancy of the deadline lane
+    inline lane_status deadline_status() const { return _deadlines.status(now_ns()); }
+
+    inline void set_flags(flags flag, bool value) { _flags[static_cast<std::size_t>(flag)] = value; }
+
+    inline bool get_flag(flags flag) const { return _flags[static_cast<std::size_t>(flag)]; }
+
+    inline std::size_t size() const { return _workers.size(); }
+
+    /// true if the calling thread is a worker of this pool
+    inline bool running_in_this_thread() const { return pthread_getspecific(_recursive_key) != NULL; }
+
+    /// number of tasks submitted and not yet completed
+    inline std::size_t in_flight() const { return _completion.in_flight(); }
+
+    ///
+    /// \brief block until all the submitted tasks, and the tasks they submitted, completed
+    ///
+    /// must not be called from a task running in this pool
+    ///
+    inline void wait() { _completion.wait(); }
+
+    ///
+    /// \brief same as wait() with a timeout
+    /// \return true if all the tasks completed, false on timeout
+    ///
+    template <typename Rep, typename Period>
+    inline bool wait_for(const std::chrono::duration<Rep, Period>& timeout) { return _completion.wait_for(timeout); }
+
+  private:
+    priority_thread_pool_executor(const priority_thread_pool_executor&) = delete;
+    priority_thread_pool_executor& operator=(const priority_thread_pool_executor&) = delete;
+
+    static constexpr std::int64_t no_task = std::numeric_limits<std::int64_t>::max();
+
+    static inline std::int64_t to_ns(clock::duration d) {
+        return std::int64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+
+    static inline std::int64_t now_ns() { return to_ns(clock::now().time_since_epoch()); }
+
+    // common counters of a lane, readable without lock
+    class lane_base {
+      public:
+        inline lane_base() : _lock(), _queued(0), _executed(0), _head_time(no_task) {}
+
+        inline std::size_t queued() const { return _queued.load(std::memory_order_acquire); }
+
+        /// enqueue time of the oldest task, no_task if empty
+        inline std::int64_t head_time() const { return _head_time.load(std::memory_order_relaxed); }
+
+        inline lane_status status(std::int64_t now) const {
+            const std::int64_t head = head_time();
+            const std::int64_t wait = (head == no_task || head > now) ? 0 : now - head;
+            return lane_status{queued(), _executed.load(std::memory_order_relaxed), std::chrono::nanoseconds(wait)};
+        }
+
+      protected:
+        std::mutex _lock;
+        std::atomic<std::size_t> _queued, _executed;
+        std::atomic<std::int64_t> _head_time;
+    };
+
+    // FIFO lane
+    class fifo_lane : public lane_base {
+      public:
+        inline void push(unique_task&& task, std::int64_t now) {
+            std::lock_guard<std::mutex> _l(_lock);
+            if (_tasks.empty()) {
+                _head_time.store(now, std::memory_order_relaxed);
+            }
+            _tasks.emplace_back(now, std::move(task));
+            _queued.fetch_add(1, std::memory_order_release);
+        }
+
+        inline bool try_pop(unique_task& task) {
+            std::lock_guard<std::mutex> _l(_lock);
+            if (_tasks.empty()) {
+                return false;
+            }
+            task = std::move(_tasks.front().second);
+            _tasks.pop_front();
+            _head_time.store(_tasks.empty() ? std::int64_t(no_task) : _tasks.front().first, std::memory_order_relaxed);
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            _executed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+      private:
+        std::deque<std::pair<std::int64_t, unique_task>> _tasks;
+    };
+
+    // earliest deadline first lane, binary heap on ( deadline, submission order )
+    class deadline_lane : public lane_base {
+      public:
+        inline deadline_lane() : _tasks(), _sequence(0), _arrivals(), _first_arrival(0) {}
+
+        inline void push(std::int64_t deadline, unique_task&& task, std::int64_t now) {
+            std::lock_guard<std::mutex> _l(_lock);
+            if (_arrivals.empty()) {
+                _head_time.store(now, std::memory_order_relaxed);
+            }
+            _arrivals.push_back(arrival{now, false});
+            _tasks.push_back(entry{deadline, _sequence++, std::move(task)});
+            std::push_heap(_tasks.begin(), _tasks.end(), later);
+            _queued.fetch_add(1, std::memory_order_release);
+        }
+
+        inline bool try_pop(unique_task& task) {
+            std::lock_guard<std::mutex> _l(_lock);
+            if (_tasks.empty()) {
+                return false;
+            }
+            std::pop_heap(_tasks.begin(), _tasks.end(), later);
+            task = std::move(_tasks.back().task);
+            remove_arrival(_tasks.back().sequence);
+            _tasks.pop_back();
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            _executed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+      private:
+        struct entry {
+            std::int64_t deadline;
+            std::uint64_t sequence;
+            unique_task task;
+        };
+
+        struct arrival {
+            std::int64_t enqueued;
+            bool popped;
+        };
+
+        static inline bool later(const entry& a, const entry& b) {
+            return (a.deadline != b.deadline) ? (a.deadline > b.deadline) : (a.sequence > b.sequence);
+        }
+
+        // the oldest task is not the head of the heap: the enqueue times are kept in submission order,
+        // popped tasks are only marked and skipped once they reach the front, amortized O(1)
+        inline void remove_arrival(std::uint64_t sequence) {
+            _arrivals[std::size_t(sequence - _first_arrival)].popped = true;
+            while (_arrivals.empty() == false && _arrivals.front().popped) {
+                _arrivals.pop_front();
+                ++_first_arrival;
+            }
+            _head_time.store(_arrivals.empty() ? std::int64_t(no_task) : _arrivals.front().enqueued,
+                             std::memory_order_relaxed);
+        }
+
+        std::vector<entry> _tasks;
+        std::uint64_t _sequence;
+
+        // enqueue times of the tasks of sequence [_first_arrival, _sequence)
+        std::deque<arrival> _arrivals;
+        std::uint64_t _first_arrival;
+    };
+
+    inline void check_lane(std::size_t lane) const {
+        if (lane >= _lanes.size()) {
+            throw std::out_of_range("priority_thread_pool_executor: invalid lane");
+        }
+    }
+
+    inline void check_deadline_lane() const {
+        if (_has_deadline_lane == false) {
+            throw std::logic_error("priority_thread_pool_executor: no deadline lane");
+        }
+    }
+
+    inline void push(std::size_t lane, unique_task&& task) {
+        _completion.submitted();
+        _queued.fetch_add(1, std::memory_order_relaxed);
+        _lanes[lane]->push(std::move(task), now_ns());
+        _idle_event.notify_one();
+    }
+
+    inline void push_deadline(clock::time_point deadline, unique_task&& task) {
+        _completion.submitted();
+        _queued.fetch_add(1, std::memory_order_relaxed);
+        _deadlines.push(to_ns(deadline.time_since_epoch()), std::move(task), now_ns());
+        _idle_event.notify_one();
+    }
+
+    // rank of a lane, lower is served first, aging lowers the rank of the waiting lanes
+    inline std::int64_t rank(const lane_base& lane, std::int64_t base_rank, std::int64_t now) const {
+        const std::int64_t head = lane.head_time();
+        const std::int64_t wait = (head == no_task || head > now) ? 0 : now - head;
+        return base_rank - wait / _aging_period;
+    }
+
+    // pop the task of the lane of lowest rank, the deadline lane is identified by lanes()
+    inline bool try_pop(unique_task& task) {
+        while (_queued.load(std::memory_order_acquire) > 0) {
+            const std::int64_t now = now_ns();
+
+            std::size_t best = _lanes.size() + 1;
+            std::int64_t best_rank = std::numeric_limits<std::int64_t>::max();
+
+            if (_has_deadline_lane && _deadlines.queued() > 0) {
+                best = _lanes.size();
+                best_rank = rank(_deadlines, 0, now);
+            }
+
+            for (std::size_t i = 0; i < _lanes.size(); ++i) {
+                if (_lanes[i]->queued() == 0) {
+                    continue;
+                }
+                const std::int64_t lane_rank = rank(*_lanes[i], std::int64_t(i) + 1, now);
+                if (lane_rank < best_rank) {
+                    best = i;
+                    best_rank = lane_rank;
+                }
+            }
+
+            if (best > _lanes.size()) {
+                // queued but not yet visible in its lane
+                std::this_thread::yield();
+                continue;
+            }
+
+            const bool popped = (best == _lanes.size()) ? _deadlines.try_pop(task) : _lanes[best]->try_pop(task);
+            if (popped) {
+                _queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline void run() {
+        pthread_setspecific(_recursive_key, this);
+
+        unique_task task;
+        details::worker_loop(_idle_event, _shutdown,
+                             [this, &task]() {
+                                 if (try_pop(task) == false) {
+                                     return false;
+                                 }
+                                 task();
+                                 task = unique_task();
+                                 _completion.completed();
+                                 return true;
+                             },
+                             [this]() { return _queued.load() > 0; });
+    }
+
+    std::bitset<32> _flags;
+
+    std::vector<std::unique_ptr<fifo_lane>> _lanes;
+    deadline_lane _deadlines;
+    const std::int64_t _aging_period;
+    const bool _has_deadline_lane;
+
+    std::vector<std::thread> _workers;
+    pthread_key_t _recursive_key;
+
+    thread::eventcount _idle_event;
+    std::atomic<bool> _shutdown;
+
+    std::atomic<std::size_t> _queued;
+    details::task_completion _completion;
+};
+
+
+} // namespace hadoken
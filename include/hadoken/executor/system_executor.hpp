@@ -29,8 +29,6 @@
 #pragma once
 
 
-#include <future>
-
 #include <hadoken/executor/thread_pool_executor.hpp>
 #include <hadoken/utility/singleton.hpp>
 
@@ -44,24 +42,37 @@ namespace hadoken {
 class system_executor {
   public:
     template <typename T>
-    using future = std::future<T>;
+    using future = thread_pool_executor::future<T>;
 
     template <typename T>
-    using promise = std::promise<T>;
+    using promise = thread_pool_executor::promise<T>;
 
     inline system_executor() { singleton<thread_pool_executor>::init(); }
 
     inline ~system_executor() {}
 
-    inline void execute(std::function<void(void)> task) {
-        singleton<thread_pool_executor>::instance().execute(std::move(task));
+    template <typename Function>
+    inline void execute(Function&& fun) {
+        singleton<thread_pool_executor>::instance().execute(std::forward<Function>(fun));
+    }
+
+    template <typename Function>
+    inline future<typename details::task_result<Function>::type> twoway_execute(Function&& func) {
+        return singleton<thread_pool_executor>::instance().twoway_execute(std::forward<Function>(func));
     }
 
     template <typename Function>
-    inline future<decltype(std::declval<Function>()())> twoway_execute(Function func) {
-        return singleton<thread_pool_executor>::instance().twoway_execute(func);
+    inline future<void> bulk_execute(std::size_t n, Function&& fun) {
+        return singleton<thread_pool_executor>::instance().bulk_execute(n, std::forward<Function>(fun));
     }
 
+    template <typename Function>
+    inline void bulk_sync_execute(std::size_t n, Function&& fun) {
+        singleton<thread_pool_executor>::instance().bulk_sync_execute(n, std::forward<Function>(fun));
+    }
+
+    inline std::size_t size() const { return singleton<thread_pool_executor>::instance().size(); }
+
 
   private:
     singleton<thread_pool_executor> _s;
@@ -0,0 +1,278 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <hadoken/executor/unique_task.hpp>
+#include <hadoken/thread/future.hpp>
+
+
+namespace hadoken {
+
+
+///
+/// \brief directed acyclic graph of tasks scheduled on an executor
+///
+/// nodes are added with emplace(), edges with precede(). run() submits the nodes
+/// without predecessor to the executor: a node is submitted when its last predecessor
+/// completes, through an atomic counter of pending predecessors. No thread blocks, a worker
+/// completing a node continues directly with one of its ready successors.
+///
+/// The graph is reusable: run() resets the counters only, the same pipeline can be
+/// executed again and again without any rebuild.
+///
+/// When a node throws, or the executor refuses a node, the bodies of the nodes not yet
+/// started are skipped and the future returned by run() holds the first exception.
+///
+/// A graph runs once at a time, the graph and the executor must outlive the run
+///
+class task_graph {
+  public:
+    using node_id = std::size_t;
+
+    inline task_graph()
+        : _nodes(), _roots(), _pending(), _sorted(true), _running(false), _remaining(0), _failed(false), _error(), _done() {}
+
+    /// add a node executing fun at each run, return its identifier
+    template <typename Function>
+    inline node_id emplace(Function&& fun) {
+        check_not_running();
+        _nodes.emplace_back(unique_task(std::forward<Function>(fun)));
+        _pending.reset();
+        _sorted = false;
+        return _nodes.size() - 1;
+    }
+
+    /// add an edge, node after starts when node before completed
+    inline void precede(node_id before, node_id after) {
+        check_not_running();
+        if (before >= _nodes.size() || after >= _nodes.size()) {
+            throw std::out_of_range("task_graph: invalid node identifier");
+        }
+        _nodes[before].successors.push_back(after);
+        _nodes[after].predecessors += 1;
+        _sorted = false;
+    }
+
+    /// number of nodes
+    inline std::size_t size() const { return _nodes.size(); }
+
+    inline bool empty() const { return _nodes.empty(); }
+
+    /// number of direct successors of a node
+    inline std::size_t successors(node_id id) const { return _nodes.at(id).successors.size(); }
+
+    /// number of direct predecessors of a node
+    inline std::size_t predecessors(node_id id) const { return _nodes.at(id).predecessors; }
+
+    /// remove all the nodes
+    inline void clear() {
+        check_not_running();
+        _nodes.clear();
+        _roots.clear();
+        _pending.reset();
+        _sorted = true;
+    }
+
+    ///
+    /// \brief execute the graph on exec, return a future ready when every node completed
+    ///
+    /// throw std::invalid_argument if the graph contains a cycle
+    ///
+    template <typename Executor>
+    inline future<void> run(Executor& exec) {
+        if (_sorted == false) {
+            sort();
+        }
+
+        if (_running.exchange(true, std::memory_order_acquire)) {
+            throw std::logic_error("task_graph: graph already running");
+        }
+
+        if (_nodes.empty()) {
+            _running.store(false, std::memory_order_release);
+            return make_ready_future();
+        }
+
+        if (!_pending) {
+            _pending.reset(new std::atomic<std::size_t>[_nodes.size()]);
+        }
+        for (std::size_t i = 0; i < _nodes.size(); ++i) {
+            _pending[i].store(_nodes[i].predecessors, std::memory_order_relaxed);
+        }
+        _remaining.store(_nodes.size(), std::memory_order_relaxed);
+        _failed.store(false, std::memory_order_relaxed);
+        _error = std::exception_ptr();
+
+        _done = promise<void>();
+        future<void> res = _done.get_future();
+
+        for (node_id root : _roots) {
+            submit(exec, root);
+        }
+        return res;
+    }
+
+  private:
+    static constexpr node_id no_node = std::numeric_limits<node_id>::max();
+
+    struct node {
+        explicit inline node(unique_task&& fun) : task(std::move(fun)), successors(), predecessors(0) {}
+
+        unique_task task;
+        std::vector<node_id> successors;
+        std::size_t predecessors;
+    };
+
+    inline void check_not_running() const {
+        if (_running.load(std::memory_order_acquire)) {
+            throw std::logic_error("task_graph: graph modified while running");
+        }
+    }
+
+    // find the roots and check for cycles with Kahn's algorithm, after a modification only
+    inline void sort() {
+        std::vector<std::size_t> pending(_nodes.size());
+        std::vector<node_id> ready;
+        for (std::size_t i = 0; i < _nodes.size(); ++i) {
+            pending[i] = _nodes[i].predecessors;
+            if (pending[i] == 0) {
+                ready.push_back(i);
+            }
+        }
+        std::vector<node_id> roots(ready);
+
+        std::size_t visited = 0;
+        while (ready.empty() == false) {
+            const node_id id = ready.back();
+            ready.pop_back();
+            ++visited;
+            for (node_id succ : _nodes[id].successors) {
+                if (--pending[succ] == 0) {
+                    ready.push_back(succ);
+                }
+            }
+        }
+
+        if (visited != _nodes.size()) {
+            throw std::invalid_argument("task_graph: the graph contains a cycle");
+        }
+        _roots = std::move(roots);
+        _sorted = true;
+    }
+
+    // the first error wins, the tasks of the nodes not started yet are skipped
+    inline void fail(std::exception_ptr error) {
+        if (_failed.exchange(true) == false) {
+            _error = std::move(error);
+        }
+    }
+
+    // an executor refusing the node fails the run: the node and its successors are
+    // then accounted inline without running their task, the run still completes
+    template <typename Executor>
+    inline void submit(Executor& exec, node_id id) {
+        try {
+            exec.execute([this, &exec, id]() { execute_from(exec, id); });
+        } catch (...) {
+            fail(std::current_exception());
+            execute_from(exec, id);
+        }
+    }
+
+    // execute id, then one of its ready successors in the same thread and submit the others
+    template <typename Executor>
+    inline void execute_from(Executor& exec, node_id id) {
+        while (id != no_node) {
+            node& current = _nodes[id];
+            if (_failed.load(std::memory_order_relaxed) == false) {
+                try {
+                    current.task();
+                } catch (...) {
+                    fail(std::current_exception());
+                }
+            }
+
+            node_id next = no_node;
+            for (node_id succ : current.successors) {
+                if (_pending[succ].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next == no_node) {
+                        next = succ;
+                    } else {
+                        submit(exec, succ);
+                    }
+                }
+            }
+
+            if (_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                complete();
+                return;
+            }
+            id = next;
+        }
+    }
+
+    // last node, the graph can be destroyed by a waiter as soon as the promise is set
+    inline void complete() {
+        promise<void> done(std::move(_done));
+        std::exception_ptr error = std::move(_error);
+        _running.store(false, std::memory_order_release);
+
+        if (error) {
+            done.set_exception(std::move(error));
+        } else {
+            done.set_value();
+        }
+    }
+
+    task_graph(const task_graph&) = delete;
+    task_graph& operator=(const task_graph&) = delete;
+
+    std::vector<node> _nodes;
+    std::vector<node_id> _roots;
+    std::unique_ptr<std::atomic<std::size_t>[]> _pending;
+    bool _sorted;
+
+    std::atomic<bool> _running;
+    std::atomic<std::size_t> _remaining;
+    std::atomic<bool> _failed;
+    std::exception_ptr _error;
+    promise<void> _done;
+};
+
+
+} // namespace hadoken
@@ -28,59 +28,285 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <bitset>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <iostream>
+#include <mutex>
 #include <thread>
 #include <type_traits>
 #include <vector>
 
 #include <hadoken/containers/concurrent_queue.hpp>
-#include <hadoken/thread/future_helpers.hpp>
+#include <hadoken/containers/work_stealing_deque.hpp>
+#include <hadoken/executor/unique_task.hpp>
+#include <hadoken/os/topology.hpp>
+#include <hadoken/thread/eventcount.hpp>
+#include <hadoken/thread/future.hpp>
 #include <hadoken/threading/std_thread_model.hpp>
 
 
 namespace hadoken {
 
+template <typename Queue>
+class basic_thread_pool_executor;
 
 namespace details {
 
+// options common to all thread pool flavours
+class thread_pool_options {
+  public:
+    enum class flags : std::size_t { complete_all_before_delete = 0 };
+
+    enum class scheduling { shared_queue = 0, work_stealing = 1 };
+
+    /// placement of the workers on the cpus of the pool
+    enum class affinity {
+        /// no placement, the workers can migrate on any cpu
+        none = 0,
+        /// each worker is pinned to one cpu, round robin on the cpus of the pool
+        cpu = 1,
+        /// each worker is pinned to the NUMA node of its cpu, free to migrate inside the node
+        numa_node = 2
+    };
+};
+
+
+// tasks in flight of a pool, queued or running, and the waiters for their completion
+class task_completion {
+  public:
+    inline task_completion() : _in_flight(0), _lock(), _cond() {}
+
+    task_completion(const task_completion&) = delete;
+    task_completion& operator=(const task_completion&) = delete;
+
+    inline void submitted(std::size_t n = 1) { _in_flight.fetch_add(n, std::memory_order_relaxed); }
+
+    inline void completed() {
+        if (_in_flight.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // lock to not miss a waiter between its check and its wait
+            std::lock_guard<std::mutex> _l(_lock);
+            _cond.notify_all();
+        }
+    }
+
+    inline std::size_t in_flight() const { return _in_flight.load(); }
+
+    inline void wait() {
+        std::unique_lock<std::mutex> _l(_lock);
+        _cond.wait(_l, [this]() { return _in_flight.load(std::memory_order_acquire) == 0; });
+    }
+
+    template <typename Rep, typename Period>
+    inline bool wait_for(const std::chrono::duration<Rep, Period>& timeout) {
+        std::unique_lock<std::mutex> _l(_lock);
+        return _cond.wait_for(_l, timeout, [this]() { return _in_flight.load(std::memory_order_acquire) == 0; });
+    }
+
+  private:
+    std::atomic<std::size_t> _in_flight;
+    std::mutex _lock;
+    std::condition_variable _cond;
+};
+
+
+// main loop of a worker, adaptive idle strategy: spin, then yield, then park on idle_event
+// run_one() executes one task if any, has_pending_work() is checked again before parking
+template <typename RunOne, typename HasPendingWork>
+inline void worker_loop(thread::eventcount& idle_event, const std::atomic<bool>& shutdown, RunOne run_one,
+                        HasPendingWork has_pending_work) {
+    constexpr std::size_t spin_rounds = 64, yield_rounds = 16;
+    std::size_t idle_rounds = 0;
+
+    while (1) {
+        if (run_one()) {
+            idle_rounds = 0;
+            continue;
+        }
+
+        // exit only once there is nothing left to execute
+        if (shutdown.load()) {
+            return;
+        }
+
+        if (idle_rounds < spin_rounds) {
+            ++idle_rounds;
+            continue;
+        }
+
+        if (idle_rounds < spin_rounds + yield_rounds) {
+            ++idle_rounds;
+            std::this_thread::yield();
+            continue;
+        }
+
+        const thread::eventcount::key_type key = idle_event.prepare_wait();
+        if (has_pending_work() || shutdown.load()) {
+            idle_event.cancel_wait();
+        } else {
+            idle_event.wait(key);
+        }
+        idle_rounds = 0;
+    }
+}
+
+
+// cpus of each worker for a placement, an empty set means no placement
+inline std::vector<std::vector<std::size_t>> worker_cpu_sets(thread_pool_options::affinity placement,
+                                                             std::vector<std::size_t> cpus, std::size_t n_workers) {
+    std::vector<std::vector<std::size_t>> cpu_sets(n_workers);
+    if (placement == thread_pool_options::affinity::none) {
+        return cpu_sets;
+    }
+
+    const std::vector<numa_node> nodes = get_numa_nodes();
+    if (cpus.empty()) {
+        for (const numa_node& node : nodes) {
+            cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+        }
+    }
+
+    for (std::size_t i = 0; i < n_workers; ++i) {
+        const std::size_t cpu = cpus[i % cpus.size()];
+        cpu_sets[i].push_back(cpu);
+
+        if (placement != thread_pool_options::affinity::numa_node) {
+            continue;
+        }
+
+        // the cpus of the pool on the same node
+        for (const numa_node& node : nodes) {
+            if (std::find(node.cpus.begin(), node.cpus.end(), cpu) == node.cpus.end()) {
+                continue;
+            }
+            cpu_sets[i].clear();
+            for (std::size_t node_cpu : node.cpus) {
+                if (std::find(cpus.begin(), cpus.end(), node_cpu) != cpus.end()) {
+                    cpu_sets[i].push_back(node_cpu);
+                }
+            }
+        }
+    }
+    return cpu_sets;
+}
+
+
+template <typename Queue>
 class worker_thread {
   public:
-    explicit inline worker_thread(concurrent_queue<std::function<void()>>& queue) : _queue_ref(queue), exec(), finished(false) {
+    using task_type = typename Queue::value_type;
+
+    // task of the local queue, the slots are recycled by the worker owning them
+    struct task_slot {
+        explicit inline task_slot(worker_thread* slot_owner) : task(), next(nullptr), owner(slot_owner) {}
+
+        task_type task;
+        task_slot* next;
+        worker_thread* owner;
+    };
+
+    explicit inline worker_thread(basic_thread_pool_executor<Queue>& pool, std::size_t id, std::vector<std::size_t> cpus)
+        : _pool(pool), _id(id), _local(), _free_slots(nullptr), _remote_slots(nullptr), _rand_state(id + 1),
+          _cpus(std::move(cpus)), exec() {}
+
+
+    inline ~worker_thread() {
+        join();
+
+        // release the work left in the local queue and the free slots,
+        // all the workers are stopped: no slot comes back anymore
+        while (auto work_item = _local.pop()) {
+            delete work_item.get();
+        }
+        delete_slots(_free_slots);
+        delete_slots(_remote_slots.load());
+    }
+
+    inline void start() {
         std::thread runner([this]() { run(); });
 
         exec.swap(runner);
     }
 
-
-    inline ~worker_thread() {
-        finished.store(true);
+    inline void join() {
         if (exec.joinable()) {
             exec.join();
         }
     }
 
+    // from the worker thread only
+    inline void push_local(task_type&& task) { _local.push(acquire_slot(std::move(task))); }
 
-    inline void run() {
-        while (!finished) {
-            auto work_item = _queue_ref.try_pop(std::chrono::milliseconds(10));
-            if (work_item) {
-                work_item.get()();
-            }
-        }
+    inline task_slot* steal() {
+        auto work_item = _local.steal();
+        return (work_item) ? work_item.get() : nullptr;
     }
 
+    inline bool local_empty() const { return _local.empty(); }
+
+    void run();
+
   private:
     worker_thread(const worker_thread&) = delete;
 
-    concurrent_queue<std::function<void()>>& _queue_ref;
+    bool run_one();
 
-    std::thread exec;
+    task_slot* find_local_or_steal();
+
+    // a free slot of this worker, allocated only when the free lists are empty
+    inline task_slot* acquire_slot(task_type&& task) {
+        if (_free_slots == nullptr) {
+            _free_slots = _remote_slots.exchange(nullptr, std::memory_order_acquire);
+        }
 
-    std::atomic<bool> finished;
+        task_slot* slot = _free_slots;
+        if (slot != nullptr) {
+            _free_slots = slot->next;
+        } else {
+            slot = new task_slot(this);
+        }
+        slot->task = std::move(task);
+        return slot;
+    }
+
+    // give an executed slot back to its owner, a stolen slot goes to the lock-free list of
+    // its owner: pushed by any thief, emptied at once by the owner only, no ABA problem
+    inline void release_slot(task_slot* slot) {
+        slot->task = task_type();
+
+        worker_thread* owner = slot->owner;
+        if (owner == this) {
+            slot->next = _free_slots;
+            _free_slots = slot;
+            return;
+        }
+
+        slot->next = owner->_remote_slots.load(std::memory_order_relaxed);
+        while (owner->_remote_slots.compare_exchange_weak(slot->next, slot, std::memory_order_release,
+                                                          std::memory_order_relaxed) == false) {
+        }
+    }
+
+    static inline void delete_slots(task_slot* slot) {
+        while (slot != nullptr) {
+            task_slot* next = slot->next;
+            delete slot;
+            slot = next;
+        }
+    }
+
+    basic_thread_pool_executor<Queue>& _pool;
+    std::size_t _id;
+    work_stealing_deque<task_slot*> _local;
+    task_slot* _free_slots;
+    std::atomic<task_slot*> _remote_slots;
+    std::uint64_t _rand_state;
+    std::vector<std::size_t> _cpus;
+
+    std::thread exec;
 };
 
 
@@ -89,79 +315,352 @@ class worker_thread {
 ///
 /// \brief Executor implementation for a simple thread
 ///
-class thread_pool_executor : public std_thread_model {
+/// Two scheduling modes are supported:
+///
+/// - scheduling::shared_queue: every task goes through one shared queue
+///
+/// - scheduling::work_stealing: each worker owns a lock-free deque, tasks submitted
+///   from inside a worker stay in its local deque and idle workers steal from the others.
+///   Tasks submitted from outside the pool go through the shared queue.
+///
+/// The shared queue type is a template parameter, e.g concurrent_queue
+/// or the lock-free concurrent_ring_queue. Its value_type must accept
+/// move-only callables, see unique_task
+///
+/// Idle workers spin, then yield, then park on an eventcount until new work
+/// is submitted. Pending tasks are executed before the pool is destroyed.
+///
+/// The pool counts the tasks in flight ( queued or running ), wait() and wait_for()
+/// block until all of them completed.
+///
+/// twoway_execute returns a hadoken::future, the task and its result share one allocation
+///
+/// The workers can be pinned to cpus, or to the NUMA node of their cpu, see affinity.
+/// The pool uses the given cpus, all the usable cpus of the machine by default
+///
+/// bulk_execute submits n indexed executions as a single batch,
+/// with bulk_sync_execute the calling thread executes its share of the batch
+///
+template <typename Queue>
+class basic_thread_pool_executor : public std_thread_model, public details::thread_pool_options {
   public:
-    enum class flags : std::size_t { complete_all_before_delete = 0 };
+    using queue_type = Queue;
+
+    using task_type = typename Queue::value_type;
 
     template <typename T>
-    using future = std::future<T>;
+    using future = hadoken::future<T>;
 
     template <typename T>
-    using promise = std::promise<T>;
+    using promise = hadoken::promise<T>;
 
-    explicit inline thread_pool_executor(std::size_t n_thread = 0) : _flags(0), _work_queue(), _executors() {
+    explicit inline basic_thread_pool_executor(std::size_t n_thread = 0, scheduling mode = scheduling::shared_queue,
+                                               affinity placement = affinity::none,
+                                               const std::vector<std::size_t>& cpus = std::vector<std::size_t>())
+        : _flags(0), _mode(mode), _work_queue(), _executors(), _idle_event(), _shutdown(false),
+          _completion() {
         pthread_key_create(&_recursive_key, NULL);
 
-        const std::size_t n_workers = (n_thread > 0) ? n_thread : (std::thread::hardware_concurrency());
+        const std::size_t n_workers =
+            (n_thread > 0) ? n_thread : ((cpus.empty() == false) ? cpus.size() : std::thread::hardware_concurrency());
+        std::vector<std::vector<std::size_t>> cpu_sets = details::worker_cpu_sets(placement, cpus, n_workers);
+
         for (std::size_t i = 0; i < n_workers; ++i) {
-            _executors.emplace_back(new details::worker_thread(_work_queue));
+            _executors.emplace_back(new details::worker_thread<Queue>(*this, i, std::move(cpu_sets[i])));
+        }
+
+        // workers can steal from each other, start them only once all of them exist
+        for (auto& worker : _executors) {
+            worker->start();
         }
     }
 
-    inline ~thread_pool_executor() {
-        pthread_key_delete(_recursive_key);
+    inline ~basic_thread_pool_executor() {
         if (_flags[static_cast<std::size_t>(flags::complete_all_before_delete)]) {
             wait();
         }
+
+        // stop all the workers before destroying any of them, a worker can still steal from the others
+        _shutdown.store(true);
+        _idle_event.notify_all();
+
+        for (auto& worker : _executors) {
+            worker->join();
+        }
+        _executors.clear();
+        pthread_key_delete(_recursive_key);
     }
 
-    inline void execute(std::function<void(void)> task) { _work_queue.push(std::move(task)); }
+    template <typename Function>
+    inline void execute(Function&& fun) {
+        submit(task_type(std::forward<Function>(fun)));
+    }
 
     template <typename Function>
-    inline future<decltype(std::declval<Function>()())> twoway_execute(Function func) {
+    inline future<typename details::task_result<Function>::type> twoway_execute(Function&& func) {
+        auto task = make_task(std::forward<Function>(func));
 
         // if our current thread is not part of the pool
         // we execute in the pool
-        // if it is already a pooled_thread, we do not to avoid deadlock
+        // if it is already a pooled_thread, we execute inline to avoid deadlock
         if (pthread_getspecific(_recursive_key) == NULL) {
-
-            auto prom = std::make_shared<promise<decltype(std::declval<Function>()())>>();
-            auto future_result = prom->get_future();
-
-            _work_queue.push([prom, func, this]() mutable -> void {
-                pthread_setspecific(this->_recursive_key, (void*)1);
-                try {
-                    set_promise_from_result(*prom, func);
-                } catch (...) {
-                    try {
-                        prom->set_exception(std::current_exception());
-                    } catch (...) {
-                        std::cerr << "error during set_exception in executor" << std::endl;
-                    }
-                }
-            });
-            return future_result;
+            submit(task_type(std::move(task.second)));
         } else {
-            return std::async(std::launch::deferred, [func]() { return func(); });
+            task.second();
         }
+        return std::move(task.first);
+    }
+
+    ///
+    /// \brief execute fun(i) for each i in [0, n)
+    ///
+    /// the batch is submitted in one operation: one runner per worker
+    /// which claims chunks of indices from a shared counter
+    ///
+    /// \return a future ready once all the indices completed,
+    /// it holds the first exception thrown by fun, if any
+    ///
+    template <typename Function>
+    inline future<void> bulk_execute(std::size_t n, Function&& fun) {
+        // a worker waiting on the result would hold a thread of the pool:
+        // it takes part in the execution, the indices left to wait for are already running
+        const bool inside_pool = (pthread_getspecific(_recursive_key) != NULL);
+
+        return bulk_submit(n, std::forward<Function>(fun), inside_pool);
+    }
+
+    ///
+    /// \brief execute fun(i) for each i in [0, n) and wait for the completion
+    ///
+    /// the calling thread takes part in the execution and claims chunks
+    /// of indices like the workers. Can be called from inside the pool
+    /// without risk of deadlock, rethrow the first exception thrown by fun
+    ///
+    template <typename Function>
+    inline void bulk_sync_execute(std::size_t n, Function&& fun) {
+        bulk_submit(n, std::forward<Function>(fun), true).get();
     }
 
     inline void set_flags(flags flag, bool value) { _flags[static_cast<std::size_t>(flag)] = value; }
 
     inline bool get_flag(flags flag) const { return _flags[static_cast<std::size_t>(flag)]; }
 
-    inline void wait() {
-        while (_work_queue.empty() == false) {
-            std::this_thread::yield();
+    inline scheduling get_scheduling() const { return _mode; }
+
+    inline std::size_t size() const { return _executors.size(); }
+
+    /// true if the calling thread is a worker of this pool
+    inline bool running_in_this_thread() const { return pthread_getspecific(_recursive_key) != NULL; }
+
+    /// number of tasks submitted and not yet completed
+    inline std::size_t in_flight() const { return _completion.in_flight(); }
+
+    ///
+    /// \brief block until all the submitted tasks, and the tasks they submitted, completed
+    ///
+    /// must not be called from a task running in this pool
+    ///
+    inline void wait() { _completion.wait(); }
+
+    ///
+    /// \brief same as wait() with a timeout
+    /// \return true if all the tasks completed, false on timeout
+    ///
+    template <typename Rep, typename Period>
+    inline bool wait_for(const std::chrono::duration<Rep, Period>& timeout) { return _completion.wait_for(timeout); }
+
+  private:
+    friend class details::worker_thread<Queue>;
+
+    inline void task_submitted() { _completion.submitted(); }
+
+    inline void task_completed() { _completion.completed(); }
+
+    inline void submit(task_type&& task) {
+        details::worker_thread<Queue>* current = static_cast<details::worker_thread<Queue>*>(pthread_getspecific(_recursive_key));
+
+        if (current != nullptr) {
+            if (_mode == scheduling::work_stealing) {
+                task_submitted();
+                current->push_local(std::move(task));
+                _idle_event.notify_one();
+                return;
+            }
+
+            // a worker can not wait for a free slot in a bounded queue
+            // that only the workers consume: execute inline
+            task_submitted();
+            if (_work_queue.try_push(task) == false) {
+                task_completed();
+                task();
+                return;
+            }
+        } else {
+            task_submitted();
+            _work_queue.push(std::move(task));
         }
+        _idle_event.notify_one();
+    }
+
+    template <typename Function>
+    inline future<void> bulk_submit(std::size_t n, Function&& fun, bool caller_runs) {
+        using fun_type = typename std::decay<Function>::type;
+
+        if (n == 0) {
+            return make_ready_future();
+        }
+
+        // a caller outside of the pool comes on top of the workers
+        const bool inside_pool = (pthread_getspecific(_recursive_key) != NULL);
+        const std::size_t n_runners = std::min(n, size() + ((caller_runs && !inside_pool) ? 1 : 0));
+
+        auto* state = new details::bulk_state<fun_type>(n, n_runners, std::forward<Function>(fun));
+        future<void> res(state);
+
+        std::vector<task_type> runners;
+        runners.reserve(n_runners);
+        for (std::size_t i = (caller_runs ? 1 : 0); i < n_runners; ++i) {
+            runners.emplace_back(details::bulk_runner<fun_type>(state));
+        }
+
+        if (runners.empty() == false) {
+            submit_bulk(runners);
+        }
+
+        if (caller_runs) {
+            details::bulk_runner<fun_type> runner(state);
+            runner();
+        }
+        return res;
+    }
+
+    inline void submit_bulk(std::vector<task_type>& tasks) {
+        details::worker_thread<Queue>* current = static_cast<details::worker_thread<Queue>*>(pthread_getspecific(_recursive_key));
+
+        _completion.submitted(tasks.size());
+
+        if (current != nullptr) {
+            if (_mode == scheduling::work_stealing) {
+                for (auto& task : tasks) {
+                    current->push_local(std::move(task));
+                }
+            } else {
+                // same as submit(), what does not fit in the queue is executed inline
+                auto it = _work_queue.try_push(tasks.begin(), tasks.end());
+                for (; it != tasks.end(); ++it) {
+                    task_completed();
+                    (*it)();
+                }
+            }
+        } else {
+            _work_queue.push(tasks.begin(), tasks.end());
+        }
+
+        if (tasks.size() > 1) {
+            _idle_event.notify_all();
+        } else {
+            _idle_event.notify_one();
+        }
+    }
+
+    inline bool has_pending_work() const { return _work_queue.empty() == false || local_queues_empty() == false; }
+
+    inline bool local_queues_empty() const {
+        for (auto& worker : _executors) {
+            if (worker->local_empty() == false) {
+                return false;
+            }
+        }
+        return true;
     }
 
-  private:
     std::bitset<32> _flags;
-    concurrent_queue<std::function<void()>> _work_queue;
-    std::vector<std::unique_ptr<details::worker_thread>> _executors;
+    scheduling _mode;
+    Queue _work_queue;
+    std::vector<std::unique_ptr<details::worker_thread<Queue>>> _executors;
     pthread_key_t _recursive_key;
+
+    thread::eventcount _idle_event;
+    std::atomic<bool> _shutdown;
+
+    details::task_completion _completion;
 };
 
 
+/// default thread pool, mutex based unbounded shared queue
+using thread_pool_executor = basic_thread_pool_executor<concurrent_queue<unique_task>>;
+
+
+namespace details {
+
+
+template <typename Queue>
+inline void worker_thread<Queue>::run() {
+    pthread_setspecific(_pool._recursive_key, this);
+
+    // pinned before the first task: the memory first touched by the tasks is allocated on the node of the worker
+    if (_cpus.empty() == false) {
+        set_current_thread_affinity(_cpus);
+    }
+
+    details::worker_loop(_pool._idle_event, _pool._shutdown, [this]() { return run_one(); },
+                         [this]() { return _pool.has_pending_work(); });
+}
+
+
+template <typename Queue>
+inline bool worker_thread<Queue>::run_one() {
+    if (_pool._mode == thread_pool_options::scheduling::work_stealing) {
+        task_slot* local_item = find_local_or_steal();
+        if (local_item != nullptr) {
+            local_item->task();
+            release_slot(local_item);
+            _pool.task_completed();
+            return true;
+        }
+    }
+
+    auto work_item = _pool._work_queue.try_pop();
+    if (work_item) {
+        work_item.get()();
+        _pool.task_completed();
+        return true;
+    }
+    return false;
+}
+
+
+template <typename Queue>
+inline typename worker_thread<Queue>::task_slot* worker_thread<Queue>::find_local_or_steal() {
+    auto local_item = _local.pop();
+    if (local_item) {
+        return local_item.get();
+    }
+
+    // pick a random victim to start with, avoid to have all thieves on the same worker
+    _rand_state ^= _rand_state << 13;
+    _rand_state ^= _rand_state >> 7;
+    _rand_state ^= _rand_state << 17;
+
+    const std::size_t n_workers = _pool._executors.size();
+    const std::size_t first_victim = std::size_t(_rand_state % n_workers);
+
+    for (std::size_t i = 0; i < n_workers; ++i) {
+        const std::size_t victim = (first_victim + i) % n_workers;
+        if (victim == _id) {
+            continue;
+        }
+
+        task_slot* stolen_item = _pool._executors[victim]->steal();
+        if (stolen_item != nullptr) {
+            return stolen_item;
+        }
+    }
+    return nullptr;
+}
+
+
+} // namespace details
+
+
 } // namespace hadoken
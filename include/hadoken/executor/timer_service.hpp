@@ -0,0 +1,537 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <hadoken/executor/thread_pool_executor.hpp>
+#include <hadoken/executor/unique_task.hpp>
+
+
+namespace hadoken {
+
+
+namespace details {
+
+
+///
+/// timer of a timer_service, intrusive reference counting
+/// shared by the wheel, the handles and the pending executions
+///
+class timer_node {
+  public:
+    enum state : int { scheduled = 0, started = 1, cancelled = 2 };
+
+    template <typename Function>
+    inline timer_node(Function&& fun, std::uint64_t period)
+        : _ref(1), _state(scheduled), next(nullptr), expiry(0), period(period), task(std::forward<Function>(fun)) {}
+
+    inline void add_ref() { _ref.fetch_add(1, std::memory_order_relaxed); }
+
+    inline void release() {
+        if (_ref.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    inline bool cancel() {
+        int expected = scheduled;
+        return _state.compare_exchange_strong(expected, cancelled, std::memory_order_acq_rel);
+    }
+
+    inline bool is_scheduled() const { return _state.load(std::memory_order_acquire) == scheduled; }
+
+    inline bool is_cancelled() const { return _state.load(std::memory_order_acquire) == cancelled; }
+
+    // a one-shot timer starts once, a periodic timer stays scheduled until cancelled
+    inline bool try_start() {
+        if (period > 0) {
+            return is_scheduled();
+        }
+        int expected = scheduled;
+        return _state.compare_exchange_strong(expected, started, std::memory_order_acq_rel);
+    }
+
+  private:
+    timer_node(const timer_node&) = delete;
+    timer_node& operator=(const timer_node&) = delete;
+
+    std::atomic<int> _ref;
+    std::atomic<int> _state;
+
+  public:
+    // owned by the wheel, under the lock of the service
+    timer_node* next;
+    std::uint64_t expiry;
+
+    const std::uint64_t period;
+    unique_task task;
+};
+
+
+///
+/// hierarchical timer wheel, levels of 256 slots, in ticks
+///
+/// a timer goes to the level matching its distance to the current tick and is moved down
+/// by one level at each cascade: O(1) insertion, O(1) amortized expiration.
+/// A bitmap of the non empty slots gives the next tick with work without visiting empty slots.
+/// Cancelled timers are dropped when their slot is reached
+///
+class timer_wheel {
+  public:
+    static constexpr unsigned level_bits = 8;
+    static constexpr std::size_t n_levels = 4, n_slots = std::size_t(1) << level_bits;
+    static constexpr std::uint64_t no_tick = std::numeric_limits<std::uint64_t>::max();
+
+    inline timer_wheel() : _now(0), _size(0), _slots(), _used() {
+        for (auto& level : _slots) {
+            level.fill(nullptr);
+        }
+        for (auto& level : _used) {
+            level.fill(0);
+        }
+    }
+
+    inline ~timer_wheel() { clear(); }
+
+    /// current tick, every tick up to now is processed
+    inline std::uint64_t now() const { return _now; }
+
+    /// timers in the wheel, cancelled timers included until their slot is reached
+    inline std::size_t size() const { return _size; }
+
+    /// add a timer expiring after now(), the wheel takes the reference of the caller
+    inline void insert(timer_node* node) {
+        node->expiry = std::max(node->expiry, _now + 1);
+        place(node);
+        ++_size;
+    }
+
+    /// process the ticks up to target, append the expired timers to due, with their reference
+    inline void advance(std::uint64_t target, std::vector<timer_node*>& due) {
+        while (_now < target) {
+            const std::uint64_t tick = next_tick();
+            if (tick > target) {
+                _now = target;
+                return;
+            }
+            _now = tick;
+
+            // cascade from the highest level, a timer can go down by several levels at once
+            for (std::size_t level = n_levels - 1; level > 0; --level) {
+                if ((_now & ((std::uint64_t(1) << (level * level_bits)) - 1)) == 0) {
+                    cascade(level, due);
+                }
+            }
+            cascade(0, due);
+        }
+    }
+
+    /// next tick with a slot to process, no_tick if the wheel is empty
+    inline std::uint64_t next_tick() const {
+        std::uint64_t best = no_tick;
+        for (std::size_t level = 0; level < n_levels; ++level) {
+            const std::uint64_t base = _now >> (level * level_bits);
+            const std::size_t distance = next_used_slot(level, std::size_t(base % n_slots));
+            if (distance != 0) {
+                best = std::min(best, (base + distance) << (level * level_bits));
+            }
+        }
+        return best;
+    }
+
+    /// cancel and release all the timers
+    inline void clear() {
+        for (std::size_t level = 0; level < n_levels; ++level) {
+            for (std::size_t slot = 0; slot < n_slots; ++slot) {
+                timer_node* node = take_slot(level, slot);
+                while (node != nullptr) {
+                    timer_node* next = node->next;
+                    node->cancel();
+                    node->release();
+                    node = next;
+                }
+            }
+        }
+        _size = 0;
+    }
+
+  private:
+    static constexpr std::size_t word_bits = 64, n_words = n_slots / word_bits;
+
+    inline void place(timer_node* node) {
+        const std::uint64_t delta = node->expiry - _now;
+
+        std::size_t level = 0;
+        while (level < n_levels - 1 && delta >= (std::uint64_t(1) << ((level + 1) * level_bits))) {
+            ++level;
+        }
+
+        // beyond the range of the wheel: farthest slot, placed again at each cascade
+        std::uint64_t position = node->expiry;
+        if (delta >= (std::uint64_t(1) << (n_levels * level_bits))) {
+            position = _now + (std::uint64_t(1) << (n_levels * level_bits)) - 1;
+        }
+
+        const std::size_t slot = std::size_t((position >> (level * level_bits)) % n_slots);
+        node->next = _slots[level][slot];
+        _slots[level][slot] = node;
+        _used[level][slot / word_bits] |= std::uint64_t(1) << (slot % word_bits);
+    }
+
+    inline timer_node* take_slot(std::size_t level, std::size_t slot) {
+        timer_node* head = _slots[level][slot];
+        _slots[level][slot] = nullptr;
+        _used[level][slot / word_bits] &= ~(std::uint64_t(1) << (slot % word_bits));
+        return head;
+    }
+
+    // empty the current slot of a level: expired timers go to due, the others one level down
+    inline void cascade(std::size_t level, std::vector<timer_node*>& due) {
+        timer_node* node = take_slot(level, std::size_t((_now >> (level * level_bits)) % n_slots));
+        while (node != nullptr) {
+            timer_node* next = node->next;
+            if (node->is_cancelled()) {
+                --_size;
+                node->release();
+            } else if (node->expiry <= _now) {
+                --_size;
+                due.push_back(node);
+            } else {
+                place(node);
+            }
+            node = next;
+        }
+    }
+
+    // distance in [1, n_slots] from current to the next used slot of a level, 0 if the level is empty
+    inline std::size_t next_used_slot(std::size_t level, std::size_t current) const {
+        const std::size_t first = (current + 1) % n_slots;
+        for (std::size_t i = 0; i <= n_words; ++i) {
+            const std::size_t word = (first / word_bits + i) % n_words;
+            std::uint64_t bits = _used[level][word];
+            if (i == 0) {
+                bits &= ~std::uint64_t(0) << (first % word_bits);
+            }
+            if (bits != 0) {
+                const std::size_t slot = word * word_bits + std::size_t(__builtin_ctzll(bits));
+                return (slot + n_slots - current - 1) % n_slots + 1;
+            }
+        }
+        return 0;
+    }
+
+    std::uint64_t _now;
+    std::size_t _size;
+    std::array<std::array<timer_node*, n_slots>, n_levels> _slots;
+    std::array<std::array<std::uint64_t, n_words>, n_levels> _used;
+};
+
+
+} // namespace details
+
+
+///
+/// \brief handle on a timer of a timer_service, copyable
+///
+class timer_handle {
+  public:
+    inline timer_handle() noexcept : _node(nullptr) {}
+
+    explicit inline timer_handle(details::timer_node* node) noexcept : _node(node) {
+        if (_node) {
+            _node->add_ref();
+        }
+    }
+
+    inline timer_handle(const timer_handle& other) noexcept : timer_handle(other._node) {}
+
+    inline timer_handle(timer_handle&& other) noexcept : _node(other._node) { other._node = nullptr; }
+
+    inline timer_handle& operator=(timer_handle other) noexcept {
+        std::swap(_node, other._node);
+        return *this;
+    }
+
+    inline ~timer_handle() {
+        if (_node) {
+            _node->release();
+        }
+    }
+
+    inline bool valid() const noexcept { return _node != nullptr; }
+
+    /// true until a one-shot timer starts, or until a periodic timer is cancelled
+    inline bool active() const { return _node && _node->is_scheduled(); }
+
+    ///
+    /// \brief cancel the timer, lock-free
+    /// \return true if an execution was prevented, false if the timer already started or was cancelled
+    ///
+    /// an execution of a periodic timer already running completes, no other one starts
+    ///
+    inline bool cancel() { return _node && _node->cancel(); }
+
+  private:
+    details::timer_node* _node;
+};
+
+
+///
+/// \brief delayed and periodic execution on an executor, driven by a hierarchical timer wheel
+///
+/// one timer thread advances the wheel and submits the expired timers to the executor,
+/// it parks until the next tick with a timer or a cascade, insertion and expiration are O(1).
+/// Deadlines are rounded up to the resolution, a timer never runs early.
+///
+/// A periodic timer is rescheduled when its execution completes, at its previous deadline
+/// plus the period, the periods missed by a late execution are skipped: executions of a
+/// periodic timer never overlap.
+///
+/// The executor must outlive the service, and accept move-only tasks. The destruction of
+/// the service cancels the timers not yet expired and waits for the submitted executions
+///
+template <typename Executor>
+class basic_timer_service {
+  public:
+    using executor_type = Executor;
+    using clock = std::chrono::steady_clock;
+
+    explicit inline basic_timer_service(Executor& exec, clock::duration resolution = std::chrono::milliseconds(1))
+        : _exec(exec), _resolution(std::max(resolution, clock::duration(1))), _start(clock::now()), _lock(), _wake(),
+          _wheel(), _next_wake(details::timer_wheel::no_tick), _shutdown(false), _submitted(0), _submitted_done(),
+          _timer_thread() {
+        _timer_thread = std::thread([this]() { run(); });
+    }
+
+    inline ~basic_timer_service() {
+        {
+            std::lock_guard<std::mutex> _l(_lock);
+            _shutdown = true;
+        }
+        _wake.notify_all();
+        _timer_thread.join();
+
+        std::unique_lock<std::mutex> _l(_lock);
+        _wheel.clear();
+        _submitted_done.wait(_l, [this]() { return _submitted == 0; });
+    }
+
+    /// execute fun on the executor at deadline, immediately if the deadline passed
+    template <typename Function>
+    inline timer_handle execute_at(clock::time_point deadline, Function&& fun) {
+        return schedule(new details::timer_node(std::forward<Function>(fun), 0), deadline);
+    }
+
+    /// execute fun on the executor after delay
+    template <typename Function>
+    inline timer_handle execute_after(clock::duration delay, Function&& fun) {
+        return execute_at(clock::now() + delay, std::forward<Function>(fun));
+    }
+
+    /// execute fun on the executor at first, then every period until cancelled
+    template <typename Function>
+    inline timer_handle execute_periodic(clock::time_point first, clock::duration period, Function&& fun) {
+        const std::uint64_t period_ticks = std::max<std::uint64_t>(1, ticks_ceil(period));
+        return schedule(new details::timer_node(std::forward<Function>(fun), period_ticks), first);
+    }
+
+    /// execute fun on the executor every period, starting one period from now, until cancelled
+    template <typename Function>
+    inline timer_handle execute_periodic(clock::duration period, Function&& fun) {
+        return execute_periodic(clock::now() + period, period, std::forward<Function>(fun));
+    }
+
+    /// timers in the wheel, cancelled timers included until the wheel reaches their slot
+    inline std::size_t pending() const {
+        std::lock_guard<std::mutex> _l(_lock);
+        return _wheel.size();
+    }
+
+    inline clock::duration resolution() const { return _resolution; }
+
+    inline Executor& executor() { return _exec; }
+
+  private:
+    basic_timer_service(const basic_timer_service&) = delete;
+    basic_timer_service& operator=(const basic_timer_service&) = delete;
+
+    // execution of an expired timer, owns one reference on the timer
+    class timer_runner {
+      public:
+        inline timer_runner(basic_timer_service* service, details::timer_node* node) noexcept
+            : _service(service), _node(node) {}
+
+        inline timer_runner(timer_runner&& other) noexcept : _service(other._service), _node(other._node) {
+            other._node = nullptr;
+        }
+
+        // a task dropped by the executor still completes
+        inline ~timer_runner() {
+            if (_node) {
+                _node->release();
+                _service->execution_done();
+            }
+        }
+
+        inline void operator()() {
+            details::timer_node* node = _node;
+            if (node->try_start()) {
+                node->task();
+                if (node->period > 0) {
+                    _node = nullptr;
+                    _service->reschedule(node);
+                    return;
+                }
+            }
+        }
+
+      private:
+        timer_runner(const timer_runner&) = delete;
+        timer_runner& operator=(const timer_runner&) = delete;
+
+        basic_timer_service* _service;
+        details::timer_node* _node;
+    };
+
+    inline std::uint64_t ticks_ceil(clock::duration d) const {
+        return (d.count() <= 0) ? 0 : std::uint64_t((d.count() + _resolution.count() - 1) / _resolution.count());
+    }
+
+    inline std::uint64_t current_tick() const { return std::uint64_t((clock::now() - _start) / _resolution); }
+
+    inline timer_handle schedule(details::timer_node* node, clock::time_point deadline) {
+        timer_handle handle(node);
+        {
+            std::lock_guard<std::mutex> _l(_lock);
+            node->expiry = ticks_ceil(deadline - _start);
+            insert(node);
+        }
+        return handle;
+    }
+
+    // under the lock, wake up the timer thread if the timer comes before its next wake up
+    inline void insert(details::timer_node* node) {
+        if (_shutdown) {
+            node->cancel();
+            node->release();
+            return;
+        }
+        _wheel.insert(node);
+        if (node->expiry < _next_wake) {
+            _next_wake = node->expiry;
+            _wake.notify_one();
+        }
+    }
+
+    // periodic timer after its execution, takes the reference of the runner
+    inline void reschedule(details::timer_node* node) {
+        std::lock_guard<std::mutex> _l(_lock);
+        const std::uint64_t now = current_tick();
+        if (node->expiry + node->period <= now) {
+            node->expiry += ((now - node->expiry) / node->period + 1) * node->period;
+        } else {
+            node->expiry += node->period;
+        }
+        insert(node);
+        finish_execution();
+    }
+
+    inline void execution_done() {
+        std::lock_guard<std::mutex> _l(_lock);
+        finish_execution();
+    }
+
+    inline void finish_execution() {
+        if (--_submitted == 0 && _shutdown) {
+            _submitted_done.notify_all();
+        }
+    }
+
+    inline void run() {
+        std::vector<details::timer_node*> due;
+        std::unique_lock<std::mutex> _l(_lock);
+
+        while (_shutdown == false) {
+            _wheel.advance(current_tick(), due);
+
+            if (due.empty() == false) {
+                _submitted += due.size();
+                _l.unlock();
+                for (details::timer_node* node : due) {
+                    _exec.execute(timer_runner(this, node));
+                }
+                due.clear();
+                _l.lock();
+                continue;
+            }
+
+            // park until the next tick with work, or an earlier insertion
+            _next_wake = _wheel.next_tick();
+            if (_next_wake == details::timer_wheel::no_tick) {
+                _wake.wait(_l);
+            } else {
+                _wake.wait_until(_l, _start + _resolution * std::int64_t(_next_wake));
+            }
+        }
+        _next_wake = details::timer_wheel::no_tick;
+    }
+
+    Executor& _exec;
+    const clock::duration _resolution;
+    const clock::time_point _start;
+
+    mutable std::mutex _lock;
+    std::condition_variable _wake;
+    details::timer_wheel _wheel;
+    std::uint64_t _next_wake;
+    bool _shutdown;
+
+    std::size_t _submitted;
+    std::condition_variable _submitted_done;
+
+    std::thread _timer_thread;
+};
+
+
+/// timer service on the default thread pool
+using timer_service = basic_timer_service<thread_pool_executor>;
+
+
+} // namespace hadoken
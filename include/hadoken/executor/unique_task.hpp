@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef HADOKEN_UNIQUE_TASK_HPP
+#define HADOKEN_UNIQUE_TASK_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace hadoken {
+
+///
+/// \brief move-only type erased void() callable
+///
+/// replacement of std::function<void()> for the executors:
+/// callables up to inline_size bytes are stored inline without allocation,
+/// the task does not need to be copyable
+///
+class unique_task {
+  public:
+    static constexpr std::size_t inline_size = 48;
+
+    inline unique_task() noexcept : _vtable(nullptr) {}
+
+    template <typename Function,
+              typename = typename std::enable_if<!std::is_same<typename std::decay<Function>::type, unique_task>::value>::type>
+    inline unique_task(Function&& fun) : _vtable(nullptr) {
+        using fun_type = typename std::decay<Function>::type;
+        __construct<fun_type>(std::forward<Function>(fun), std::integral_constant<bool, is_inline<fun_type>::value>());
+    }
+
+    inline unique_task(unique_task&& other) noexcept : _vtable(other._vtable) {
+        if (_vtable != nullptr) {
+            _vtable->move(&_storage, &other._storage);
+            other._vtable = nullptr;
+        }
+    }
+
+    inline unique_task& operator=(unique_task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other._vtable != nullptr) {
+                other._vtable->move(&_storage, &other._storage);
+                _vtable = other._vtable;
+                other._vtable = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    inline ~unique_task() { reset(); }
+
+    inline void operator()() { _vtable->invoke(&_storage); }
+
+    inline explicit operator bool() const noexcept { return _vtable != nullptr; }
+
+    inline void reset() noexcept {
+        if (_vtable != nullptr) {
+            _vtable->destroy(&_storage);
+            _vtable = nullptr;
+        }
+    }
+
+    /// true if a callable of type Function is stored without allocation
+    template <typename Function>
+    struct is_inline : std::integral_constant<bool, (sizeof(Function) <= inline_size) &&
+                                                        (alignof(Function) <= alignof(std::max_align_t)) &&
+                                                        std::is_nothrow_move_constructible<Function>::value> {};
+
+  private:
+    unique_task(const unique_task&) = delete;
+    unique_task& operator=(const unique_task&) = delete;
+
+    using storage_type = typename std::aligned_storage<inline_size, alignof(std::max_align_t)>::type;
+
+    struct vtable {
+        void (*invoke)(void*);
+        void (*move)(void*, void*);
+        void (*destroy)(void*);
+    };
+
+    // callable stored in the inline buffer
+    template <typename Function>
+    struct inline_ops {
+        static void invoke(void* storage) { (*static_cast<Function*>(storage))(); }
+
+        static void move(void* dst, void* src) {
+            new (dst) Function(std::move(*static_cast<Function*>(src)));
+            static_cast<Function*>(src)->~Function();
+        }
+
+        static void destroy(void* storage) { static_cast<Function*>(storage)->~Function(); }
+
+        static const vtable table;
+    };
+
+    // callable too large for the inline buffer, stored on the heap
+    template <typename Function>
+    struct heap_ops {
+        static void invoke(void* storage) { (**static_cast<Function**>(storage))(); }
+
+        static void move(void* dst, void* src) { new (dst) Function*(*static_cast<Function**>(src)); }
+
+        static void destroy(void* storage) { delete *static_cast<Function**>(storage); }
+
+        static const vtable table;
+    };
+
+    template <typename FunType, typename Function>
+    inline void __construct(Function&& fun, std::true_type) {
+        new (&_storage) FunType(std::forward<Function>(fun));
+        _vtable = &inline_ops<FunType>::table;
+    }
+
+    template <typename FunType, typename Function>
+    inline void __construct(Function&& fun, std::false_type) {
+        new (&_storage) FunType*(new FunType(std::forward<Function>(fun)));
+        _vtable = &heap_ops<FunType>::table;
+    }
+
+    storage_type _storage;
+    const vtable* _vtable;
+};
+
+
+template <typename Function>
+const unique_task::vtable unique_task::inline_ops<Function>::table = {&invoke, &move, &destroy};
+
+template <typename Function>
+const unique_task::vtable unique_task::heap_ops<Function>::table = {&invoke, &move, &destroy};
+
+
+} // namespace hadoken
+
+#endif // HADOKEN_UNIQUE_TASK_HPP
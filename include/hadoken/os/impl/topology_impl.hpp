@@ -0,0 +1,224 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include "../topology.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+namespace hadoken {
+
+namespace topology_impl {
+
+inline bool read_sys_file(const std::string& path, std::string& content) {
+    std::ifstream file(path.c_str());
+    if (!file) {
+        return false;
+    }
+    std::getline(file, content);
+    return true;
+}
+
+// cache size from /sys/devices/system/cpu/cpu0/cache, format "2048K"
+inline std::size_t sys_cache_size(unsigned int level) {
+    for (int index = 0; index < 16; ++index) {
+        std::ostringstream cache_dir;
+        cache_dir << "/sys/devices/system/cpu/cpu0/cache/index" << index << "/";
+
+        std::string cache_level, cache_type, cache_size;
+        if (!read_sys_file(cache_dir.str() + "level", cache_level)) {
+            break;
+        }
+
+        if (std::strtoul(cache_level.c_str(), nullptr, 10) != level || !read_sys_file(cache_dir.str() + "type", cache_type) ||
+            cache_type == "Instruction" || !read_sys_file(cache_dir.str() + "size", cache_size)) {
+            continue;
+        }
+
+        char* unit = nullptr;
+        std::size_t size = std::strtoul(cache_size.c_str(), &unit, 10);
+        if (unit != nullptr && (*unit == 'K' || *unit == 'k')) {
+            size *= 1024;
+        } else if (unit != nullptr && *unit == 'M') {
+            size *= 1024 * 1024;
+        }
+        return size;
+    }
+    return 0;
+}
+
+// parse a cpu or node list of the form "0-3,8,10-11"
+inline std::vector<std::size_t> parse_id_list(const std::string& list) {
+    std::vector<std::size_t> ids;
+    const char* pos = list.c_str();
+
+    while (*pos != '\0') {
+        char* end = nullptr;
+        const std::size_t first = std::strtoul(pos, &end, 10);
+        if (end == pos) {
+            break;
+        }
+
+        std::size_t last = first;
+        pos = end;
+        if (*pos == '-') {
+            last = std::strtoul(pos + 1, &end, 10);
+            pos = end;
+        }
+
+        for (std::size_t id = first; id <= last; ++id) {
+            ids.push_back(id);
+        }
+
+        if (*pos == ',') {
+            ++pos;
+        } else {
+            break;
+        }
+    }
+    return ids;
+}
+
+// keep only the cpus of the affinity mask of the process, e.g. restricted by a cgroup
+inline std::vector<std::size_t> allowed_cpus(const std::vector<std::size_t>& cpus) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return cpus;
+    }
+
+    std::vector<std::size_t> res;
+    for (std::size_t cpu : cpus) {
+        if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+            res.push_back(cpu);
+        }
+    }
+    return res;
+#else
+    return cpus;
+#endif
+}
+
+} // namespace topology_impl
+
+
+std::size_t get_cache_size(unsigned int level) {
+    long size = -1;
+
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+    switch (level) {
+    case 1:
+        size = ::sysconf(_SC_LEVEL1_DCACHE_SIZE);
+        break;
+    case 2:
+        size = ::sysconf(_SC_LEVEL2_CACHE_SIZE);
+        break;
+    case 3:
+        size = ::sysconf(_SC_LEVEL3_CACHE_SIZE);
+        break;
+    default:
+        break;
+    }
+#endif
+
+    if (size > 0) {
+        return std::size_t(size);
+    }
+    return topology_impl::sys_cache_size(level);
+}
+
+
+std::vector<numa_node> get_numa_nodes() {
+    std::vector<numa_node> nodes;
+    std::string node_list;
+
+    if (topology_impl::read_sys_file("/sys/devices/system/node/online", node_list)) {
+        for (std::size_t id : topology_impl::parse_id_list(node_list)) {
+            std::ostringstream cpu_list_path;
+            cpu_list_path << "/sys/devices/system/node/node" << id << "/cpulist";
+
+            std::string cpu_list;
+            if (!topology_impl::read_sys_file(cpu_list_path.str(), cpu_list)) {
+                continue;
+            }
+
+            // memory only nodes are not reported
+            numa_node node{id, topology_impl::allowed_cpus(topology_impl::parse_id_list(cpu_list))};
+            if (node.cpus.empty() == false) {
+                nodes.push_back(std::move(node));
+            }
+        }
+    }
+
+    if (nodes.empty()) {
+        std::vector<std::size_t> cpus(std::max<std::size_t>(1, std::thread::hardware_concurrency()));
+        for (std::size_t cpu = 0; cpu < cpus.size(); ++cpu) {
+            cpus[cpu] = cpu;
+        }
+
+        std::vector<std::size_t> usable_cpus = topology_impl::allowed_cpus(cpus);
+        nodes.push_back(numa_node{0, usable_cpus.empty() ? cpus : usable_cpus});
+    }
+    return nodes;
+}
+
+
+bool set_current_thread_affinity(const std::vector<std::size_t>& cpus) {
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    for (std::size_t cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpu_set);
+        }
+    }
+
+    if (CPU_COUNT(&cpu_set) == 0) {
+        return false;
+    }
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+
+} // namespace hadoken
@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+
+namespace hadoken {
+
+///
+/// return the size in bytes of the data or unified cache of the given level (1, 2 or 3)
+/// of the current processor, 0 if unknown
+///
+inline std::size_t get_cache_size(unsigned int level);
+
+
+///
+/// a NUMA node and its logical cpus
+///
+struct numa_node {
+    /// node number, as in /sys/devices/system/node/node<id>
+    std::size_t id;
+    /// logical cpus of the node usable by the process
+    std::vector<std::size_t> cpus;
+};
+
+///
+/// return the NUMA nodes with at least one cpu usable by the process, discovered from /sys/devices/system/node.
+/// Without NUMA information the machine is a single node 0
+///
+inline std::vector<numa_node> get_numa_nodes();
+
+///
+/// pin the calling thread to a set of logical cpus
+/// return false if the system does not support or refuses the placement
+///
+inline bool set_current_thread_affinity(const std::vector<std::size_t>& cpus);
+
+
+} // namespace hadoken
+
+
+#include "impl/topology_impl.hpp"
@@ -30,6 +30,10 @@
 #define _HADOKEN_PARALLEL_ALGORITHM_HPP_
 
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
 
 
 namespace hadoken {
@@ -37,18 +41,121 @@ namespace hadoken {
 
 namespace parallel {
 
+///
+/// execution parameters
+///
+
+/// chunking strategy of a parallel algorithm
+enum class chunking_strategy {
+    /// one contiguous slice per thread
+    static_chunk = 0,
+    /// threads claim chunks of grain size from a shared counter
+    dynamic_chunk = 1,
+    /// same as dynamic with chunks decreasing from remaining / ( 2 * threads ) to the grain size
+    guided_chunk = 2
+};
+
+/// number of threads used by an algorithm, 0: all threads available
+class threads {
+  public:
+    explicit constexpr threads(std::size_t n) : value(n) {}
+
+    std::size_t value;
+};
+
+/// minimum number of elements processed by a task, inputs smaller than two grains run serially
+class grain {
+  public:
+    explicit constexpr grain(std::size_t n) : value(n) {}
+
+    std::size_t value;
+};
+
+/// chunking strategy used by an algorithm
+class chunking {
+  public:
+    explicit constexpr chunking(chunking_strategy s) : value(s) {}
+
+    chunking_strategy value;
+};
+
+constexpr chunking static_chunking{chunking_strategy::static_chunk};
+
+constexpr chunking dynamic_chunking{chunking_strategy::dynamic_chunk};
+
+constexpr chunking guided_chunking{chunking_strategy::guided_chunk};
+
+
+///
+/// \brief set of execution parameters carried by a policy
+///
+/// policy.with(grain(4096), threads(8), dynamic_chunking) returns a copy of
+/// the policy with the given parameters
+///
+template <typename Policy>
+class execution_parameters {
+  public:
+    static constexpr std::size_t default_grain = 64;
+
+    constexpr execution_parameters() : _threads(0), _grain(default_grain), _chunking(chunking_strategy::static_chunk) {}
+
+    template <typename... Parameters>
+    inline Policy with(const Parameters&... params) const {
+        Policy res(static_cast<const Policy&>(*this));
+        res.apply(params...);
+        return res;
+    }
+
+    constexpr std::size_t get_threads() const { return _threads; }
+
+    constexpr std::size_t get_grain() const { return _grain; }
+
+    constexpr chunking_strategy get_chunking() const { return _chunking; }
+
+  private:
+    inline void apply() {}
+
+    template <typename... Parameters>
+    inline void apply(const threads& t, const Parameters&... params) {
+        _threads = t.value;
+        apply(params...);
+    }
+
+    template <typename... Parameters>
+    inline void apply(const grain& g, const Parameters&... params) {
+        _grain = (g.value > 0) ? g.value : 1;
+        apply(params...);
+    }
+
+    template <typename... Parameters>
+    inline void apply(const chunking& c, const Parameters&... params) {
+        _chunking = c.value;
+        apply(params...);
+    }
+
+    std::size_t _threads, _grain;
+    chunking_strategy _chunking;
+};
+
+template <typename Policy>
+constexpr std::size_t execution_parameters<Policy>::default_grain;
+
+
 ///
 /// basic policies
 ///
 
 /// sequential execution, no parallelism
-class sequential_execution_policy {};
+class sequential_execution_policy : public execution_parameters<sequential_execution_policy> {};
 
 /// parallel execution allowed
-class parallel_execution_policy {};
+class parallel_execution_policy : public execution_parameters<parallel_execution_policy> {};
 
 /// parallel execution allowed, vector execution allowed
-class parallel_vector_execution_policy {};
+class parallel_vector_execution_policy : public execution_parameters<parallel_vector_execution_policy> {};
+
+/// vector execution allowed on the calling thread, no parallelism
+class unsequenced_policy : public execution_parameters<unsequenced_policy> {};
 
 /// constexpr for sequential execution
 constexpr sequential_execution_policy seq{};
@@ -59,18 +166,76 @@ constexpr parallel_execution_policy par{};
 /// constexpr for parallel vector execution
 constexpr parallel_vector_execution_policy par_vec{};
 
+/// constexpr for vector execution
+constexpr unsequenced_policy unseq{};
+
 ///
 /// Extended policies
 ///
+
+///
+/// \brief parallel execution on a given executor
+///
+/// the algorithms run on the executor held by the policy instead of the system_executor,
+/// e.g a dedicated thread_pool_executor or an inline_executor
+///
 template <typename Executor>
-class parallel_shared_exec_policy {
+class parallel_shared_exec_policy : public execution_parameters<parallel_shared_exec_policy<Executor>> {
   public:
+    using executor_type = Executor;
+
     inline parallel_shared_exec_policy(std::shared_ptr<Executor> executor) : _exec(std::move(executor)) {}
 
+    inline Executor& get_executor() const { return *_exec; }
+
   protected:
     std::shared_ptr<Executor> _exec;
 };
 
+/// create a parallel policy bound to executor
+template <typename Executor>
+inline parallel_shared_exec_policy<Executor> par_on(std::shared_ptr<Executor> executor) {
+    return parallel_shared_exec_policy<Executor>(std::move(executor));
+}
+
+///
+/// index spaces
+///
+
+/// Extension: extents of a 1D, 2D or 3D index space, row major: the last dimension is the contiguous one
+class extents {
+  public:
+    explicit constexpr extents(std::size_t n0) : _dims{n0, 1, 1}, _rank(1) {}
+
+    constexpr extents(std::size_t n0, std::size_t n1) : _dims{n0, n1, 1}, _rank(2) {}
+
+    constexpr extents(std::size_t n0, std::size_t n1, std::size_t n2) : _dims{n0, n1, n2}, _rank(3) {}
+
+    /// number of dimensions
+    constexpr std::size_t rank() const { return _rank; }
+
+    /// size of a dimension, 1 for the dimensions after the rank
+    constexpr std::size_t operator[](std::size_t dim) const { return _dims[dim]; }
+
+    /// number of indices in the space
+    constexpr std::size_t size() const { return _dims[0] * _dims[1] * _dims[2]; }
+
+  private:
+    std::size_t _dims[3];
+    std::size_t _rank;
+};
+
+/// Extension: shape of the tiles processed by a task of for_index, clamped to the index space
+class tile_shape : public extents {
+  public:
+    using extents::extents;
+};
+
+/// Extension: tile shape of a space where each index touches bytes_per_index bytes, a tile fits in half of
+/// cache_bytes and keeps the contiguous dimension as long as possible. cache_bytes = 0 uses the L2 cache size
+inline tile_shape cache_tile(const extents& space, std::size_t bytes_per_index, std::size_t cache_bytes = 0);
+
+
 ///
 /// algorithms
 ///
@@ -80,7 +245,7 @@ class parallel_shared_exec_policy {
 template <typename ExecPolicy, typename Iterator, typename Function>
 inline void for_each(ExecPolicy&& policy, Iterator begin_it, Iterator end_it, Function fun);
 
-/// parallel fill algorithm
+/// parallel fill algorithm, always with static chunking: first touch friendly
 template <typename ExecPolicy, class ForwardIterator, class T>
 void fill(ExecPolicy&& policy, ForwardIterator first, ForwardIterator last, const T& val);
 
@@ -88,14 +253,25 @@ void fill(ExecPolicy&& policy, ForwardIterator first, ForwardIterator last, cons
 template <typename ExecPolicy, class ForwardIterator, class Size, class T>
 void fill_n(ExecPolicy&& policy, ForwardIterator first, Size n, const T& val);
 
-/// parallel generate algorithm
+/// parallel generate algorithm, g is called concurrently and has to be thread safe:
+/// see generate_random for random number generators
 template <class ExecutionPolicy, class ForwardIt, class Generator>
 void generate(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, Generator g);
 
-/// parallel generate_n algorithm
+/// parallel generate_n algorithm, return the iterator past the last generated element
 template <class ExecutionPolicy, class OutputIt, class Size, class Generator>
 OutputIt generate_n(ExecutionPolicy&& policy, OutputIt first, Size count, Generator g);
 
+/// Extension: fill [first, last) with random numbers of distribution dist
+///
+/// the range is divided in fixed blocks of indices, each block is generated from its own
+/// sub-stream engine.derivate(block index), e.g. counter_engine<threefry4x64>. The result depends only
+/// on the engine state and on the index of each element: it is bit-identical for any policy and any
+/// number of threads. The engine is not modified
+template <class ExecutionPolicy, class ForwardIt, class Engine, class Distribution>
+void generate_random(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, const Engine& engine,
+                     const Distribution& dist);
+
 
 
 /// parallel transform algorithm binary
@@ -109,6 +285,69 @@ OutputIt transform(ExecutionPolicy&& policy, InputIt first1, InputIt last1, Outp
 
 
 
+/// parallel copy algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt>
+OutputIt copy(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first);
+
+/// parallel copy_n algorithm
+template <class ExecutionPolicy, class InputIt, class Size, class OutputIt>
+OutputIt copy_n(ExecutionPolicy&& policy, InputIt first, Size count, OutputIt d_first);
+
+/// parallel copy_if algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt, class UnaryPredicate>
+OutputIt copy_if(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, UnaryPredicate p);
+
+/// parallel move algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt>
+OutputIt move(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first);
+
+/// parallel remove algorithm
+template <class ExecutionPolicy, class ForwardIt, class T>
+ForwardIt remove(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, const T& value);
+
+/// parallel remove_if algorithm
+template <class ExecutionPolicy, class ForwardIt, class UnaryPredicate>
+ForwardIt remove_if(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, UnaryPredicate p);
+
+/// parallel replace algorithm
+template <class ExecutionPolicy, class ForwardIt, class T>
+void replace(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, const T& old_value, const T& new_value);
+
+/// parallel replace_if algorithm
+template <class ExecutionPolicy, class ForwardIt, class UnaryPredicate, class T>
+void replace_if(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, UnaryPredicate p, const T& new_value);
+
+/// parallel partition algorithm
+template <class ExecutionPolicy, class BidirIt, class UnaryPredicate>
+BidirIt partition(ExecutionPolicy&& policy, BidirIt first, BidirIt last, UnaryPredicate p);
+
+/// parallel stable_partition algorithm
+template <class ExecutionPolicy, class BidirIt, class UnaryPredicate>
+BidirIt stable_partition(ExecutionPolicy&& policy, BidirIt first, BidirIt last, UnaryPredicate p);
+
+/// parallel partition_copy algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt1, class OutputIt2, class UnaryPredicate>
+std::pair<OutputIt1, OutputIt2> partition_copy(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt1 d_first_true,
+                                               OutputIt2 d_first_false, UnaryPredicate p);
+
+/// parallel unique algorithm
+template <class ExecutionPolicy, class ForwardIt>
+ForwardIt unique(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last);
+
+/// parallel unique algorithm with binary predicate
+template <class ExecutionPolicy, class ForwardIt, class BinaryPredicate>
+ForwardIt unique(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, BinaryPredicate p);
+
+/// parallel unique_copy algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt>
+OutputIt unique_copy(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first);
+
+/// parallel unique_copy algorithm with binary predicate
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryPredicate>
+OutputIt unique_copy(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, BinaryPredicate p);
+
+
+
 /// parallel all_of algorithm
 template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
 inline bool all_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p);
@@ -121,6 +360,28 @@ inline bool any_of(ExecutionPolicy&& policy, InputIterator first, InputIterator
 template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
 inline bool none_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p);
 
+/// parallel find algorithm, return the leftmost match
+template <class ExecutionPolicy, class InputIterator, class T>
+inline InputIterator find(ExecutionPolicy&& policy, InputIterator first, InputIterator last, const T& value);
+
+/// parallel find_if algorithm, return the leftmost match
+template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
+inline InputIterator find_if(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p);
+
+/// parallel find_if_not algorithm, return the leftmost match
+template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
+inline InputIterator find_if_not(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p);
+
+/// parallel find_first_of algorithm, return the leftmost match
+template <class ExecutionPolicy, class InputIterator, class ForwardIterator>
+inline InputIterator find_first_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, ForwardIterator s_first,
+                                   ForwardIterator s_last);
+
+/// parallel find_first_of algorithm with binary predicate, return the leftmost match
+template <class ExecutionPolicy, class InputIterator, class ForwardIterator, class BinaryPredicate>
+inline InputIterator find_first_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, ForwardIterator s_first,
+                                   ForwardIterator s_last, BinaryPredicate p);
+
 
 
 
@@ -132,6 +393,55 @@ void sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last);
 template <class ExecutionPolicy, class RandomIt, class Compare>
 void sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last, Compare comp);
 
+/// stable sort algorithm
+template <class ExecutionPolicy, class RandomIt>
+void stable_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last);
+
+/// stable sort algorithm with comparator
+template <class ExecutionPolicy, class RandomIt, class Compare>
+void stable_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last, Compare comp);
+
+/// parallel merge algorithm, merge path partitioning
+template <class ExecutionPolicy, class InputIt1, class InputIt2, class OutputIt>
+OutputIt merge(ExecutionPolicy&& policy, InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, OutputIt d_first);
+
+/// parallel merge algorithm with comparator
+template <class ExecutionPolicy, class InputIt1, class InputIt2, class OutputIt, class Compare>
+OutputIt merge(ExecutionPolicy&& policy, InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, OutputIt d_first,
+               Compare comp);
+
+/// parallel inplace_merge algorithm
+template <class ExecutionPolicy, class BidirIt>
+void inplace_merge(ExecutionPolicy&& policy, BidirIt first, BidirIt middle, BidirIt last);
+
+/// parallel inplace_merge algorithm with comparator
+template <class ExecutionPolicy, class BidirIt, class Compare>
+void inplace_merge(ExecutionPolicy&& policy, BidirIt first, BidirIt middle, BidirIt last, Compare comp);
+
+/// parallel nth_element algorithm
+template <class ExecutionPolicy, class RandomIt>
+void nth_element(ExecutionPolicy&& policy, RandomIt first, RandomIt nth, RandomIt last);
+
+/// parallel nth_element algorithm with comparator
+template <class ExecutionPolicy, class RandomIt, class Compare>
+void nth_element(ExecutionPolicy&& policy, RandomIt first, RandomIt nth, RandomIt last, Compare comp);
+
+/// parallel partial_sort algorithm
+template <class ExecutionPolicy, class RandomIt>
+void partial_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt middle, RandomIt last);
+
+/// parallel partial_sort algorithm with comparator
+template <class ExecutionPolicy, class RandomIt, class Compare>
+void partial_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt middle, RandomIt last, Compare comp);
+
+/// Extension: LSD radix sort for integral and floating point values, stable
+template <class ExecutionPolicy, class RandomIt>
+void radix_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last);
+
+/// Extension: LSD radix sort, ordered by the integral or floating point key_extractor(value), stable
+template <class ExecutionPolicy, class RandomIt, class KeyExtractor>
+void radix_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last, KeyExtractor key_extractor);
+
 
 
 ///
@@ -144,6 +454,62 @@ OutputIt inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, O
 template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryOperation>
 OutputIt inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, BinaryOperation binary_op);
 
+/// inclusive scan algorithm binary op and initial value
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryOperation, class T>
+OutputIt inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, BinaryOperation binary_op,
+                        T init);
+
+/// exclusive scan algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt, class T>
+OutputIt exclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, T init);
+
+/// exclusive scan algorithm binary op
+template <class ExecutionPolicy, class InputIt, class OutputIt, class T, class BinaryOperation>
+OutputIt exclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, T init,
+                        BinaryOperation binary_op);
+
+/// transform inclusive scan algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryOperation, class UnaryOperation>
+OutputIt transform_inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first,
+                                  BinaryOperation binary_op, UnaryOperation unary_op);
+
+/// transform inclusive scan algorithm with initial value
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryOperation, class UnaryOperation, class T>
+OutputIt transform_inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first,
+                                  BinaryOperation binary_op, UnaryOperation unary_op, T init);
+
+/// transform exclusive scan algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt, class T, class BinaryOperation, class UnaryOperation>
+OutputIt transform_exclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, T init,
+                                  BinaryOperation binary_op, UnaryOperation unary_op);
+
+
+
+/// reduce algorithm
+template <class ExecutionPolicy, class ForwardIt>
+typename std::iterator_traits<ForwardIt>::value_type reduce(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last);
+
+/// reduce algorithm with initial value
+template <class ExecutionPolicy, class ForwardIt, class T>
+T reduce(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, T init);
+
+/// reduce algorithm binary op
+template <class ExecutionPolicy, class ForwardIt, class T, class BinaryOp>
+T reduce(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, T init, BinaryOp binary_op);
+
+/// transform reduce algorithm, inner product of two ranges
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2, class T>
+T transform_reduce(ExecutionPolicy&& policy, ForwardIt1 first1, ForwardIt1 last1, ForwardIt2 first2, T init);
+
+/// transform reduce algorithm on two ranges
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2, class T, class BinaryReductionOp, class BinaryTransformOp>
+T transform_reduce(ExecutionPolicy&& policy, ForwardIt1 first1, ForwardIt1 last1, ForwardIt2 first2, T init,
+                   BinaryReductionOp reduce_op, BinaryTransformOp transform_op);
+
+/// transform reduce algorithm
+template <class ExecutionPolicy, class ForwardIt, class T, class BinaryReductionOp, class UnaryTransformOp>
+T transform_reduce(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, T init, BinaryReductionOp reduce_op,
+                   UnaryTransformOp transform_op);
 
 
 /// Extension: for_range_ algorithm
@@ -153,6 +519,18 @@ OutputIt inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, O
 template <typename ExecPolicy, typename Iterator, typename RangeFunction>
 inline void for_range(ExecPolicy&& policy, Iterator begin_it, Iterator end_it, RangeFunction fun);
 
+/// Extension: for_index algorithm
+///
+/// call fun(i, j, k) for every index of a 1D, 2D or 3D space, fun(i, j) and fun(i) are accepted for
+/// spaces of lower rank. The space is cut in tiles processed by one task each, cache_tile(space, sizeof(double))
+/// by default. Inside a tile, the last index is contiguous and vectorized with par_vec and unseq
+template <typename ExecPolicy, typename IndexFunction>
+inline void for_index(ExecPolicy&& policy, const extents& space, IndexFunction fun);
+
+/// Extension: for_index algorithm with a given tile shape
+template <typename ExecPolicy, typename IndexFunction>
+inline void for_index(ExecPolicy&& policy, const extents& space, const tile_shape& tile, IndexFunction fun);
+
 } // namespace parallel
 
 
@@ -29,8 +29,14 @@
 #ifndef _HADOKEN_OMP_ALGORITHM_BITS_HPP_
 #define _HADOKEN_OMP_ALGORITHM_BITS_HPP_
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <exception>
 #include <iterator>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <type_traits>
 
@@ -38,14 +44,10 @@
 #include <hadoken/containers/small_vector.hpp>
 #include <hadoken/executor/system_executor.hpp>
 #include <hadoken/parallel/algorithm.hpp>
-#include <hadoken/thread/latch.hpp>
 #include <hadoken/utility/range.hpp>
 
-#include <hadoken/parallel/bits/parallel_algorithm_generics.hpp>
-#include <hadoken/parallel/bits/parallel_none_any_all_generic.hpp>
-#include <hadoken/parallel/bits/parallel_numeric_generic.hpp>
-#include <hadoken/parallel/bits/parallel_sort_generic.hpp>
-#include <hadoken/parallel/bits/parallel_transform_generic.hpp>
+#include <hadoken/parallel/bits/parallel_generic_utils.hpp>
+#include <hadoken/parallel/bits/parallel_simd_utils.hpp>
 
 
 namespace hadoken {
@@ -57,54 +59,252 @@ namespace parallel {
 class sequential_execution_policy;
 class parallel_execution_policy;
 class parallel_vector_execution_policy;
+class unsequenced_policy;
 
 
 
 namespace detail {
 
-inline int __get_number_executor() {
+// detect executors providing bulk_sync_execute( n, f(i) )
+template <typename Executor, typename = void>
+struct __has_bulk_sync_execute : std::false_type {};
+
+template <typename Executor>
+struct __has_bulk_sync_execute<Executor, decltype(std::declval<Executor&>().bulk_sync_execute(
+                                             std::size_t(0), std::declval<void (*)(std::size_t)>()))> : std::true_type {};
+
+// detect executors exposing their number of threads
+template <typename Executor, typename = void>
+struct __has_size : std::false_type {};
+
+template <typename Executor>
+struct __has_size<Executor, decltype(void(std::declval<const Executor&>().size()))> : std::true_type {};
+
+
+// number of hardware threads, queried once: the query reads the system configuration at each call
+inline std::size_t __hardware_threads() {
+    static const std::size_t hw_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    return hw_threads;
+}
+
+
+template <typename Executor>
+inline std::size_t __executor_size(const Executor& executor, std::true_type) {
+    return std::max<std::size_t>(1, executor.size());
+}
+
+template <typename Executor>
+inline std::size_t __executor_size(const Executor&, std::false_type) {
+    return __hardware_threads();
+}
+
+
+template <typename ExecPolicy>
+inline std::size_t __get_number_executor(const ExecPolicy& policy) {
 #ifndef __HADOKEN_ALGORITHM_ENFORCE_SERIAL
-    // TODO : should be configurable parameter, extracted from execution_policy
-    return std::thread::hardware_concurrency();
+    return (policy.get_threads() > 0) ? policy.get_threads() : __hardware_threads();
 #else
+    (void)policy;
     return 1;
 #endif
 }
 
-template <typename Function>
-inline void __execute_grid(int num_executor, Function fun) {
+template <typename Executor>
+inline std::size_t __get_number_executor(const parallel_shared_exec_policy<Executor>& policy) {
 #ifndef __HADOKEN_ALGORITHM_ENFORCE_SERIAL
+    const Executor& executor = policy.get_executor();
+    return (policy.get_threads() > 0) ? policy.get_threads()
+                                      : __executor_size(executor, __has_size<Executor>());
+#else
+    (void)policy;
+    return 1;
+#endif
+}
 
-    system_executor sys_exec;
-    std::vector<std::future<void>> futures;
 
+// one batch submission for the whole grid, the calling thread executes slices too
+// and runs them inline if no worker is available, nested calls do not deadlock
+template <typename Executor, typename Function>
+inline void __execute_grid_on(Executor& executor, int num_executor, Function& fun, std::true_type) {
+    executor.bulk_sync_execute(std::size_t(num_executor), [num_executor, &fun](std::size_t id) { fun(int(id), num_executor); });
+}
 
+// slices of a grid shared between the calling thread and the submitted tasks,
+// lives on the heap as long as a submitted task can still reach it
+template <typename Function>
+struct __grid_state {
+    __grid_state(Function& f, int n) : fun(&f), num_executor(n), next(0), completed(0), error() {}
+
+    // claim and execute slices until none are left
+    void run_slices() {
+        int id;
+        while ((id = next.fetch_add(1, std::memory_order_relaxed)) < num_executor) {
+            std::exception_ptr slice_error;
+            try {
+                (*fun)(id, num_executor);
+            } catch (...) {
+                slice_error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mtx);
+            if (slice_error && !error) {
+                error = slice_error;
+            }
+            if (++completed == num_executor) {
+                cond.notify_all();
+            }
+        }
+    }
 
-    for (int id = 0; id < num_executor; ++id) {
-        futures.emplace_back(std::move(sys_exec.twoway_execute([id, num_executor, &fun] { return fun(id, num_executor); })));
+    // wait for the slices claimed by other threads, all slices must be claimed
+    void wait() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cond.wait(lock, [this] { return completed == num_executor; });
     }
 
-    for (auto& f : futures) {
-        f.get();
+    Function* fun;
+    const int num_executor;
+    std::atomic<int> next;
+    int completed;
+    std::exception_ptr error;
+    std::mutex mtx;
+    std::condition_variable cond;
+};
+
+// generic executor: one task per slice, the calling thread claims slices too and only waits
+// for the ones already started, a task scheduled too late finds nothing to do.
+// Nested calls on a busy executor run inline and do not deadlock
+template <typename Executor, typename Function>
+inline void __execute_grid_on(Executor& executor, int num_executor, Function& fun, std::false_type) {
+    std::shared_ptr<__grid_state<Function>> state = std::make_shared<__grid_state<Function>>(fun, num_executor);
+
+    try {
+        for (int id = 1; id < num_executor; ++id) {
+            executor.execute([state]() { state->run_slices(); });
+        }
+    } catch (...) {
+        // the slices left are executed by the calling thread
     }
 
+    state->run_slices();
+    state->wait();
+
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+template <typename Executor, typename Function>
+inline void __execute_grid_on(Executor& executor, int num_executor, Function& fun) {
+#ifndef __HADOKEN_ALGORITHM_ENFORCE_SERIAL
+    __execute_grid_on(executor, num_executor, fun, __has_bulk_sync_execute<Executor>());
 #else
+    (void)executor;
     for (int id = 0; id < num_executor; ++id) {
         fun(id, num_executor);
     }
 #endif
 }
 
-/// for_each algorithm
-template <typename Iterator, typename Function>
-inline void _omp_parallel_for_range(Iterator begin_it, Iterator end_it, Function fun) {
-    range<Iterator> global_range(begin_it, end_it);
 
-    const int num_exec = __get_number_executor();
+/// execute fun(id, num_executor) for id in [0, num_executor) on the executor of the policy
+template <typename ExecPolicy, typename Function>
+inline void __execute_grid(const ExecPolicy& policy, int num_executor, Function fun) {
+    (void)policy;
+    system_executor sys_exec;
+    __execute_grid_on(sys_exec, num_executor, fun);
+}
 
-    __execute_grid(num_exec, [&](int id, int num_executor) {
-        range<Iterator> my_range = take_splice(global_range, id, num_executor);
-        fun(my_range.begin(), my_range.end());
+template <typename Executor, typename Function>
+inline void __execute_grid(const parallel_shared_exec_policy<Executor>& policy, int num_executor, Function fun) {
+    __execute_grid_on(policy.get_executor(), num_executor, fun);
+}
+
+
+// claim the next chunk of a dynamic or guided partition, return false once the range is exhausted
+inline bool __claim_chunk(std::atomic<std::size_t>& next, std::size_t n_elems, std::size_t n_workers, std::size_t grain,
+                          chunking_strategy strategy, std::size_t& chunk_begin, std::size_t& chunk_end) {
+    if (strategy == chunking_strategy::dynamic_chunk) {
+        chunk_begin = next.fetch_add(grain, std::memory_order_relaxed);
+        if (chunk_begin >= n_elems) {
+            return false;
+        }
+        chunk_end = std::min(n_elems, chunk_begin + grain);
+        return true;
+    }
+
+    // guided: large chunks first, the grain size at the end
+    chunk_begin = next.load(std::memory_order_relaxed);
+    while (chunk_begin < n_elems) {
+        const std::size_t chunk_size = std::max(grain, (n_elems - chunk_begin) / (2 * n_workers));
+        chunk_end = std::min(n_elems, chunk_begin + chunk_size);
+        if (next.compare_exchange_weak(chunk_begin, chunk_end, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// number of parts for n_elems elements, not worth to split in less than two grains
+template <typename ExecPolicy>
+inline std::size_t __get_partition_size(const ExecPolicy& policy, std::size_t n_elems) {
+    const std::size_t grain = std::max<std::size_t>(1, policy.get_grain());
+    return std::max<std::size_t>(1, std::min(__get_number_executor(policy), n_elems / grain));
+}
+
+
+///
+/// partition [begin_it, end_it) according to the execution parameters of the policy
+/// and execute fun(id, sub_begin, sub_end) on each part, id in [0, number of workers) identifies
+/// the worker executing the part. Parts processed by the same worker never run concurrently
+///
+template <typename ExecPolicy, typename Iterator, typename Function>
+inline void __parallel_for_range_id(const ExecPolicy& policy, Iterator begin_it, Iterator end_it, Function fun) {
+    const std::size_t n_elems = std::size_t(std::distance(begin_it, end_it));
+    const std::size_t grain = std::max<std::size_t>(1, policy.get_grain());
+    const std::size_t n_workers = __get_partition_size(policy, n_elems);
+
+    if (n_workers <= 1) {
+        fun(std::size_t(0), begin_it, end_it);
+        return;
+    }
+
+    const chunking_strategy strategy = policy.get_chunking();
+
+    if (strategy == chunking_strategy::static_chunk) {
+        range<Iterator> global_range(begin_it, end_it);
+
+        __execute_grid(policy, int(n_workers), [&](int id, int num_executor) {
+            range<Iterator> my_range = take_splice(global_range, id, num_executor);
+            fun(std::size_t(id), my_range.begin(), my_range.end());
+        });
+        return;
+    }
+
+    std::atomic<std::size_t> next(0);
+
+    __execute_grid(policy, int(n_workers), [&](int id, int) {
+        std::size_t chunk_begin = 0, chunk_end = 0;
+        while (__claim_chunk(next, n_elems, n_workers, grain, strategy, chunk_begin, chunk_end)) {
+            Iterator sub_begin = begin_it;
+            std::advance(sub_begin, chunk_begin);
+            Iterator sub_end = sub_begin;
+            std::advance(sub_end, chunk_end - chunk_begin);
+            fun(std::size_t(id), sub_begin, sub_end);
+        }
+    });
+}
+
+
+///
+/// partition [begin_it, end_it) according to the execution parameters of the policy
+/// and execute fun(sub_begin, sub_end) on each part
+///
+template <typename ExecPolicy, typename Iterator, typename Function>
+inline void __parallel_for_range(const ExecPolicy& policy, Iterator begin_it, Iterator end_it, Function fun) {
+    __parallel_for_range_id(policy, begin_it, end_it, [&fun](std::size_t, Iterator sub_begin, Iterator sub_end) {
+        fun(sub_begin, sub_end);
     });
 }
 
@@ -116,7 +316,7 @@ inline void _omp_parallel_for_range(Iterator begin_it, Iterator end_it, Function
 template <typename ExecPolicy, typename Iterator, typename RangeFunction>
 inline void for_range(ExecPolicy&& policy, Iterator begin_it, Iterator end_it, RangeFunction fun) {
     if (detail::is_parallel_policy(policy)) {
-        detail::_omp_parallel_for_range(begin_it, end_it, fun);
+        detail::__parallel_for_range(policy, begin_it, end_it, fun);
         return;
     }
 
@@ -129,30 +329,22 @@ typename std::iterator_traits<InputIterator>::difference_type count_if(Execution
                                                                        InputIterator last, UnaryPredicate p) {
 
     typedef typename std::iterator_traits<InputIterator>::difference_type counter_type;
+    using use_simd = detail::__use_simd<ExecutionPolicy, InputIterator>;
 
     static_assert(
         std::is_same<typename std::iterator_traits<InputIterator>::iterator_category, std::random_access_iterator_tag>::value,
         "parallel::count requires random_access_iterator");
 
     if (detail::is_parallel_policy(policy)) {
-
-        const std::size_t nelems = std::distance(first, last);
         std::atomic<uint64_t> counter(0);
 
-        const int number_executor = detail::__get_number_executor();
-
-        detail::__execute_grid(number_executor, [&](int id, int number_executor) {
-            std::size_t nelem_per_slice = nelems / number_executor;
-
-            InputIterator my_begin = first + (id * nelem_per_slice);
-            InputIterator my_end = (((id + 1) == number_executor) ? (last) : (my_begin + nelem_per_slice));
-
-            counter += std::count_if(my_begin, my_end, p);
+        for_range(policy, first, last, [&](InputIterator my_begin, InputIterator my_end) {
+            counter += uint64_t(detail::__count_if_block(my_begin, my_end, p, use_simd()));
         });
 
         return counter_type(counter.load());
     } else {
-        return std::count_if(first, last, p);
+        return counter_type(detail::__count_if_block(first, last, p, use_simd()));
     }
 }
 
@@ -176,4 +368,15 @@ typename std::iterator_traits<InputIterator>::difference_type count(ExecutionPol
 } // namespace hadoken
 
 
+// generic algorithms, built on top of for_range and the detail helpers above
+#include <hadoken/parallel/bits/parallel_algorithm_generics.hpp>
+#include <hadoken/parallel/bits/parallel_copy_generic.hpp>
+#include <hadoken/parallel/bits/parallel_for_index_generic.hpp>
+#include <hadoken/parallel/bits/parallel_none_any_all_generic.hpp>
+#include <hadoken/parallel/bits/parallel_numeric_generic.hpp>
+#include <hadoken/parallel/bits/parallel_radix_sort_generic.hpp>
+#include <hadoken/parallel/bits/parallel_sort_generic.hpp>
+#include <hadoken/parallel/bits/parallel_transform_generic.hpp>
+
+
 #endif
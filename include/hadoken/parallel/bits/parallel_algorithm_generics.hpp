@@ -30,10 +30,16 @@
 #define PARALLEL_ALGORITHM_GENERICS_BITS_HPP
 
 #include <algorithm>
+#include <iterator>
+#include <type_traits>
+
 #include <hadoken/parallel/algorithm.hpp>
+#include <hadoken/random/random_derivate.hpp>
 
 
+#include "parallel_for_index_generic.hpp"
 #include "parallel_generic_utils.hpp"
+#include "parallel_simd_utils.hpp"
 
 
 namespace hadoken {
@@ -45,22 +51,36 @@ namespace parallel {
 /// for_each algorithm
 template <typename ExecPolicy, typename Iterator, typename Function>
 inline void for_each(ExecPolicy&& policy, Iterator begin_it, Iterator end_it, Function fun) {
+    using use_simd = detail::__use_simd<ExecPolicy, Iterator>;
+
     if (detail::is_parallel_policy(policy)) {
-        for_range(std::forward<ExecPolicy>(policy), begin_it, end_it,
-                  [&fun](Iterator sub_begin, Iterator sub_end) { std::for_each(sub_begin, sub_end, fun); });
+        for_range(std::forward<ExecPolicy>(policy), begin_it, end_it, [&fun](Iterator sub_begin, Iterator sub_end) {
+            detail::__for_each_block(sub_begin, sub_end, fun, use_simd());
+        });
         return;
     }
 
-    std::for_each(begin_it, end_it, fun);
+    detail::__for_each_block(begin_it, end_it, fun, use_simd());
 }
 
 
-// reimplement fill using for_each
+// parallel fill algorithm
+// always static chunking: the slices of the range are the same at every call. On a numa_thread_pool_executor,
+// each NUMA shard writes the same contiguous part of the range at every call: the pages of a new buffer are
+// first touched by the node that processes them later. Other executors hand the slices to any worker
 template <typename ExecutionPolicy, class ForwardIterator, class T>
 void fill(ExecutionPolicy&& policy, ForwardIterator first, ForwardIterator last, const T& val) {
-    using value_type = typename std::iterator_traits<ForwardIterator>::value_type;
+    using use_simd = detail::__use_simd<ExecutionPolicy, ForwardIterator>;
+
+    if (detail::is_parallel_policy(policy)) {
+        for_range(policy.with(static_chunking), first, last,
+                  [&val](ForwardIterator sub_begin, ForwardIterator sub_end) {
+                      detail::__fill_block(sub_begin, sub_end, val, use_simd());
+                  });
+        return;
+    }
 
-    ::hadoken::parallel::for_each(std::forward<ExecutionPolicy>(policy), first, last, [&val](value_type& elem) { elem = val; });
+    detail::__fill_block(first, last, val, use_simd());
 }
 
 
@@ -72,19 +92,94 @@ void fill_n(ExecutionPolicy&& policy, ForwardIterator first, Size n, const T& va
 }
 
 
-// parallel generate algorithm
+// parallel generate algorithm, g is called concurrently
 template <class ExecutionPolicy, class ForwardIterator, class Generator>
 void generate(ExecutionPolicy&& policy, ForwardIterator first, ForwardIterator last, Generator g) {
-    using value_type = typename std::iterator_traits<ForwardIterator>::value_type;
+    using reference = typename std::iterator_traits<ForwardIterator>::reference;
 
-    ::hadoken::parallel::for_each(std::forward<ExecutionPolicy>(policy), first, last, [&g](value_type& elem) { elem = g(); });
+    ::hadoken::parallel::for_each(std::forward<ExecutionPolicy>(policy), first, last, [&g](reference elem) { elem = g(); });
 }
 
 // parallel generate_n algorithm
 template <class ExecutionPolicy, class OutputIt, class Size, class Generator>
 OutputIt generate_n(ExecutionPolicy&& policy, OutputIt first, Size count, Generator g) {
-    ::hadoken::parallel::generate(std::forward<ExecutionPolicy>(policy), first,
-                                  ::hadoken::parallel::detail::get_end_iterator(first, count), std::forward<Generator>(g));
+    if (count <= Size(0)) {
+        return first;
+    }
+
+    const OutputIt last = ::hadoken::parallel::detail::get_end_iterator(first, count);
+    ::hadoken::parallel::generate(std::forward<ExecutionPolicy>(policy), first, last, g);
+    return last;
+}
+
+
+namespace detail {
+
+/// number of consecutive elements generated from the same sub-stream by generate_random
+constexpr std::size_t __random_block_size = 1024;
+
+// independent sub-stream of an engine: derivate member of the counter engines and of the engine mappers
+template <typename Engine>
+inline auto __random_substream(const Engine& engine, std::size_t id, int) -> decltype(engine.derivate(std::size_t())) {
+    return engine.derivate(typename Engine::result_type(id));
+}
+
+// independent sub-stream of a standard engine, derivation through sha1
+template <typename Engine>
+inline Engine __random_substream(const Engine& engine, std::size_t id, long) {
+    return random_engine_derivate(engine, typename Engine::result_type(id));
+}
+
+// fill the block block_id of [first, first + n)
+template <typename ForwardIt, typename Engine, typename Distribution>
+inline void __generate_random_block(ForwardIt block_first, std::size_t block_id, std::size_t n_elems, const Engine& engine,
+                                    const Distribution& dist) {
+    Engine block_engine(__random_substream(engine, block_id, 0));
+    Distribution block_dist(dist);
+
+    for (std::size_t i = 0; i < n_elems; ++i, ++block_first) {
+        *block_first = block_dist(block_engine);
+    }
+}
+
+template <typename ExecutionPolicy, typename RandomIt, typename Engine, typename Distribution>
+inline void __generate_random(const ExecutionPolicy& policy, RandomIt first, RandomIt last, const Engine& engine,
+                              const Distribution& dist, std::true_type) {
+    const std::size_t n_elems = std::size_t(last - first);
+    const std::size_t n_blocks = (n_elems + __random_block_size - 1) / __random_block_size;
+
+    ::hadoken::parallel::for_index(policy, extents(n_blocks), tile_shape(1), [&](std::size_t block_id) {
+        const std::size_t block_begin = block_id * __random_block_size;
+        __generate_random_block(first + block_begin, block_id, std::min(__random_block_size, n_elems - block_begin), engine,
+                                dist);
+    });
+}
+
+template <typename ExecutionPolicy, typename ForwardIt, typename Engine, typename Distribution>
+inline void __generate_random(const ExecutionPolicy&, ForwardIt first, ForwardIt last, const Engine& engine,
+                              const Distribution& dist, std::false_type) {
+    std::size_t n_elems = std::size_t(std::distance(first, last));
+
+    for (std::size_t block_id = 0; n_elems > 0; ++block_id) {
+        const std::size_t block_elems = std::min(__random_block_size, n_elems);
+        __generate_random_block(first, block_id, block_elems, engine, dist);
+
+        std::advance(first, block_elems);
+        n_elems -= block_elems;
+    }
+}
+
+} // namespace detail
+
+
+// parallel generation of random numbers
+template <class ExecutionPolicy, class ForwardIt, class Engine, class Distribution>
+void generate_random(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, const Engine& engine,
+                     const Distribution& dist) {
+    using random_access =
+        std::is_same<typename std::iterator_traits<ForwardIt>::iterator_category, std::random_access_iterator_tag>;
+
+    detail::__generate_random(policy, first, last, engine, dist, random_access());
 }
 
 
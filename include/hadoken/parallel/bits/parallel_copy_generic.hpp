@@ -0,0 +1,536 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef PARALLEL_COPY_GENERIC_HPP
+#define PARALLEL_COPY_GENERIC_HPP
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <hadoken/parallel/algorithm.hpp>
+#include <hadoken/utility/range.hpp>
+
+
+#include "parallel_generic_utils.hpp"
+
+
+namespace hadoken {
+
+
+namespace parallel {
+
+
+namespace detail {
+
+
+template <typename Iterator>
+struct __is_random_access
+    : std::is_same<typename std::iterator_traits<Iterator>::iterator_category, std::random_access_iterator_tag> {};
+
+
+// uninitialized storage of n elements, the elements are constructed and destroyed by the user
+template <typename T>
+class __raw_buffer {
+  public:
+    inline explicit __raw_buffer(std::size_t n) : _data(n > 0 ? std::allocator<T>().allocate(n) : nullptr), _size(n) {}
+
+    inline ~__raw_buffer() {
+        if (_data) {
+            std::allocator<T>().deallocate(_data, _size);
+        }
+    }
+
+    __raw_buffer(const __raw_buffer&) = delete;
+    __raw_buffer& operator=(const __raw_buffer&) = delete;
+
+    inline T* data() const { return _data; }
+
+  private:
+    T* _data;
+    std::size_t _size;
+};
+
+// output iterator constructing the values in the uninitialized storage of a __raw_buffer,
+// supports the offsets of the block algorithms
+template <typename T>
+class __construct_iterator {
+  public:
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    inline explicit __construct_iterator(T* ptr) : _ptr(ptr) {}
+
+    inline __construct_iterator& operator*() { return *this; }
+
+    inline __construct_iterator& operator++() {
+        ++_ptr;
+        return *this;
+    }
+
+    inline __construct_iterator operator++(int) { return __construct_iterator(_ptr++); }
+
+    inline __construct_iterator operator+(std::size_t n) const { return __construct_iterator(_ptr + n); }
+
+    inline __construct_iterator operator[](std::size_t n) const { return __construct_iterator(_ptr + n); }
+
+    inline __construct_iterator& operator=(const T& value) {
+        ::new (static_cast<void*>(_ptr)) T(value);
+        return *this;
+    }
+
+    inline __construct_iterator& operator=(T&& value) {
+        ::new (static_cast<void*>(_ptr)) T(std::move(value));
+        return *this;
+    }
+
+  private:
+    T* _ptr;
+};
+
+// destroy the elements of [first, last), nothing for trivially destructible types
+template <typename T>
+inline void __destroy_block(T* first, T* last) {
+    for (; first != last; ++first) {
+        first->~T();
+    }
+}
+
+
+///
+/// parallel stream compaction
+///
+/// the range is divided in one part per thread. A first pass evaluates select(it, index) for
+/// each element, stores the result and counts the selected elements of each part. An exclusive
+/// scan of the counts gives the rank of the first selected and of the first rejected element
+/// of each part. A second pass calls write(it, rank, selected) for each element, rank being the
+/// position of the element among the selected, or among the rejected elements.
+///
+/// the relative order of the elements is preserved, return the number of selected elements
+///
+template <class ExecutionPolicy, class Iterator, class Select, class Write>
+std::size_t __parallel_compact(const ExecutionPolicy& policy, Iterator first, Iterator last, Select select, Write write) {
+    const std::size_t n_elems = std::size_t(std::distance(first, last));
+    const std::size_t n_parts = __get_partition_size(policy, n_elems);
+
+    // not a vector<bool>, the flags are written concurrently
+    std::vector<unsigned char> flags(n_elems);
+
+    // select may look at the neighbours of an element that write has already moved:
+    // all the flags are evaluated before the first write, even sequentially
+    if (n_parts <= 1) {
+        std::size_t n_selected = 0, n_rejected = 0, i = 0;
+        for (Iterator it = first; it != last; ++it, ++i) {
+            flags[i] = select(it, i) ? 1 : 0;
+        }
+        i = 0;
+        for (Iterator it = first; it != last; ++it, ++i) {
+            const bool selected = (flags[i] != 0);
+            write(it, selected ? n_selected++ : n_rejected++, selected);
+        }
+        return n_selected;
+    }
+
+    std::vector<std::size_t> part_begin(n_parts + 1), selected_begin(n_parts + 1);
+    const range<Iterator> global_range(first, last);
+
+    __execute_grid(policy, int(n_parts), [&](int id, int num_executor) {
+        const range<Iterator> part = take_splice(global_range, id, num_executor);
+        std::size_t i = std::size_t(std::distance(first, part.begin())), count = 0;
+
+        for (Iterator it = part.begin(); it != part.end(); ++it, ++i) {
+            const bool selected = select(it, i);
+            flags[i] = selected ? 1 : 0;
+            count += selected ? 1 : 0;
+        }
+        selected_begin[id + 1] = count;
+        part_begin[id + 1] = std::size_t(part.size());
+    });
+
+    for (std::size_t id = 0; id < n_parts; ++id) {
+        selected_begin[id + 1] += selected_begin[id];
+        part_begin[id + 1] += part_begin[id];
+    }
+
+    __execute_grid(policy, int(n_parts), [&](int id, int num_executor) {
+        const range<Iterator> part = take_splice(global_range, id, num_executor);
+        std::size_t i = part_begin[id];
+        std::size_t selected_rank = selected_begin[id], rejected_rank = part_begin[id] - selected_begin[id];
+
+        for (Iterator it = part.begin(); it != part.end(); ++it, ++i) {
+            const bool selected = (flags[i] != 0);
+            write(it, selected ? selected_rank++ : rejected_rank++, selected);
+        }
+    });
+
+    return selected_begin[n_parts];
+}
+
+
+///
+/// stable reordering of [first, last) in parallel: the selected elements first, then the rejected
+/// ones if keep_rejected. The elements are moved to a buffer by a compaction, then moved back.
+/// Return the number of selected elements
+///
+template <class ExecutionPolicy, class RandomIt, class Select>
+std::size_t __parallel_stable_partition(const ExecutionPolicy& policy, RandomIt first, RandomIt last, Select select,
+                                        bool keep_rejected) {
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+    const std::size_t n_elems = std::size_t(std::distance(first, last));
+    __raw_buffer<value_type> buffer(n_elems);
+    value_type* const buffer_begin = buffer.data();
+
+    // the selected elements fill the buffer from the front, the rejected ones from the back
+    const std::size_t n_selected =
+        __parallel_compact(policy, first, last, select, [&](RandomIt it, std::size_t rank, bool selected) {
+            if (selected) {
+                ::new (static_cast<void*>(buffer_begin + rank)) value_type(std::move(*it));
+            } else if (keep_rejected) {
+                ::new (static_cast<void*>(buffer_begin + (n_elems - 1 - rank))) value_type(std::move(*it));
+            }
+        });
+
+    const std::size_t n_moved = keep_rejected ? n_elems : n_selected;
+
+    __parallel_for_range(policy, buffer_begin, buffer_begin + n_moved, [&](value_type* sub_begin, value_type* sub_end) {
+        for (value_type* v = sub_begin; v != sub_end; ++v) {
+            const std::size_t pos = std::size_t(v - buffer_begin);
+            const std::size_t dest = (pos < n_selected) ? pos : n_selected + (n_elems - 1 - pos);
+
+            first[dest] = std::move(*v);
+            v->~value_type();
+        }
+    });
+    return n_selected;
+}
+
+struct __copy_block {
+    template <typename InputIt, typename OutputIt>
+    inline OutputIt operator()(InputIt first, InputIt last, OutputIt d_first) const {
+        return std::copy(first, last, d_first);
+    }
+};
+
+struct __move_block {
+    template <typename InputIt, typename OutputIt>
+    inline OutputIt operator()(InputIt first, InputIt last, OutputIt d_first) const {
+        return std::move(first, last, d_first);
+    }
+};
+
+// copy or move by chunks, random access iterators
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BlockOp>
+OutputIt __parallel_block_copy(const ExecutionPolicy& policy, InputIt first, InputIt last, OutputIt d_first, BlockOp op,
+                               std::true_type) {
+    if (is_parallel_policy(policy) == false) {
+        return op(first, last, d_first);
+    }
+
+    __parallel_for_range(policy, first, last,
+                         [&](InputIt sub_begin, InputIt sub_end) { op(sub_begin, sub_end, d_first + (sub_begin - first)); });
+    return d_first + (last - first);
+}
+
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BlockOp>
+OutputIt __parallel_block_copy(const ExecutionPolicy&, InputIt first, InputIt last, OutputIt d_first, BlockOp op,
+                               std::false_type) {
+    return op(first, last, d_first);
+}
+
+
+template <class ExecutionPolicy, class InputIt, class OutputIt, class UnaryPredicate>
+OutputIt __parallel_copy_if(const ExecutionPolicy& policy, InputIt first, InputIt last, OutputIt d_first, UnaryPredicate& p,
+                            std::true_type) {
+    if (is_parallel_policy(policy) == false) {
+        return std::copy_if(first, last, d_first, p);
+    }
+
+    const std::size_t n_selected =
+        __parallel_compact(policy, first, last, [&p](InputIt it, std::size_t) -> bool { return p(*it); },
+                           [&d_first](InputIt it, std::size_t rank, bool selected) {
+                               if (selected) {
+                                   d_first[rank] = *it;
+                               }
+                           });
+    return d_first + n_selected;
+}
+
+template <class ExecutionPolicy, class InputIt, class OutputIt, class UnaryPredicate>
+OutputIt __parallel_copy_if(const ExecutionPolicy&, InputIt first, InputIt last, OutputIt d_first, UnaryPredicate& p,
+                            std::false_type) {
+    return std::copy_if(first, last, d_first, p);
+}
+
+
+template <class ExecutionPolicy, class RandomIt, class UnaryPredicate>
+RandomIt __parallel_remove_if(const ExecutionPolicy& policy, RandomIt first, RandomIt last, UnaryPredicate& p, std::true_type) {
+    if (is_parallel_policy(policy) == false) {
+        return std::remove_if(first, last, p);
+    }
+
+    return first + __parallel_stable_partition(policy, first, last, [&p](RandomIt it, std::size_t) -> bool { return !p(*it); },
+                                               false);
+}
+
+template <class ExecutionPolicy, class ForwardIt, class UnaryPredicate>
+ForwardIt __parallel_remove_if(const ExecutionPolicy&, ForwardIt first, ForwardIt last, UnaryPredicate& p, std::false_type) {
+    return std::remove_if(first, last, p);
+}
+
+
+template <class ExecutionPolicy, class RandomIt, class UnaryPredicate>
+RandomIt __parallel_partition(const ExecutionPolicy& policy, RandomIt first, RandomIt last, UnaryPredicate& p, std::true_type) {
+    if (is_parallel_policy(policy) == false) {
+        return std::stable_partition(first, last, p);
+    }
+
+    return first + __parallel_stable_partition(policy, first, last, [&p](RandomIt it, std::size_t) -> bool { return p(*it); },
+                                               true);
+}
+
+template <class ExecutionPolicy, class BidirIt, class UnaryPredicate>
+BidirIt __parallel_partition(const ExecutionPolicy&, BidirIt first, BidirIt last, UnaryPredicate& p, std::false_type) {
+    return std::stable_partition(first, last, p);
+}
+
+
+template <class ExecutionPolicy, class InputIt, class OutputIt1, class OutputIt2, class UnaryPredicate>
+std::pair<OutputIt1, OutputIt2> __parallel_partition_copy(const ExecutionPolicy& policy, InputIt first, InputIt last,
+                                                          OutputIt1 d_first_true, OutputIt2 d_first_false, UnaryPredicate& p,
+                                                          std::true_type) {
+    if (is_parallel_policy(policy) == false) {
+        return std::partition_copy(first, last, d_first_true, d_first_false, p);
+    }
+
+    const std::size_t n_selected =
+        __parallel_compact(policy, first, last, [&p](InputIt it, std::size_t) -> bool { return p(*it); },
+                           [&](InputIt it, std::size_t rank, bool selected) {
+                               if (selected) {
+                                   d_first_true[rank] = *it;
+                               } else {
+                                   d_first_false[rank] = *it;
+                               }
+                           });
+    return std::make_pair(d_first_true + n_selected, d_first_false + ((last - first) - n_selected));
+}
+
+template <class ExecutionPolicy, class InputIt, class OutputIt1, class OutputIt2, class UnaryPredicate>
+std::pair<OutputIt1, OutputIt2> __parallel_partition_copy(const ExecutionPolicy&, InputIt first, InputIt last,
+                                                          OutputIt1 d_first_true, OutputIt2 d_first_false, UnaryPredicate& p,
+                                                          std::false_type) {
+    return std::partition_copy(first, last, d_first_true, d_first_false, p);
+}
+
+
+// the first element of each group of equivalent consecutive elements
+template <typename RandomIt, typename BinaryPredicate>
+struct __unique_select {
+    inline bool operator()(RandomIt it, std::size_t i) const { return (i == 0) || !p(*(it - 1), *it); }
+
+    BinaryPredicate& p;
+};
+
+template <class ExecutionPolicy, class RandomIt, class BinaryPredicate>
+RandomIt __parallel_unique(const ExecutionPolicy& policy, RandomIt first, RandomIt last, BinaryPredicate& p, std::true_type) {
+    if (is_parallel_policy(policy) == false) {
+        return std::unique(first, last, p);
+    }
+
+    return first + __parallel_stable_partition(policy, first, last, __unique_select<RandomIt, BinaryPredicate>{p}, false);
+}
+
+template <class ExecutionPolicy, class ForwardIt, class BinaryPredicate>
+ForwardIt __parallel_unique(const ExecutionPolicy&, ForwardIt first, ForwardIt last, BinaryPredicate& p, std::false_type) {
+    return std::unique(first, last, p);
+}
+
+
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryPredicate>
+OutputIt __parallel_unique_copy(const ExecutionPolicy& policy, InputIt first, InputIt last, OutputIt d_first,
+                                BinaryPredicate& p, std::true_type) {
+    if (is_parallel_policy(policy) == false) {
+        return std::unique_copy(first, last, d_first, p);
+    }
+
+    const std::size_t n_selected = __parallel_compact(policy, first, last, __unique_select<InputIt, BinaryPredicate>{p},
+                                                      [&d_first](InputIt it, std::size_t rank, bool selected) {
+                                                          if (selected) {
+                                                              d_first[rank] = *it;
+                                                          }
+                                                      });
+    return d_first + n_selected;
+}
+
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryPredicate>
+OutputIt __parallel_unique_copy(const ExecutionPolicy&, InputIt first, InputIt last, OutputIt d_first,
+                                BinaryPredicate& p, std::false_type) {
+    return std::unique_copy(first, last, d_first, p);
+}
+
+
+// parallel path for random access iterators only
+template <typename... Iterators>
+struct __compaction_path;
+
+template <>
+struct __compaction_path<> : std::true_type {};
+
+template <typename Iterator, typename... Iterators>
+struct __compaction_path<Iterator, Iterators...>
+    : std::integral_constant<bool, __is_random_access<Iterator>::value && __compaction_path<Iterators...>::value> {};
+
+
+} // namespace detail
+
+
+/// parallel copy algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt>
+OutputIt copy(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first) {
+    return detail::__parallel_block_copy(policy, first, last, d_first, detail::__copy_block(),
+                                         detail::__compaction_path<InputIt, OutputIt>());
+}
+
+/// parallel copy_n algorithm
+template <class ExecutionPolicy, class InputIt, class Size, class OutputIt>
+OutputIt copy_n(ExecutionPolicy&& policy, InputIt first, Size count, OutputIt d_first) {
+    if (count <= Size(0)) {
+        return d_first;
+    }
+    return ::hadoken::parallel::copy(std::forward<ExecutionPolicy>(policy), first, detail::get_end_iterator(first, count),
+                                     d_first);
+}
+
+/// parallel move algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt>
+OutputIt move(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first) {
+    return detail::__parallel_block_copy(policy, first, last, d_first, detail::__move_block(),
+                                         detail::__compaction_path<InputIt, OutputIt>());
+}
+
+/// parallel copy_if algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt, class UnaryPredicate>
+OutputIt copy_if(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, UnaryPredicate p) {
+    return detail::__parallel_copy_if(policy, first, last, d_first, p, detail::__compaction_path<InputIt, OutputIt>());
+}
+
+/// parallel remove_if algorithm, stable
+template <class ExecutionPolicy, class ForwardIt, class UnaryPredicate>
+ForwardIt remove_if(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, UnaryPredicate p) {
+    return detail::__parallel_remove_if(policy, first, last, p, detail::__compaction_path<ForwardIt>());
+}
+
+/// parallel remove algorithm, stable
+template <class ExecutionPolicy, class ForwardIt, class T>
+ForwardIt remove(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, const T& value) {
+    using reference = typename std::iterator_traits<ForwardIt>::reference;
+
+    return ::hadoken::parallel::remove_if(std::forward<ExecutionPolicy>(policy), first, last,
+                                          [&value](reference v) -> bool { return v == value; });
+}
+
+/// parallel replace_if algorithm
+template <class ExecutionPolicy, class ForwardIt, class UnaryPredicate, class T>
+void replace_if(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, UnaryPredicate p, const T& new_value) {
+    for_range(std::forward<ExecutionPolicy>(policy), first, last,
+              [&](ForwardIt sub_begin, ForwardIt sub_end) { std::replace_if(sub_begin, sub_end, p, new_value); });
+}
+
+/// parallel replace algorithm
+template <class ExecutionPolicy, class ForwardIt, class T>
+void replace(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, const T& old_value, const T& new_value) {
+    for_range(std::forward<ExecutionPolicy>(policy), first, last,
+              [&](ForwardIt sub_begin, ForwardIt sub_end) { std::replace(sub_begin, sub_end, old_value, new_value); });
+}
+
+/// parallel partition algorithm, the parallel version is stable
+template <class ExecutionPolicy, class BidirIt, class UnaryPredicate>
+BidirIt partition(ExecutionPolicy&& policy, BidirIt first, BidirIt last, UnaryPredicate p) {
+    if (detail::is_parallel_policy(policy) == false) {
+        return std::partition(first, last, p);
+    }
+    return detail::__parallel_partition(policy, first, last, p, detail::__compaction_path<BidirIt>());
+}
+
+/// parallel stable_partition algorithm
+template <class ExecutionPolicy, class BidirIt, class UnaryPredicate>
+BidirIt stable_partition(ExecutionPolicy&& policy, BidirIt first, BidirIt last, UnaryPredicate p) {
+    return detail::__parallel_partition(policy, first, last, p, detail::__compaction_path<BidirIt>());
+}
+
+/// parallel partition_copy algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt1, class OutputIt2, class UnaryPredicate>
+std::pair<OutputIt1, OutputIt2> partition_copy(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt1 d_first_true,
+                                               OutputIt2 d_first_false, UnaryPredicate p) {
+    return detail::__parallel_partition_copy(policy, first, last, d_first_true, d_first_false, p,
+                                             detail::__compaction_path<InputIt, OutputIt1, OutputIt2>());
+}
+
+/// parallel unique algorithm
+template <class ExecutionPolicy, class ForwardIt>
+ForwardIt unique(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last) {
+    using value_type = typename std::iterator_traits<ForwardIt>::value_type;
+
+    return ::hadoken::parallel::unique(std::forward<ExecutionPolicy>(policy), first, last, std::equal_to<value_type>());
+}
+
+/// parallel unique algorithm with binary predicate
+template <class ExecutionPolicy, class ForwardIt, class BinaryPredicate>
+ForwardIt unique(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, BinaryPredicate p) {
+    return detail::__parallel_unique(policy, first, last, p, detail::__compaction_path<ForwardIt>());
+}
+
+/// parallel unique_copy algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt>
+OutputIt unique_copy(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first) {
+    using value_type = typename std::iterator_traits<InputIt>::value_type;
+
+    return ::hadoken::parallel::unique_copy(std::forward<ExecutionPolicy>(policy), first, last, d_first,
+                                            std::equal_to<value_type>());
+}
+
+/// parallel unique_copy algorithm with binary predicate
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryPredicate>
+OutputIt unique_copy(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, BinaryPredicate p) {
+    return detail::__parallel_unique_copy(policy, first, last, d_first, p, detail::__compaction_path<InputIt, OutputIt>());
+}
+
+
+} // namespace parallel
+
+} // namespace hadoken
+
+#endif // PARALLEL_COPY_GENERIC_HPP
@@ -0,0 +1,262 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef PARALLEL_FOR_INDEX_GENERIC_HPP
+#define PARALLEL_FOR_INDEX_GENERIC_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <type_traits>
+
+#include <hadoken/os/topology.hpp>
+#include <hadoken/parallel/algorithm.hpp>
+
+
+#include "parallel_generic_utils.hpp"
+#include "parallel_simd_utils.hpp"
+
+
+namespace hadoken {
+
+
+namespace parallel {
+
+
+namespace detail {
+
+
+// L2 cache size of the machine, 256 KiB if unknown
+inline std::size_t __l2_cache_size() {
+    static const std::size_t cache_size = get_cache_size(2);
+    return (cache_size > 0) ? cache_size : std::size_t(256 * 1024);
+}
+
+
+// arity of an index function: 3 if callable with (i, j, k), 2 with (i, j), 1 otherwise
+template <typename Function>
+auto __index_arity(Function& fun, int)
+    -> decltype((void)fun(std::size_t(), std::size_t(), std::size_t()), std::integral_constant<std::size_t, 3>());
+
+template <typename Function>
+auto __index_arity(Function& fun, long)
+    -> decltype((void)fun(std::size_t(), std::size_t()), std::integral_constant<std::size_t, 2>());
+
+template <typename Function>
+std::integral_constant<std::size_t, 1> __index_arity(Function& fun, ...);
+
+
+// the indices of the space are right aligned internally: the contiguous dimension is always the last one
+template <typename Function>
+inline void __call_index(Function& fun, std::size_t i, std::size_t j, std::size_t k, std::integral_constant<std::size_t, 3>) {
+    fun(i, j, k);
+}
+
+template <typename Function>
+inline void __call_index(Function& fun, std::size_t, std::size_t j, std::size_t k, std::integral_constant<std::size_t, 2>) {
+    fun(j, k);
+}
+
+template <typename Function>
+inline void __call_index(Function& fun, std::size_t, std::size_t, std::size_t k, std::integral_constant<std::size_t, 1>) {
+    fun(k);
+}
+
+
+// right aligned dimensions of a space or of a tile of rank space_rank
+inline void __right_align(const extents& ext, std::size_t space_rank, std::size_t (&dims)[3]) {
+    const std::size_t offset = 3 - space_rank;
+    for (std::size_t d = 0; d < 3; ++d) {
+        dims[d] = (d < offset) ? 1 : ext[d - offset];
+    }
+}
+
+
+template <typename Function, typename Arity>
+inline void __index_tile(Function& fun, const std::size_t (&begin)[3], const std::size_t (&end)[3], Arity arity,
+                         std::false_type) {
+    for (std::size_t i = begin[0]; i < end[0]; ++i) {
+        for (std::size_t j = begin[1]; j < end[1]; ++j) {
+            for (std::size_t k = begin[2]; k < end[2]; ++k) {
+                __call_index(fun, i, j, k, arity);
+            }
+        }
+    }
+}
+
+template <typename Function, typename Arity>
+inline void __index_tile(Function& fun, const std::size_t (&begin)[3], const std::size_t (&end)[3], Arity arity,
+                         std::true_type) {
+    for (std::size_t i = begin[0]; i < end[0]; ++i) {
+        for (std::size_t j = begin[1]; j < end[1]; ++j) {
+            HADOKEN_PRAGMA_SIMD
+            for (std::size_t k = begin[2]; k < end[2]; ++k) {
+                __call_index(fun, i, j, k, arity);
+            }
+        }
+    }
+}
+
+
+// number of tiles of shape tile in each dimension of space
+inline std::size_t __tile_count(const std::size_t (&space)[3], const std::size_t (&tile)[3], std::size_t (&count)[3]) {
+    for (std::size_t d = 0; d < 3; ++d) {
+        count[d] = (space[d] + tile[d] - 1) / tile[d];
+    }
+    return count[0] * count[1] * count[2];
+}
+
+
+///
+/// execute fun on every index of space, one task per tile
+///
+/// static chunking gives a contiguous sequence of tiles to each worker,
+/// dynamic and guided chunking let the workers claim the tiles one by one
+///
+template <typename ExecPolicy, typename Function>
+inline void __parallel_for_index(const ExecPolicy& policy, const extents& space, std::size_t (&tile)[3], bool adapt_tile,
+                                 Function& fun) {
+    using arity = decltype(__index_arity(fun, 0));
+    using use_simd = is_vector_policy<ExecPolicy>;
+
+    if (space.rank() != arity::value) {
+        throw std::invalid_argument("for_index: the arity of the function does not match the rank of the index space");
+    }
+
+    std::size_t dims[3], count[3];
+    __right_align(space, space.rank(), dims);
+    if (space.size() == 0) {
+        return;
+    }
+
+    for (std::size_t d = 0; d < 3; ++d) {
+        tile[d] = std::max<std::size_t>(1, std::min(tile[d], dims[d]));
+    }
+
+    std::size_t n_tiles = __tile_count(dims, tile, count);
+    const std::size_t n_workers = is_parallel_policy(policy) ? __get_partition_size(policy, space.size()) : 1;
+
+    // cache sized tiles of a small space: split the outer dimensions first to get a few tiles per worker
+    if (adapt_tile) {
+        for (std::size_t d = 0; d < 3 && n_tiles < 4 * n_workers; ++d) {
+            while (tile[d] > 1 && n_tiles < 4 * n_workers) {
+                tile[d] = (tile[d] + 1) / 2;
+                n_tiles = __tile_count(dims, tile, count);
+            }
+        }
+    }
+
+    auto run_tile = [&](std::size_t tile_id) {
+        const std::size_t coord[3] = {tile_id / (count[1] * count[2]), (tile_id / count[2]) % count[1], tile_id % count[2]};
+        std::size_t begin[3], end[3];
+        for (std::size_t d = 0; d < 3; ++d) {
+            begin[d] = coord[d] * tile[d];
+            end[d] = std::min(begin[d] + tile[d], dims[d]);
+        }
+        __index_tile(fun, begin, end, arity(), use_simd());
+    };
+
+    const std::size_t n_tasks = std::min(n_workers, n_tiles);
+
+    if (n_tasks <= 1) {
+        for (std::size_t tile_id = 0; tile_id < n_tiles; ++tile_id) {
+            run_tile(tile_id);
+        }
+        return;
+    }
+
+    if (policy.get_chunking() == chunking_strategy::static_chunk) {
+        __execute_grid(policy, int(n_tasks), [&](int id, int num_executor) {
+            const std::size_t tile_begin = n_tiles * std::size_t(id) / std::size_t(num_executor);
+            const std::size_t tile_end = n_tiles * std::size_t(id + 1) / std::size_t(num_executor);
+            for (std::size_t tile_id = tile_begin; tile_id < tile_end; ++tile_id) {
+                run_tile(tile_id);
+            }
+        });
+        return;
+    }
+
+    std::atomic<std::size_t> next(0);
+    __execute_grid(policy, int(n_tasks), [&](int, int) {
+        for (std::size_t tile_id = next.fetch_add(1); tile_id < n_tiles; tile_id = next.fetch_add(1)) {
+            run_tile(tile_id);
+        }
+    });
+}
+
+
+} // namespace detail
+
+
+inline tile_shape cache_tile(const extents& space, std::size_t bytes_per_index, std::size_t cache_bytes) {
+    if (cache_bytes == 0) {
+        cache_bytes = detail::__l2_cache_size();
+    }
+
+    std::size_t dims[3], tile[3];
+    detail::__right_align(space, space.rank(), dims);
+
+    // number of indices of a tile, half of the cache is left to the other data of the task
+    std::size_t budget = std::max<std::size_t>(1, cache_bytes / 2 / std::max<std::size_t>(1, bytes_per_index));
+    for (std::size_t d = 3; d-- > 0;) {
+        tile[d] = std::max<std::size_t>(1, std::min(dims[d], budget));
+        budget = std::max<std::size_t>(1, budget / tile[d]);
+    }
+
+    const std::size_t offset = 3 - space.rank();
+    if (space.rank() == 1) {
+        return tile_shape(tile[offset]);
+    }
+    if (space.rank() == 2) {
+        return tile_shape(tile[offset], tile[offset + 1]);
+    }
+    return tile_shape(tile[0], tile[1], tile[2]);
+}
+
+
+template <typename ExecPolicy, typename IndexFunction>
+inline void for_index(ExecPolicy&& policy, const extents& space, IndexFunction fun) {
+    std::size_t tile[3];
+    detail::__right_align(cache_tile(space, sizeof(double)), space.rank(), tile);
+    detail::__parallel_for_index(policy, space, tile, true, fun);
+}
+
+
+template <typename ExecPolicy, typename IndexFunction>
+inline void for_index(ExecPolicy&& policy, const extents& space, const tile_shape& tile, IndexFunction fun) {
+    std::size_t tile_dims[3];
+    detail::__right_align(tile, space.rank(), tile_dims);
+    detail::__parallel_for_index(policy, space, tile_dims, false, fun);
+}
+
+
+} // namespace parallel
+
+} // namespace hadoken
+
+#endif // PARALLEL_FOR_INDEX_GENERIC_HPP
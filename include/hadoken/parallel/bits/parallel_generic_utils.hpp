@@ -30,6 +30,7 @@
 #define PARALLEL_GENERIC_UTILS_HPP
 
 #include <algorithm>
+#include <type_traits>
 
 
 #include <hadoken/parallel/algorithm.hpp>
@@ -60,6 +61,17 @@ inline bool is_parallel_policy(const ExecPolicy& policy) {
     return false;
 }
 
+template <typename Executor>
+inline bool is_parallel_policy(const parallel_shared_exec_policy<Executor>& policy) {
+    (void)policy;
+    return true;
+}
+
+// determine if a policy allows vector execution
+template <typename ExecPolicy, typename Policy = typename std::decay<ExecPolicy>::type>
+struct is_vector_policy : std::integral_constant<bool, std::is_same<Policy, parallel_vector_execution_policy>::value ||
+                                                          std::is_same<Policy, unsequenced_policy>::value> {};
+
 
 
 
@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <iterator>
 #include <hadoken/parallel/algorithm.hpp>
 
 
@@ -43,71 +44,132 @@ namespace hadoken {
 namespace parallel {
 
 
-namespace detail {} // namespace detail
+namespace detail {
 
+// upper bound of the chunks of the searches, bound the work done after a match
+static constexpr std::size_t __find_max_chunk = 8192;
 
-template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
-inline bool all_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p) {
-
-    if (detail::is_parallel_policy(policy)) {
-        std::atomic<bool> res(true);
+// lower the shared position of the leftmost match to pos
+inline void __update_leftmost(std::atomic<std::size_t>& leftmost, std::size_t pos) {
+    std::size_t current = leftmost.load(std::memory_order_relaxed);
+    while (pos < current && !leftmost.compare_exchange_weak(current, pos, std::memory_order_relaxed)) {
+    }
+}
 
-        hadoken::parallel::for_range(std::forward<ExecutionPolicy>(policy), first, last,
-                                     [&res, &p](InputIterator local_first, InputIterator local_end) {
-                                         const bool local_res = std::all_of(local_first, local_end, p);
+///
+/// parallel search of the leftmost element satisfying p
+///
+/// the threads claim the chunks in order from a shared counter, whatever the chunking
+/// of the policy. The position of the leftmost match found so far is the stop flag: a thread
+/// stops as soon as its next chunk starts after it, the chunks before a match are always
+/// completed and the result is the first match of the range
+///
+template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
+InputIterator __parallel_find_if(const ExecutionPolicy& policy, InputIterator first, InputIterator last, UnaryPredicate& p) {
+    const std::size_t n_elems = std::size_t(std::distance(first, last));
+    const std::size_t n_workers = is_parallel_policy(policy) ? __get_partition_size(policy, n_elems) : 1;
 
-                                         if (local_res == false) {
-                                             res.store(false);
-                                         }
-                                     });
-        return res.load();
-    } else {
-        return std::all_of(first, last, p);
+    if (n_workers <= 1) {
+        return std::find_if(first, last, p);
     }
+
+    const std::size_t grain = std::max<std::size_t>(1, policy.get_grain());
+    const std::size_t chunk_size = std::max(grain, std::min(__find_max_chunk, n_elems / (n_workers * 8)));
+
+    std::atomic<std::size_t> next_chunk(0);
+    std::atomic<std::size_t> leftmost(n_elems);
+
+    __execute_grid(policy, int(n_workers), [&](int, int) {
+        std::size_t chunk_begin;
+        while ((chunk_begin = next_chunk.fetch_add(chunk_size, std::memory_order_relaxed)) <
+               std::min(n_elems, leftmost.load(std::memory_order_relaxed))) {
+            const std::size_t chunk_end = std::min(n_elems, chunk_begin + chunk_size);
+
+            InputIterator chunk_first = first;
+            std::advance(chunk_first, chunk_begin);
+            InputIterator chunk_last = chunk_first;
+            std::advance(chunk_last, chunk_end - chunk_begin);
+
+            InputIterator match = std::find_if(chunk_first, chunk_last, p);
+            if (match != chunk_last) {
+                __update_leftmost(leftmost, chunk_begin + std::size_t(std::distance(chunk_first, match)));
+                return;
+            }
+        }
+    });
+
+    std::advance(first, leftmost.load());
+    return first;
 }
 
+} // namespace detail
 
+
+/// parallel find_if algorithm, return the leftmost match
 template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
-inline bool any_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p) {
+inline InputIterator find_if(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p) {
+    return detail::__parallel_find_if(policy, first, last, p);
+}
 
-    if (detail::is_parallel_policy(policy)) {
-        std::atomic<bool> res(false);
+/// parallel find_if_not algorithm, return the leftmost match
+template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
+inline InputIterator find_if_not(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p) {
+    using reference = typename std::iterator_traits<InputIterator>::reference;
 
-        hadoken::parallel::for_range(std::forward<ExecutionPolicy>(policy), first, last,
-                                     [&res, &p](InputIterator local_first, InputIterator local_end) {
-                                         const bool local_res = std::any_of(local_first, local_end, p);
+    auto not_p = [&p](reference v) -> bool { return !p(v); };
+    return detail::__parallel_find_if(policy, first, last, not_p);
+}
 
-                                         if (local_res == true) {
-                                             res.store(true);
-                                         }
-                                     });
-        return res.load();
-    } else {
-        return std::any_of(first, last, p);
-    }
+/// parallel find algorithm, return the leftmost match
+template <class ExecutionPolicy, class InputIterator, class T>
+inline InputIterator find(ExecutionPolicy&& policy, InputIterator first, InputIterator last, const T& value) {
+    using reference = typename std::iterator_traits<InputIterator>::reference;
+
+    auto equal_value = [&value](reference v) -> bool { return v == value; };
+    return detail::__parallel_find_if(policy, first, last, equal_value);
 }
 
+/// parallel find_first_of algorithm, return the leftmost match
+template <class ExecutionPolicy, class InputIterator, class ForwardIterator, class BinaryPredicate>
+inline InputIterator find_first_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, ForwardIterator s_first,
+                                   ForwardIterator s_last, BinaryPredicate p) {
+    using reference = typename std::iterator_traits<InputIterator>::reference;
+    using s_reference = typename std::iterator_traits<ForwardIterator>::reference;
+
+    auto in_set = [&](reference v) -> bool {
+        return std::any_of(s_first, s_last, [&](s_reference s) -> bool { return p(v, s); });
+    };
+    return detail::__parallel_find_if(policy, first, last, in_set);
+}
 
+/// parallel find_first_of algorithm, return the leftmost match
+template <class ExecutionPolicy, class InputIterator, class ForwardIterator>
+inline InputIterator find_first_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, ForwardIterator s_first,
+                                   ForwardIterator s_last) {
+    using reference = typename std::iterator_traits<InputIterator>::reference;
+    using s_reference = typename std::iterator_traits<ForwardIterator>::reference;
 
+    return find_first_of(std::forward<ExecutionPolicy>(policy), first, last, s_first, s_last,
+                         [](reference v, s_reference s) -> bool { return v == s; });
+}
 
-template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
-inline bool none_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p) {
 
-    if (detail::is_parallel_policy(policy)) {
-        std::atomic<bool> res(true);
+/// parallel all_of algorithm, stop at the first element not satisfying p
+template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
+inline bool all_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p) {
+    return find_if_not(std::forward<ExecutionPolicy>(policy), first, last, p) == last;
+}
 
-        hadoken::parallel::for_range(std::forward<ExecutionPolicy>(policy), first, last,
-                                     [&res, &p](InputIterator local_first, InputIterator local_end) {
-                                         const bool local_res = std::none_of(local_first, local_end, p);
+/// parallel any_of algorithm, stop at the first element satisfying p
+template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
+inline bool any_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p) {
+    return find_if(std::forward<ExecutionPolicy>(policy), first, last, p) != last;
+}
 
-                                         if (local_res == false) {
-                                             res.store(false);
-                                         }
-                                     });
-        return res.load();
-    } else {
-        return std::none_of(first, last, p);
-    }
+/// parallel none_of algorithm, stop at the first element satisfying p
+template <class ExecutionPolicy, class InputIterator, class UnaryPredicate>
+inline bool none_of(ExecutionPolicy&& policy, InputIterator first, InputIterator last, UnaryPredicate p) {
+    return find_if(std::forward<ExecutionPolicy>(policy), first, last, p) == last;
 }
 
 
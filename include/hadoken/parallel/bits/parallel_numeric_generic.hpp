@@ -31,11 +31,14 @@
 
 #include <algorithm>
 #include <atomic>
-#include <cmath>
-#include <mutex>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 
-#include <hadoken/thread/spinlock.hpp>
+#include <hadoken/utility/optional.hpp>
 
 #include "parallel_generic_utils.hpp"
 #include <hadoken/parallel/algorithm.hpp>
@@ -49,77 +52,307 @@ namespace parallel {
 
 namespace detail {
 
-template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryOperation>
-OutputIt _internal_inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first,
-                                  BinaryOperation binary_op) {
-    (void)(policy);
-    using value_type = typename std::iterator_traits<OutputIt>::value_type;
-    using tuple_it_val = std::tuple<OutputIt, value_type>;
+// projection of the scans without transform
+struct __scan_identity {
+    template <typename T>
+    inline const T& operator()(const T& v) const {
+        return v;
+    }
+};
+
+
+// tile status of the decoupled look-back
+static constexpr int __tile_invalid = 0;
+static constexpr int __tile_aggregate = 1;
+static constexpr int __tile_prefix = 2;
+static constexpr int __tile_failed = 3;
+
+template <typename T>
+struct __scan_tiles {
+    inline __scan_tiles(std::size_t n_tiles, const T& seed)
+        : status(n_tiles), aggregate(n_tiles, seed), inclusive(n_tiles, seed) {
+        for (auto& st : status) {
+            st.store(__tile_invalid, std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<std::atomic<int>> status;
+    std::vector<T> aggregate, inclusive;
+};
+
 
-    std::size_t n_elems = std::distance(first, last);
-    OutputIt d_end = d_first;
-    std::advance(d_end, n_elems);
+// combine the aggregates of the predecessors of tile until one of them publishes its inclusive prefix,
+// return false if a predecessor failed: its prefix never comes
+template <typename T, typename BinaryOp>
+inline bool __look_back(__scan_tiles<T>& tiles, std::size_t tile, BinaryOp& op, optional<T>& prefix) {
+    optional<T> running;
+
+    for (std::size_t j = tile - 1;; --j) {
+        int st;
+        std::size_t spin = 0;
+        while ((st = tiles.status[j].load(std::memory_order_acquire)) == __tile_invalid) {
+            // the predecessor is being processed by a running thread
+            if (++spin % 64 == 0) {
+                std::this_thread::yield();
+            }
+        }
+
+        if (st == __tile_failed) {
+            return false;
+        }
+        if (st == __tile_prefix) {
+            prefix = running ? op(tiles.inclusive[j], *running) : tiles.inclusive[j];
+            return true;
+        }
+        running = running ? op(tiles.aggregate[j], *running) : tiles.aggregate[j];
+    }
+}
+
+
+///
+/// single pass parallel scan with decoupled look-back ( Merrill & Garland )
+///
+/// the range is divided in tiles claimed in order by the threads. A tile computes its
+/// aggregate, publishes it, then combines the aggregates of its predecessors until one
+/// of them published its inclusive prefix. The tile is read a second time from the cache
+/// to write the result: the input is read once from memory and the output written once.
+/// A tile whose predecessor is already complete is scanned in a single pass.
+/// A tile throwing publishes a failed status: its successors stop instead of waiting
+/// for its prefix, and the exception is rethrown by the grid.
+///
+template <class ExecutionPolicy, class InputIt, class OutputIt, class T, class BinaryOp, class UnaryOp>
+OutputIt __lookback_scan(const ExecutionPolicy& policy, InputIt first, InputIt last, OutputIt d_first, BinaryOp op,
+                         UnaryOp proj, const optional<T>& init, bool inclusive) {
+    const std::size_t n_elems = std::size_t(std::distance(first, last));
+    OutputIt d_last = d_first;
+    std::advance(d_last, n_elems);
 
     if (n_elems == 0) {
-        return d_first;
+        return d_last;
     }
 
+    // tiles small enough to stay in cache between the two reads
+    constexpr std::size_t max_tile_size = 16384;
+    const std::size_t n_workers = is_parallel_policy(policy) ? __get_partition_size(policy, n_elems) : 1;
+    const std::size_t tile_size =
+        (n_workers <= 1) ? n_elems
+                         : std::max(policy.get_grain(), std::min(max_tile_size, (n_elems + n_workers - 1) / n_workers));
+    const std::size_t n_tiles = (n_elems + tile_size - 1) / tile_size;
+
+    __scan_tiles<T> tiles(n_tiles, init ? *init : T(proj(*first)));
+    std::atomic<std::size_t> next_tile(0);
+    std::atomic<bool> failed(false);
+
+    // return false if a predecessor failed
+    auto process_tile = [&](std::size_t tile) {
+        const std::size_t tile_begin = tile * tile_size;
+        const std::size_t tile_end = std::min(n_elems, tile_begin + tile_size);
+
+        InputIt in = first;
+        std::advance(in, tile_begin);
+        InputIt it = in;
+
+        // exclusive prefix of the tile
+        optional<T> prefix;
+        if (tile == 0) {
+            prefix = init;
+        } else if (tiles.status[tile - 1].load(std::memory_order_acquire) == __tile_prefix) {
+            // predecessor already done: single pass
+            prefix = tiles.inclusive[tile - 1];
+        } else {
+            // local aggregate, published for the successors before to look back
+            T aggregate(proj(*it));
+            for (std::size_t i = tile_begin + 1; i < tile_end; ++i) {
+                ++it;
+                aggregate = op(aggregate, proj(*it));
+            }
 
-    std::vector<tuple_it_val> limits_vec;
-    hadoken::thread::spin_lock _limit_lock;
-    limits_vec.reserve(64);
+            tiles.aggregate[tile] = aggregate;
+            tiles.status[tile].store(__tile_aggregate, std::memory_order_release);
+            if (__look_back(tiles, tile, op, prefix) == false) {
+                return false;
+            }
+
+            tiles.inclusive[tile] = op(*prefix, aggregate);
+            tiles.status[tile].store(__tile_prefix, std::memory_order_release);
+            it = in;
+        }
 
-    // first local inclusive scan
-    for_range(policy, first, last, [&](InputIt local_first, InputIt local_last) {
-        std::size_t distance_from_first = std::distance(first, local_first);
-        std::size_t local_n_elems = std::distance(local_first, local_last);
+        // write, read the input before to write the output: in place scans are allowed
+        OutputIt out = d_first;
+        std::advance(out, tile_begin);
 
-        OutputIt local_d_first = d_first;
-        std::advance(local_d_first, distance_from_first);
+        T acc = prefix ? *prefix : T(proj(*it));
+        std::size_t i = tile_begin;
 
-        std::partial_sum(local_first, local_last, local_d_first, binary_op);
+        if (inclusive) {
+            if (prefix) {
+                acc = op(acc, proj(*it));
+            }
+            *out = acc;
+            for (++i; i < tile_end; ++i) {
+                ++it;
+                ++out;
+                acc = op(acc, proj(*it));
+                *out = acc;
+            }
+        } else {
+            for (; i < tile_end; ++i, ++it, ++out) {
+                T v(proj(*it));
+                *out = acc;
+                acc = op(acc, v);
+            }
+        }
 
-        OutputIt d_local_end;
-        std::advance(local_d_first, local_n_elems - 1);
-        d_local_end = local_d_first;
-        std::advance(d_local_end, 1);
+        if (tiles.status[tile].load(std::memory_order_relaxed) != __tile_prefix) {
+            tiles.inclusive[tile] = acc;
+            tiles.status[tile].store(__tile_prefix, std::memory_order_release);
+        }
+        return true;
+    };
+
+    // the tiles are claimed in order: every claimed tile ends with a prefix or failed
+    auto worker = [&]() {
+        std::size_t tile;
+        while (failed.load(std::memory_order_relaxed) == false &&
+               (tile = next_tile.fetch_add(1, std::memory_order_relaxed)) < n_tiles) {
+            bool done = false;
+            try {
+                done = process_tile(tile);
+            } catch (...) {
+                failed.store(true, std::memory_order_relaxed);
+                tiles.status[tile].store(__tile_failed, std::memory_order_release);
+                throw;
+            }
 
-        {
-            std::lock_guard<hadoken::thread::spin_lock> _l(_limit_lock);
-            limits_vec.push_back(std::make_tuple(d_local_end, *local_d_first));
+            if (done == false) {
+                failed.store(true, std::memory_order_relaxed);
+                tiles.status[tile].store(__tile_failed, std::memory_order_release);
+                return;
+            }
         }
-    });
+    };
 
-    std::sort(limits_vec.begin(), limits_vec.end(),
-              [](const tuple_it_val& v1, const tuple_it_val& v2) { return std::get<0>(v1) < std::get<0>(v2); });
+    if (n_tiles == 1) {
+        worker();
+    } else {
+        __execute_grid(policy, int(n_workers), [&](int, int) { worker(); });
+    }
+    return d_last;
+}
 
+// result type of a projection on the elements of InputIt
+template <typename InputIt, typename UnaryOp>
+struct __scan_value {
+    using type = typename std::decay<decltype(std::declval<UnaryOp&>()(*std::declval<InputIt&>()))>::type;
+};
+
+// partial result of a worker, followed by a cache line of padding: partials of
+// neighbour workers never share a cache line
+template <typename T>
+struct __padded_partial {
+    static constexpr std::size_t cache_line_size = 64;
+
+    optional<T> value;
+    char _pad[cache_line_size];
+};
+
+
+// reduce the elements [begin, end) of read, begin < end, in order
+template <typename T, typename Reader, typename BinaryOp>
+inline T __reduce_block(std::size_t begin, std::size_t end, Reader& read, BinaryOp& op, std::false_type) {
+    T acc(read(begin));
+    for (std::size_t i = begin + 1; i < end; ++i) {
+        acc = op(acc, read(i));
+    }
+    return acc;
+}
 
-    // post sum of each chunk partial sum
-    for_range(policy, d_first, d_end, [&](InputIt local_first, InputIt local_last) {
-        if (local_first < std::get<0>(limits_vec[0]))
-            return;
+// vectorized reduction of the elements [begin, end) of read, begin < end
+//
+// the loop carries one accumulator per lane of a cache line instead of a single
+// dependency chain, the compiler maps the lanes on SIMD registers.
+// Valid for the arithmetic types, op is associative and commutative for reduce
+template <typename T, typename Reader, typename BinaryOp>
+inline T __reduce_block(std::size_t begin, std::size_t end, Reader& read, BinaryOp& op, std::true_type) {
+    constexpr std::size_t lanes = (sizeof(T) < 64) ? (64 / sizeof(T)) : 1;
+
+    if (end - begin < 2 * lanes) {
+        return __reduce_block<T>(begin, end, read, op, std::false_type());
+    }
 
-        value_type val = std::get<1>(limits_vec[0]);
+    T acc[lanes];
+    for (std::size_t l = 0; l < lanes; ++l) {
+        acc[l] = read(begin + l);
+    }
 
-        auto limit_it = limits_vec.begin();
-        std::advance(limit_it, 1);
+    const std::size_t blocks_end = begin + ((end - begin) / lanes) * lanes;
+    for (std::size_t i = begin + lanes; i < blocks_end; i += lanes) {
+#if defined(__GNUC__) && (__GNUC__ >= 8 || defined(__clang__))
+#pragma GCC unroll 64
+#endif
+        for (std::size_t l = 0; l < lanes; ++l) {
+            acc[l] = op(acc[l], read(i + l));
+        }
+    }
 
+    for (std::size_t l = 1; l < lanes; ++l) {
+        acc[0] = op(acc[0], acc[l]);
+    }
 
-        while (local_first < local_last) {
-            while (local_first >= std::get<0>(*limit_it) && limit_it < limits_vec.end()) {
-                val = binary_op(val, std::get<1>(*limit_it));
-                limit_it++;
-            }
+    for (std::size_t i = blocks_end; i < end; ++i) {
+        acc[0] = op(acc[0], read(i));
+    }
+    return acc[0];
+}
+
+
+///
+/// reduce the elements read(0) .. read(n-1) with op, starting from init, where
+/// n is the size of the range [first, last) used to partition the work
+///
+/// each worker accumulates its parts in its own padded partial, the partials are
+/// combined in worker order by the calling thread
+///
+template <class ExecutionPolicy, class Iterator, class T, class BinaryOp, class Reader>
+T __parallel_reduce(const ExecutionPolicy& policy, Iterator first, Iterator last, T init, BinaryOp op, Reader read) {
+    using vectorize = std::integral_constant<bool, is_vector_policy<ExecutionPolicy>::value && std::is_arithmetic<T>::value>;
 
-            *local_first = binary_op(val, *local_first);
-            local_first++;
-        };
+    const std::size_t n_elems = std::size_t(std::distance(first, last));
+    if (n_elems == 0) {
+        return init;
+    }
+
+    const std::size_t n_workers = is_parallel_policy(policy) ? __get_partition_size(policy, n_elems) : 1;
+
+    if (n_workers <= 1) {
+        return op(init, __reduce_block<T>(0, n_elems, read, op, vectorize()));
+    }
+
+    std::vector<__padded_partial<T>> partials(n_workers);
+
+    __parallel_for_range_id(policy, first, last, [&](std::size_t id, Iterator sub_begin, Iterator sub_end) {
+        if (sub_begin == sub_end) {
+            return;
+        }
+        const std::size_t begin = std::size_t(std::distance(first, sub_begin));
+        T local = __reduce_block<T>(begin, begin + std::size_t(std::distance(sub_begin, sub_end)), read, op, vectorize());
+        optional<T>& partial = partials[id].value;
+        partial = partial ? op(*partial, local) : local;
     });
-    return d_first;
+
+    for (const auto& partial : partials) {
+        if (partial.value) {
+            init = op(init, *partial.value);
+        }
+    }
+    return init;
 }
 
+
 } // namespace detail
 
+
 // inclusive scan algorithm
 template <class ExecutionPolicy, class InputIt, class OutputIt>
 OutputIt inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first) {
@@ -131,11 +364,113 @@ OutputIt inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, O
 // inclusive scan algorithm
 template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryOperation>
 OutputIt inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, BinaryOperation binary_op) {
-    if (detail::is_parallel_policy(policy)) {
-        // to improve
-        return detail::_internal_inclusive_scan(std::forward<ExecutionPolicy>(policy), first, last, d_first, binary_op);
-    }
-    return std::partial_sum(first, last, d_first, binary_op);
+    using value_type = typename std::iterator_traits<InputIt>::value_type;
+
+    return detail::__lookback_scan(policy, first, last, d_first, binary_op, detail::__scan_identity(), optional<value_type>(),
+                                   true);
+}
+
+// inclusive scan algorithm with initial value
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryOperation, class T>
+OutputIt inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, BinaryOperation binary_op,
+                        T init) {
+    return detail::__lookback_scan(policy, first, last, d_first, binary_op, detail::__scan_identity(), optional<T>(init), true);
+}
+
+// exclusive scan algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt, class T>
+OutputIt exclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, T init) {
+    return exclusive_scan(std::forward<ExecutionPolicy>(policy), first, last, d_first, init, std::plus<T>());
+}
+
+// exclusive scan algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt, class T, class BinaryOperation>
+OutputIt exclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, T init,
+                        BinaryOperation binary_op) {
+    return detail::__lookback_scan(policy, first, last, d_first, binary_op, detail::__scan_identity(), optional<T>(init),
+                                   false);
+}
+
+// transform inclusive scan algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryOperation, class UnaryOperation>
+OutputIt transform_inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first,
+                                  BinaryOperation binary_op, UnaryOperation unary_op) {
+    using value_type = typename detail::__scan_value<InputIt, UnaryOperation>::type;
+
+    return detail::__lookback_scan(policy, first, last, d_first, binary_op, unary_op, optional<value_type>(), true);
+}
+
+// transform inclusive scan algorithm with initial value
+template <class ExecutionPolicy, class InputIt, class OutputIt, class BinaryOperation, class UnaryOperation, class T>
+OutputIt transform_inclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first,
+                                  BinaryOperation binary_op, UnaryOperation unary_op, T init) {
+    return detail::__lookback_scan(policy, first, last, d_first, binary_op, unary_op, optional<T>(init), true);
+}
+
+// transform exclusive scan algorithm
+template <class ExecutionPolicy, class InputIt, class OutputIt, class T, class BinaryOperation, class UnaryOperation>
+OutputIt transform_exclusive_scan(ExecutionPolicy&& policy, InputIt first, InputIt last, OutputIt d_first, T init,
+                                  BinaryOperation binary_op, UnaryOperation unary_op) {
+    return detail::__lookback_scan(policy, first, last, d_first, binary_op, unary_op, optional<T>(init), false);
+}
+
+// reduce algorithm
+template <class ExecutionPolicy, class ForwardIt>
+typename std::iterator_traits<ForwardIt>::value_type reduce(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last) {
+    using value_type = typename std::iterator_traits<ForwardIt>::value_type;
+
+    return reduce(std::forward<ExecutionPolicy>(policy), first, last, value_type(), std::plus<value_type>());
+}
+
+// reduce algorithm with initial value
+template <class ExecutionPolicy, class ForwardIt, class T>
+T reduce(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, T init) {
+    return reduce(std::forward<ExecutionPolicy>(policy), first, last, init, std::plus<T>());
+}
+
+// reduce algorithm binary op
+template <class ExecutionPolicy, class ForwardIt, class T, class BinaryOp>
+T reduce(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, T init, BinaryOp binary_op) {
+    static_assert(
+        std::is_same<typename std::iterator_traits<ForwardIt>::iterator_category, std::random_access_iterator_tag>::value,
+        "parallel::reduce requires random_access_iterator");
+
+    return detail::__parallel_reduce(policy, first, last, init, binary_op,
+                                     [first](std::size_t i) -> decltype(first[i]) { return first[i]; });
+}
+
+// transform reduce algorithm, inner product of two ranges
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2, class T>
+T transform_reduce(ExecutionPolicy&& policy, ForwardIt1 first1, ForwardIt1 last1, ForwardIt2 first2, T init) {
+    return transform_reduce(std::forward<ExecutionPolicy>(policy), first1, last1, first2, init, std::plus<T>(),
+                            std::multiplies<T>());
+}
+
+// transform reduce algorithm on two ranges
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2, class T, class BinaryReductionOp, class BinaryTransformOp>
+T transform_reduce(ExecutionPolicy&& policy, ForwardIt1 first1, ForwardIt1 last1, ForwardIt2 first2, T init,
+                   BinaryReductionOp reduce_op, BinaryTransformOp transform_op) {
+    static_assert(
+        std::is_same<typename std::iterator_traits<ForwardIt1>::iterator_category, std::random_access_iterator_tag>::value &&
+            std::is_same<typename std::iterator_traits<ForwardIt2>::iterator_category, std::random_access_iterator_tag>::value,
+        "parallel::transform_reduce requires random_access_iterator");
+
+    return detail::__parallel_reduce(policy, first1, last1, init, reduce_op,
+                                     [first1, first2, &transform_op](std::size_t i) {
+                                         return transform_op(first1[i], first2[i]);
+                                     });
+}
+
+// transform reduce algorithm
+template <class ExecutionPolicy, class ForwardIt, class T, class BinaryReductionOp, class UnaryTransformOp>
+T transform_reduce(ExecutionPolicy&& policy, ForwardIt first, ForwardIt last, T init, BinaryReductionOp reduce_op,
+                   UnaryTransformOp transform_op) {
+    static_assert(
+        std::is_same<typename std::iterator_traits<ForwardIt>::iterator_category, std::random_access_iterator_tag>::value,
+        "parallel::transform_reduce requires random_access_iterator");
+
+    return detail::__parallel_reduce(policy, first, last, init, reduce_op,
+                                     [first, &transform_op](std::size_t i) { return transform_op(first[i]); });
 }
 
 } // namespace parallel
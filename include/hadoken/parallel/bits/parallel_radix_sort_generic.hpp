@@ -0,0 +1,275 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef PARALLEL_RADIX_SORT_GENERIC_HPP
+#define PARALLEL_RADIX_SORT_GENERIC_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <hadoken/parallel/algorithm.hpp>
+
+
+#include "parallel_copy_generic.hpp"
+#include "parallel_generic_utils.hpp"
+
+
+namespace hadoken {
+
+
+namespace parallel {
+
+
+namespace detail {
+
+
+// unsigned integer of the same size than Key
+template <std::size_t Size>
+struct __radix_uint;
+
+template <>
+struct __radix_uint<1> {
+    using type = std::uint8_t;
+};
+
+template <>
+struct __radix_uint<2> {
+    using type = std::uint16_t;
+};
+
+template <>
+struct __radix_uint<4> {
+    using type = std::uint32_t;
+};
+
+template <>
+struct __radix_uint<8> {
+    using type = std::uint64_t;
+};
+
+
+///
+/// map a key to an unsigned integer with the same ordering
+///
+/// signed integers: flip the sign bit
+/// floating points: flip all the bits of negative values, the sign bit of the positive ones
+///
+template <typename Key, typename Enable = void>
+struct __radix_key_traits;
+
+template <typename Key>
+struct __radix_key_traits<Key, typename std::enable_if<std::is_integral<Key>::value>::type> {
+    using uint_type = typename __radix_uint<sizeof(Key)>::type;
+
+    static inline uint_type to_uint(Key k) {
+        const uint_type sign_flip = std::is_signed<Key>::value ? (uint_type(1) << (sizeof(Key) * 8 - 1)) : uint_type(0);
+        return uint_type(uint_type(k) ^ sign_flip);
+    }
+};
+
+template <typename Key>
+struct __radix_key_traits<Key, typename std::enable_if<std::is_floating_point<Key>::value>::type> {
+    using uint_type = typename __radix_uint<sizeof(Key)>::type;
+
+    static_assert(std::numeric_limits<Key>::is_iec559, "radix_sort requires IEEE 754 floating points");
+
+    static inline uint_type to_uint(Key k) {
+        uint_type bits;
+        std::memcpy(&bits, &k, sizeof(Key));
+
+        const uint_type sign_bit = uint_type(1) << (sizeof(Key) * 8 - 1);
+        return (bits & sign_bit) ? uint_type(~bits) : uint_type(bits | sign_bit);
+    }
+};
+
+
+// default key extractor: the value itself
+struct __radix_identity {
+    template <typename T>
+    inline const T& operator()(const T& v) const {
+        return v;
+    }
+};
+
+
+static constexpr std::size_t __radix_bits = 8;
+static constexpr std::size_t __radix_buckets = std::size_t(1) << __radix_bits;
+
+using __radix_histogram = std::array<std::size_t, __radix_buckets>;
+
+
+// fun(id, n_parts) for each part, a single part runs in the calling thread:
+// a sequential sort does not start the threads of the executor
+template <typename ExecPolicy, typename Function>
+inline void __radix_grid(const ExecPolicy& policy, std::size_t n_parts, Function fun) {
+    if (n_parts <= 1) {
+        fun(0, 1);
+        return;
+    }
+    __execute_grid(policy, int(n_parts), fun);
+}
+
+
+// one pass of counting sort on the digit at shift, stable, src -> dst
+template <typename ExecPolicy, typename SrcIt, typename DstIt, typename ToUint>
+inline bool __radix_pass(const ExecPolicy& policy, SrcIt src, DstIt dst, const std::vector<std::size_t>& bounds,
+                         std::vector<__radix_histogram>& histograms, std::size_t shift, ToUint& to_uint) {
+    const std::size_t n_parts = bounds.size() - 1;
+    const std::size_t n_elems = bounds[n_parts];
+
+    // per part histogram
+    __radix_grid(policy, n_parts, [&](int id, int) {
+        __radix_histogram& hist = histograms[id];
+        hist.fill(0);
+        for (std::size_t i = bounds[id]; i < bounds[id + 1]; ++i) {
+            hist[(to_uint(src[i]) >> shift) & (__radix_buckets - 1)] += 1;
+        }
+    });
+
+    // exclusive scan in ( digit, part ) order: each part writes its elements
+    // of a given digit after the ones of the previous parts, the pass is stable
+    std::size_t offset = 0;
+    for (std::size_t digit = 0; digit < __radix_buckets; ++digit) {
+        std::size_t digit_total = 0;
+        for (std::size_t part = 0; part < n_parts; ++part) {
+            digit_total += histograms[part][digit];
+        }
+
+        // all the keys share this digit: nothing to do
+        if (digit_total == n_elems) {
+            return false;
+        }
+
+        for (std::size_t part = 0; part < n_parts; ++part) {
+            const std::size_t count = histograms[part][digit];
+            histograms[part][digit] = offset;
+            offset += count;
+        }
+    }
+
+    // scatter
+    __radix_grid(policy, n_parts, [&](int id, int) {
+        __radix_histogram& positions = histograms[id];
+        for (std::size_t i = bounds[id]; i < bounds[id + 1]; ++i) {
+            const std::size_t digit = (to_uint(src[i]) >> shift) & (__radix_buckets - 1);
+            dst[positions[digit]++] = std::move(src[i]);
+        }
+    });
+    return true;
+}
+
+
+///
+/// parallel LSD radix sort, 8 bits per pass
+///
+/// every pass builds one histogram per part, scans them and scatters
+/// the values to a buffer, passes where all keys share the same digit are skipped.
+/// The values are scattered from the input to the uninitialized buffer at the first pass
+///
+template <typename ExecPolicy, typename RandomIt, typename KeyExtractor>
+inline void __parallel_radix_sort(const ExecPolicy& policy, RandomIt first, RandomIt last, KeyExtractor key_extractor) {
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+    using key_type = typename std::decay<decltype(key_extractor(std::declval<const value_type&>()))>::type;
+    using traits = __radix_key_traits<key_type>;
+
+    const std::size_t n_elems = std::size_t(std::distance(first, last));
+    if (n_elems <= 1) {
+        return;
+    }
+
+    const std::size_t n_parts = is_parallel_policy(policy) ? __get_partition_size(policy, n_elems) : 1;
+
+    std::vector<std::size_t> bounds(n_parts + 1);
+    for (std::size_t i = 0; i < n_parts; ++i) {
+        bounds[i] = (n_elems / n_parts) * i + std::min(i, n_elems % n_parts);
+    }
+    bounds[n_parts] = n_elems;
+
+    std::vector<__radix_histogram> histograms(n_parts);
+
+    auto to_uint = [&key_extractor](const value_type& v) { return traits::to_uint(key_extractor(v)); };
+
+    // uninitialized buffer, the first pass scattering the values constructs them
+    __raw_buffer<value_type> raw_buffer(n_elems);
+    value_type* const buffer = raw_buffer.data();
+    bool in_buffer = false, constructed = false;
+
+    for (std::size_t shift = 0; shift < sizeof(key_type) * 8; shift += __radix_bits) {
+        bool moved;
+        if (in_buffer) {
+            moved = __radix_pass(policy, buffer, first, bounds, histograms, shift, to_uint);
+        } else if (constructed) {
+            moved = __radix_pass(policy, first, buffer, bounds, histograms, shift, to_uint);
+        } else {
+            moved = __radix_pass(policy, first, __construct_iterator<value_type>(buffer), bounds, histograms, shift, to_uint);
+            constructed = moved;
+        }
+
+        if (moved) {
+            in_buffer = !in_buffer;
+        }
+    }
+
+    if (constructed) {
+        __radix_grid(policy, n_parts, [&](int id, int) {
+            if (in_buffer) {
+                std::move(buffer + bounds[id], buffer + bounds[id + 1], first + bounds[id]);
+            }
+            __destroy_block(buffer + bounds[id], buffer + bounds[id + 1]);
+        });
+    }
+}
+
+
+} // namespace detail
+
+
+// radix sort algorithm
+template <class ExecutionPolicy, class RandomIt>
+void radix_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last) {
+    detail::__parallel_radix_sort(policy, first, last, detail::__radix_identity());
+}
+
+// radix sort algorithm with key extractor
+template <class ExecutionPolicy, class RandomIt, class KeyExtractor>
+void radix_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last, KeyExtractor key_extractor) {
+    detail::__parallel_radix_sort(policy, first, last, key_extractor);
+}
+
+
+} // namespace parallel
+
+} // namespace hadoken
+
+#endif // PARALLEL_RADIX_SORT_GENERIC_HPP
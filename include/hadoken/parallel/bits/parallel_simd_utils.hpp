@@ -0,0 +1,461 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef PARALLEL_SIMD_UTILS_HPP
+#define PARALLEL_SIMD_UTILS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+
+#include "parallel_generic_utils.hpp"
+
+
+#define HADOKEN_SIMD_STRINGIFY(x) #x
+
+///
+/// loop hints of the vector execution policies
+///
+/// HADOKEN_PRAGMA_SIMD maps to "omp simd" when OpenMP, or only its SIMD subset
+/// ( -fopenmp-simd -DHADOKEN_OPENMP_SIMD ), is enabled. It maps to the no-dependency
+/// hint of the compiler otherwise
+///
+#if defined(_OPENMP) || defined(HADOKEN_OPENMP_SIMD)
+#define HADOKEN_PRAGMA_SIMD _Pragma("omp simd")
+#define HADOKEN_PRAGMA_SIMD_SUM(var) _Pragma(HADOKEN_SIMD_STRINGIFY(omp simd reduction(+ : var)))
+#elif defined(__clang__)
+#define HADOKEN_PRAGMA_SIMD _Pragma("clang loop vectorize(enable) interleave(enable)")
+#define HADOKEN_PRAGMA_SIMD_SUM(var) _Pragma("clang loop vectorize(enable) interleave(enable)")
+#elif defined(__GNUC__)
+#define HADOKEN_PRAGMA_SIMD _Pragma("GCC ivdep")
+#define HADOKEN_PRAGMA_SIMD_SUM(var) _Pragma("GCC ivdep")
+#else
+#define HADOKEN_PRAGMA_SIMD
+#define HADOKEN_PRAGMA_SIMD_SUM(var)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HADOKEN_RESTRICT __restrict__
+#define HADOKEN_ASSUME_ALIGNED(ptr, alignment) __builtin_assume_aligned((ptr), (alignment))
+#elif defined(_MSC_VER)
+#define HADOKEN_RESTRICT __restrict
+#define HADOKEN_ASSUME_ALIGNED(ptr, alignment) (ptr)
+#else
+#define HADOKEN_RESTRICT
+#define HADOKEN_ASSUME_ALIGNED(ptr, alignment) (ptr)
+#endif
+
+
+namespace hadoken {
+
+
+namespace parallel {
+
+
+namespace detail {
+
+
+// alignment of the vector loops, widest SIMD register and cache line
+static constexpr std::size_t __simd_alignment = 64;
+
+
+// iterators of std::vector, except std::vector<bool>
+template <typename Iterator, typename Value,
+          bool = std::is_object<Value>::value && !std::is_same<Value, bool>::value>
+struct __is_vector_iterator : std::false_type {};
+
+template <typename Iterator, typename Value>
+struct __is_vector_iterator<Iterator, Value, true>
+    : std::integral_constant<bool, std::is_same<Iterator, typename std::vector<Value>::iterator>::value ||
+                                       std::is_same<Iterator, typename std::vector<Value>::const_iterator>::value> {};
+
+// iterators over contiguous memory, C++11 has no contiguous_iterator_tag: pointers and vector iterators
+template <typename Iterator>
+struct __is_contiguous_iterator
+    : std::integral_constant<bool, std::is_pointer<Iterator>::value ||
+                                       __is_vector_iterator<Iterator,
+                                                            typename std::iterator_traits<Iterator>::value_type>::value> {};
+
+// elements of the vector loops: arithmetic types packing exactly a chunk of __simd_alignment bytes
+template <typename T>
+struct __is_simd_value
+    : std::integral_constant<bool, std::is_arithmetic<T>::value && (__simd_alignment % sizeof(T) == 0)> {};
+
+// select the vector loops: vector execution policy, contiguous iterators over arithmetic elements
+template <typename ExecPolicy, typename... Iterators>
+struct __use_simd;
+
+template <typename ExecPolicy>
+struct __use_simd<ExecPolicy> : is_vector_policy<ExecPolicy> {};
+
+template <typename ExecPolicy, typename Iterator, typename... Iterators>
+struct __use_simd<ExecPolicy, Iterator, Iterators...>
+    : std::integral_constant<bool, __is_contiguous_iterator<Iterator>::value &&
+                                       __is_simd_value<typename std::iterator_traits<Iterator>::value_type>::value &&
+                                       __use_simd<ExecPolicy, Iterators...>::value> {};
+
+
+// address of the element of a dereferenceable contiguous iterator
+template <typename Iterator>
+inline typename std::remove_reference<typename std::iterator_traits<Iterator>::reference>::type* __to_pointer(Iterator it) {
+    return std::addressof(*it);
+}
+
+
+// number of elements before the first element of ptr aligned on __simd_alignment, at most n
+template <typename T>
+inline std::size_t __simd_peel_size(const T* ptr, std::size_t n) {
+    const std::size_t misalignment = std::size_t(reinterpret_cast<std::uintptr_t>(ptr) % __simd_alignment);
+
+    if (misalignment == 0 || misalignment % sizeof(T) != 0) {
+        return 0;
+    }
+    return std::min(n, (__simd_alignment - misalignment) / sizeof(T));
+}
+
+// true if ptr is aligned on __simd_alignment, the peeling does not reach it for under-aligned pointers
+template <typename T>
+inline bool __simd_is_aligned(const T* ptr) {
+    return reinterpret_cast<std::uintptr_t>(ptr) % __simd_alignment == 0;
+}
+
+// number of elements of a chunk of __simd_alignment bytes
+template <typename T>
+struct __simd_width : std::integral_constant<std::size_t, (sizeof(T) < __simd_alignment) ? __simd_alignment / sizeof(T) : 1> {};
+
+
+///
+/// vector loops on contiguous memory
+///
+/// the elements before the first aligned address are peeled off, the main loop works on
+/// aligned chunks of __simd_alignment bytes: the constant trip count of the chunk loop lets
+/// the compiler vectorize without epilogue or runtime checks, even with its cheapest cost model.
+/// The remaining elements are processed one by one. The alignment is only assumed when the
+/// peeling actually reached the boundary
+///
+
+template <typename T, typename Function>
+inline void __simd_for_each(T* first, std::size_t n, Function& fun) {
+    constexpr std::size_t width = __simd_width<T>::value;
+
+    const std::size_t peel = __simd_peel_size(first, n);
+    for (std::size_t i = 0; i < peel; ++i) {
+        fun(first[i]);
+    }
+
+    std::size_t i = peel;
+    if (__simd_is_aligned(first + i)) {
+        for (; n - i >= width; i += width) {
+            T* chunk = static_cast<T*>(HADOKEN_ASSUME_ALIGNED(first + i, __simd_alignment));
+            HADOKEN_PRAGMA_SIMD
+            for (std::size_t l = 0; l < width; ++l) {
+                fun(chunk[l]);
+            }
+        }
+    } else {
+        for (; n - i >= width; i += width) {
+            T* chunk = first + i;
+            HADOKEN_PRAGMA_SIMD
+            for (std::size_t l = 0; l < width; ++l) {
+                fun(chunk[l]);
+            }
+        }
+    }
+
+    for (; i < n; ++i) {
+        fun(first[i]);
+    }
+}
+
+
+template <typename T, typename U>
+inline void __simd_fill(T* first, std::size_t n, const U& value) {
+    constexpr std::size_t width = __simd_width<T>::value;
+    const T v(value);
+
+    const std::size_t peel = __simd_peel_size(first, n);
+    for (std::size_t i = 0; i < peel; ++i) {
+        first[i] = v;
+    }
+
+    std::size_t i = peel;
+    if (__simd_is_aligned(first + i)) {
+        for (; n - i >= width; i += width) {
+            T* chunk = static_cast<T*>(HADOKEN_ASSUME_ALIGNED(first + i, __simd_alignment));
+            HADOKEN_PRAGMA_SIMD
+            for (std::size_t l = 0; l < width; ++l) {
+                chunk[l] = v;
+            }
+        }
+    } else {
+        for (; n - i >= width; i += width) {
+            T* chunk = first + i;
+            HADOKEN_PRAGMA_SIMD
+            for (std::size_t l = 0; l < width; ++l) {
+                chunk[l] = v;
+            }
+        }
+    }
+
+    for (; i < n; ++i) {
+        first[i] = v;
+    }
+}
+
+
+// in place transform
+template <typename T, typename UnaryOp>
+inline void __simd_transform_inplace(T* data, std::size_t n, UnaryOp& op) {
+    auto apply = [&op](T& v) { v = op(v); };
+    __simd_for_each(data, n, apply);
+}
+
+// transform of distinct ranges, chunks aligned on the output
+template <typename In, typename Out, typename UnaryOp>
+inline void __simd_transform_restrict(const In* HADOKEN_RESTRICT in, Out* HADOKEN_RESTRICT out, std::size_t n, UnaryOp& op) {
+    constexpr std::size_t width = __simd_width<Out>::value;
+
+    const std::size_t peel = __simd_peel_size(out, n);
+    for (std::size_t i = 0; i < peel; ++i) {
+        out[i] = op(in[i]);
+    }
+
+    std::size_t i = peel;
+    for (; n - i >= width; i += width) {
+        HADOKEN_PRAGMA_SIMD
+        for (std::size_t l = 0; l < width; ++l) {
+            out[i + l] = op(in[i + l]);
+        }
+    }
+
+    for (; i < n; ++i) {
+        out[i] = op(in[i]);
+    }
+}
+
+// transform of distinct ranges, chunks aligned on the output
+template <typename In1, typename In2, typename Out, typename BinaryOp>
+inline void __simd_transform_restrict(const In1* HADOKEN_RESTRICT in1, const In2* HADOKEN_RESTRICT in2,
+                                      Out* HADOKEN_RESTRICT out, std::size_t n, BinaryOp& op) {
+    constexpr std::size_t width = __simd_width<Out>::value;
+
+    const std::size_t peel = __simd_peel_size(out, n);
+    for (std::size_t i = 0; i < peel; ++i) {
+        out[i] = op(in1[i], in2[i]);
+    }
+
+    std::size_t i = peel;
+    for (; n - i >= width; i += width) {
+        HADOKEN_PRAGMA_SIMD
+        for (std::size_t l = 0; l < width; ++l) {
+            out[i + l] = op(in1[i + l], in2[i + l]);
+        }
+    }
+
+    for (; i < n; ++i) {
+        out[i] = op(in1[i], in2[i]);
+    }
+}
+
+
+// the output and the input are either distinct or equal ( in place )
+template <typename In, typename Out, typename UnaryOp>
+inline void __simd_transform(const In* in, Out* out, std::size_t n, UnaryOp& op) {
+    if (static_cast<const void*>(in) == static_cast<const void*>(out)) {
+        __simd_transform_inplace(out, n, op);
+        return;
+    }
+    __simd_transform_restrict(in, out, n, op);
+}
+
+// update(inout[i], in[i]) for distinct ranges, chunks aligned on inout
+template <typename In, typename Out, typename Update>
+inline void __simd_update(const In* HADOKEN_RESTRICT in, Out* HADOKEN_RESTRICT inout, std::size_t n, Update& update) {
+    constexpr std::size_t width = __simd_width<Out>::value;
+
+    const std::size_t peel = __simd_peel_size(inout, n);
+    for (std::size_t i = 0; i < peel; ++i) {
+        update(inout[i], in[i]);
+    }
+
+    std::size_t i = peel;
+    for (; n - i >= width; i += width) {
+        HADOKEN_PRAGMA_SIMD
+        for (std::size_t l = 0; l < width; ++l) {
+            update(inout[i + l], in[i + l]);
+        }
+    }
+
+    for (; i < n; ++i) {
+        update(inout[i], in[i]);
+    }
+}
+
+// the output and the inputs are either distinct or equal ( in place )
+template <typename In1, typename In2, typename Out, typename BinaryOp>
+inline void __simd_transform(const In1* in1, const In2* in2, Out* out, std::size_t n, BinaryOp& op) {
+    const bool first_in_place = (static_cast<const void*>(in1) == static_cast<const void*>(out));
+    const bool second_in_place = (static_cast<const void*>(in2) == static_cast<const void*>(out));
+
+    if (first_in_place && second_in_place) {
+        auto apply = [&op](Out& v) { v = op(v, v); };
+        __simd_for_each(out, n, apply);
+    } else if (first_in_place) {
+        auto apply = [&op](Out& v, const In2& w) { v = op(v, w); };
+        __simd_update(in2, out, n, apply);
+    } else if (second_in_place) {
+        auto apply = [&op](Out& v, const In1& w) { v = op(w, v); };
+        __simd_update(in1, out, n, apply);
+    } else {
+        __simd_transform_restrict(in1, in2, out, n, op);
+    }
+}
+
+
+template <typename T, typename UnaryPredicate>
+inline std::size_t __simd_count_if(const T* first, std::size_t n, UnaryPredicate& p) {
+    constexpr std::size_t width = __simd_width<T>::value;
+    std::size_t count = 0;
+
+    const std::size_t peel = __simd_peel_size(first, n);
+    for (std::size_t i = 0; i < peel; ++i) {
+        count += p(first[i]) ? 1 : 0;
+    }
+
+    std::size_t i = peel;
+    if (__simd_is_aligned(first + i)) {
+        for (; n - i >= width; i += width) {
+            const T* chunk = static_cast<const T*>(HADOKEN_ASSUME_ALIGNED(first + i, __simd_alignment));
+            std::size_t chunk_count = 0;
+            HADOKEN_PRAGMA_SIMD_SUM(chunk_count)
+            for (std::size_t l = 0; l < width; ++l) {
+                chunk_count += p(chunk[l]) ? 1 : 0;
+            }
+            count += chunk_count;
+        }
+    } else {
+        for (; n - i >= width; i += width) {
+            const T* chunk = first + i;
+            std::size_t chunk_count = 0;
+            HADOKEN_PRAGMA_SIMD_SUM(chunk_count)
+            for (std::size_t l = 0; l < width; ++l) {
+                chunk_count += p(chunk[l]) ? 1 : 0;
+            }
+            count += chunk_count;
+        }
+    }
+
+    for (; i < n; ++i) {
+        count += p(first[i]) ? 1 : 0;
+    }
+    return count;
+}
+
+
+///
+/// block kernels of the algorithms: the vector loops when the policy allows vector
+/// execution on contiguous iterators, the STL algorithm otherwise
+///
+
+template <typename Iterator, typename Function>
+inline void __for_each_block(Iterator first, Iterator last, Function fun, std::false_type) {
+    std::for_each(first, last, fun);
+}
+
+template <typename Iterator, typename Function>
+inline void __for_each_block(Iterator first, Iterator last, Function fun, std::true_type) {
+    if (first != last) {
+        __simd_for_each(__to_pointer(first), std::size_t(std::distance(first, last)), fun);
+    }
+}
+
+template <typename Iterator, typename T>
+inline void __fill_block(Iterator first, Iterator last, const T& value, std::false_type) {
+    std::fill(first, last, value);
+}
+
+template <typename Iterator, typename T>
+inline void __fill_block(Iterator first, Iterator last, const T& value, std::true_type) {
+    if (first != last) {
+        __simd_fill(__to_pointer(first), std::size_t(std::distance(first, last)), value);
+    }
+}
+
+template <typename InputIt, typename OutputIt, typename UnaryOp>
+inline void __transform_block(InputIt first, InputIt last, OutputIt d_first, UnaryOp op, std::false_type) {
+    std::transform(first, last, d_first, op);
+}
+
+template <typename InputIt, typename OutputIt, typename UnaryOp>
+inline void __transform_block(InputIt first, InputIt last, OutputIt d_first, UnaryOp op, std::true_type) {
+    if (first != last) {
+        __simd_transform(__to_pointer(first), __to_pointer(d_first), std::size_t(std::distance(first, last)), op);
+    }
+}
+
+template <typename InputIt1, typename InputIt2, typename OutputIt, typename BinaryOp>
+inline void __transform_block(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt d_first, BinaryOp op,
+                              std::false_type) {
+    std::transform(first1, last1, first2, d_first, op);
+}
+
+template <typename InputIt1, typename InputIt2, typename OutputIt, typename BinaryOp>
+inline void __transform_block(InputIt1 first1, InputIt1 last1, InputIt2 first2, OutputIt d_first, BinaryOp op,
+                              std::true_type) {
+    if (first1 != last1) {
+        __simd_transform(__to_pointer(first1), __to_pointer(first2), __to_pointer(d_first),
+                         std::size_t(std::distance(first1, last1)), op);
+    }
+}
+
+template <typename Iterator, typename UnaryPredicate>
+inline std::size_t __count_if_block(Iterator first, Iterator last, UnaryPredicate p, std::false_type) {
+    return std::size_t(std::count_if(first, last, p));
+}
+
+template <typename Iterator, typename UnaryPredicate>
+inline std::size_t __count_if_block(Iterator first, Iterator last, UnaryPredicate p, std::true_type) {
+    if (first == last) {
+        return 0;
+    }
+    return __simd_count_if(__to_pointer(first), std::size_t(std::distance(first, last)), p);
+}
+
+
+} // namespace detail
+
+} // namespace parallel
+
+} // namespace hadoken
+
+#endif // PARALLEL_SIMD_UTILS_HPP
@@ -31,9 +31,16 @@
 
 #include <algorithm>
 #include <atomic>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
 #include <hadoken/parallel/algorithm.hpp>
 
 
+#include "parallel_copy_generic.hpp"
 #include "parallel_generic_utils.hpp"
 
 
@@ -43,24 +50,443 @@ namespace hadoken {
 namespace parallel {
 
 
-namespace detail {} // namespace detail
+namespace detail {
+
+
+template <typename RandomIt, typename Compare>
+inline void __sort_block(RandomIt first, RandomIt last, Compare comp, std::false_type) {
+    std::sort(first, last, comp);
+}
+
+template <typename RandomIt, typename Compare>
+inline void __sort_block(RandomIt first, RandomIt last, Compare comp, std::true_type) {
+    std::stable_sort(first, last, comp);
+}
+
+
+///
+/// co-rank of the merge of the sorted sequences a[0, n_a) and b[0, n_b)
+///
+/// return the number of elements of a among the k first elements of the merged output,
+/// the elements of a come first on equality
+///
+template <typename ItA, typename ItB, typename Compare>
+inline std::size_t __co_rank(std::size_t k, ItA a, std::size_t n_a, ItB b, std::size_t n_b, Compare& comp) {
+    std::size_t low = (k > n_b) ? (k - n_b) : 0, high = std::min(k, n_a);
+
+    while (low < high) {
+        const std::size_t mid = low + (high - low) / 2;
+        // a[mid] is part of the k first elements if it does not go after b[k - mid - 1]
+        if (!comp(b[k - mid - 1], a[mid])) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+
+template <typename ItA, typename ItB, typename OutputIt, typename Compare>
+inline void __merge_block(ItA first1, ItA last1, ItB first2, ItB last2, OutputIt d_first, Compare& comp, std::false_type) {
+    std::merge(first1, last1, first2, last2, d_first, comp);
+}
+
+template <typename ItA, typename ItB, typename OutputIt, typename Compare>
+inline void __merge_block(ItA first1, ItA last1, ItB first2, ItB last2, OutputIt d_first, Compare& comp, std::true_type) {
+    std::merge(std::make_move_iterator(first1), std::make_move_iterator(last1), std::make_move_iterator(first2),
+               std::make_move_iterator(last2), d_first, comp);
+}
+
+
+// write the elements [k_begin, k_end) of the merge of a and b to d_first + k_begin,
+// i_begin and i_end are the co-ranks of k_begin and k_end
+template <typename ItA, typename ItB, typename OutputIt, typename Compare, typename Move>
+inline void __merge_path_block(ItA a, ItB b, OutputIt d_first, std::size_t k_begin, std::size_t i_begin, std::size_t k_end,
+                               std::size_t i_end, Compare& comp, Move move) {
+    __merge_block(a + i_begin, a + i_end, b + (k_begin - i_begin), b + (k_end - i_end), d_first + k_begin, comp, move);
+}
+
+
+///
+/// parallel merge: the output is divided in one part per worker, the co-rank of the part bounds
+/// gives the input sub-ranges of each part, every worker produces the same number of elements
+///
+/// all the co-ranks are computed before the first merge: the input elements are moved if Move
+///
+template <typename ExecPolicy, typename ItA, typename ItB, typename OutputIt, typename Compare, typename Move>
+inline OutputIt __parallel_merge_path(const ExecPolicy& policy, ItA first1, ItA last1, ItB first2, ItB last2, OutputIt d_first,
+                                      Compare comp, Move move) {
+    const std::size_t n_a = std::size_t(std::distance(first1, last1)), n_b = std::size_t(std::distance(first2, last2));
+    const std::size_t n_elems = n_a + n_b;
+    const std::size_t n_parts = __get_partition_size(policy, n_elems);
+
+    if (n_parts <= 1) {
+        __merge_block(first1, last1, first2, last2, d_first, comp, move);
+        return d_first + n_elems;
+    }
+
+    std::vector<std::size_t> part_bounds(n_parts + 1), co_ranks(n_parts + 1);
+    for (std::size_t id = 0; id <= n_parts; ++id) {
+        part_bounds[id] = n_elems * id / n_parts;
+        co_ranks[id] = __co_rank(part_bounds[id], first1, n_a, first2, n_b, comp);
+    }
+
+    __execute_grid(policy, int(n_parts), [&](int id, int) {
+        __merge_path_block(first1, first2, d_first, part_bounds[id], co_ranks[id], part_bounds[id + 1], co_ranks[id + 1], comp,
+                           move);
+    });
+    return d_first + n_elems;
+}
+
+
+// merge the sorted runs of src two by two into dst
+// the output is split in equal parts with the merge path, a part can cover several merges:
+// the last rounds with few large merges still use every worker
+// the left run wins on equality, merges preserve the stability
+template <typename ExecPolicy, typename SrcIt, typename DstIt, typename Compare>
+inline void __merge_runs(const ExecPolicy& policy, SrcIt src, DstIt dst, std::vector<std::size_t>& bounds, Compare comp) {
+    const std::size_t n_runs = bounds.size() - 1;
+    const std::size_t n_merges = (n_runs + 1) / 2;
+    const std::size_t n_elems = bounds[n_runs];
+    const std::size_t n_parts = __get_partition_size(policy, n_elems);
+
+    // bounds of the run pair [b, m) [m, e) of a merge
+    auto merge_bounds = [&](std::size_t merge_id, std::size_t& b, std::size_t& m, std::size_t& e) {
+        const std::size_t left = 2 * merge_id;
+        b = bounds[left];
+        m = bounds[std::min(left + 1, n_runs)];
+        e = bounds[std::min(left + 2, n_runs)];
+    };
+
+    // merge containing each part bound and co-rank of the part bound in this merge
+    std::vector<std::size_t> part_bounds(n_parts + 1), part_merges(n_parts + 1), co_ranks(n_parts + 1);
+    for (std::size_t id = 0; id <= n_parts; ++id) {
+        const std::size_t k = n_elems * id / n_parts;
+        const std::size_t run_id = std::size_t(std::upper_bound(bounds.begin(), bounds.end(), k) - bounds.begin()) - 1;
+
+        part_bounds[id] = k;
+        part_merges[id] = std::min(run_id / 2, n_merges);
+        if (part_merges[id] < n_merges) {
+            std::size_t b, m, e;
+            merge_bounds(part_merges[id], b, m, e);
+            co_ranks[id] = __co_rank(k - b, src + b, m - b, src + m, e - m, comp);
+        }
+    }
+
+    __execute_grid(policy, int(n_parts), [&](int id, int) {
+        const std::size_t k_begin = part_bounds[id], k_end = part_bounds[id + 1];
+
+        for (std::size_t merge_id = part_merges[id]; merge_id < n_merges; ++merge_id) {
+            std::size_t b, m, e;
+            merge_bounds(merge_id, b, m, e);
+            if (b >= k_end) {
+                break;
+            }
+
+            const std::size_t i_begin = (merge_id == part_merges[id]) ? co_ranks[id] : 0;
+            const std::size_t i_end = (merge_id == part_merges[id + 1]) ? co_ranks[id + 1] : (m - b);
+
+            const std::size_t local_begin = std::max(k_begin, b) - b, local_end = std::min(k_end, e) - b;
+
+            __merge_path_block(src + b, src + m, dst + b, local_begin, i_begin, local_end, i_end, comp, std::true_type());
+        }
+    });
+
+    std::vector<std::size_t> merged_bounds;
+    merged_bounds.reserve(n_merges + 1);
+    for (std::size_t i = 0; i < n_runs; i += 2) {
+        merged_bounds.push_back(bounds[i]);
+    }
+    merged_bounds.push_back(bounds[n_runs]);
+    bounds.swap(merged_bounds);
+}
+
+
+///
+/// parallel merge sort
+///
+/// sort one block per thread, then merge the sorted runs two by two, each round of merges
+/// runs in parallel and ping-pongs between the input and a buffer. The buffer is uninitialized:
+/// the first round constructs the elements it merges from the input
+///
+template <typename ExecPolicy, typename RandomIt, typename Compare, typename Stable>
+inline void __parallel_merge_sort(const ExecPolicy& policy, RandomIt first, RandomIt last, Compare comp, Stable stable) {
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+    const std::size_t n_elems = std::size_t(std::distance(first, last));
+    const std::size_t n_parts = __get_partition_size(policy, n_elems);
+
+    if (n_parts <= 1) {
+        __sort_block(first, last, comp, stable);
+        return;
+    }
+
+    std::vector<std::size_t> bounds(n_parts + 1);
+    for (std::size_t i = 0; i < n_parts; ++i) {
+        bounds[i] = (n_elems / n_parts) * i + std::min(i, n_elems % n_parts);
+    }
+    bounds[n_parts] = n_elems;
+    const std::vector<std::size_t> block_bounds(bounds);
+
+    __execute_grid(policy, int(n_parts),
+                   [&](int id, int) { __sort_block(first + bounds[id], first + bounds[id + 1], comp, stable); });
+
+    __raw_buffer<value_type> raw_buffer(n_elems);
+    value_type* const buffer = raw_buffer.data();
+
+    __merge_runs(policy, first, __construct_iterator<value_type>(buffer), bounds, comp);
+    bool in_buffer = true;
+
+    while (bounds.size() > 2) {
+        if (in_buffer) {
+            __merge_runs(policy, buffer, first, bounds, comp);
+        } else {
+            __merge_runs(policy, first, buffer, bounds, comp);
+        }
+        in_buffer = !in_buffer;
+    }
+
+    __execute_grid(policy, int(n_parts), [&](int id, int) {
+        if (in_buffer) {
+            std::move(buffer + block_bounds[id], buffer + block_bounds[id + 1], first + block_bounds[id]);
+        }
+        __destroy_block(buffer + block_bounds[id], buffer + block_bounds[id + 1]);
+    });
+}
+
+
+
+// merge with the random access iterators
+template <typename ExecPolicy, typename ItA, typename ItB, typename OutputIt, typename Compare>
+inline OutputIt __parallel_merge(const ExecPolicy& policy, ItA first1, ItA last1, ItB first2, ItB last2, OutputIt d_first,
+                                 Compare& comp, std::true_type) {
+    if (is_parallel_policy(policy) == false) {
+        return std::merge(first1, last1, first2, last2, d_first, comp);
+    }
+    return __parallel_merge_path(policy, first1, last1, first2, last2, d_first, comp, std::false_type());
+}
+
+template <typename ExecPolicy, typename ItA, typename ItB, typename OutputIt, typename Compare>
+inline OutputIt __parallel_merge(const ExecPolicy&, ItA first1, ItA last1, ItB first2, ItB last2, OutputIt d_first,
+                                 Compare& comp, std::false_type) {
+    return std::merge(first1, last1, first2, last2, d_first, comp);
+}
+
+
+template <typename ExecPolicy, typename RandomIt, typename Compare>
+inline void __parallel_inplace_merge(const ExecPolicy& policy, RandomIt first, RandomIt middle, RandomIt last, Compare& comp,
+                                     std::true_type) {
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+    if (is_parallel_policy(policy) == false || __get_partition_size(policy, std::size_t(last - first)) <= 1) {
+        std::inplace_merge(first, middle, last, comp);
+        return;
+    }
+
+    // the elements are moved to an uninitialized buffer per slice, then merged back
+    const std::size_t n_elems = std::size_t(last - first), n_left = std::size_t(middle - first);
+    __raw_buffer<value_type> raw_buffer(n_elems);
+    value_type* const buffer = raw_buffer.data();
+
+    __parallel_for_range(policy, first, last, [&](RandomIt sub_begin, RandomIt sub_end) {
+        std::uninitialized_copy(std::make_move_iterator(sub_begin), std::make_move_iterator(sub_end),
+                                buffer + (sub_begin - first));
+    });
+
+    __parallel_merge_path(policy, buffer, buffer + n_left, buffer + n_left, buffer + n_elems, first, comp, std::true_type());
+
+    __parallel_for_range(policy, buffer, buffer + n_elems,
+                         [](value_type* sub_begin, value_type* sub_end) { __destroy_block(sub_begin, sub_end); });
+}
+
+template <typename ExecPolicy, typename BidirIt, typename Compare>
+inline void __parallel_inplace_merge(const ExecPolicy&, BidirIt first, BidirIt middle, BidirIt last, Compare& comp,
+                                     std::false_type) {
+    std::inplace_merge(first, middle, last, comp);
+}
+
+
+///
+/// parallel selection
+///
+/// each round moves a pivot to the end of the range and partitions the range around it in parallel,
+/// then continues on the side containing nth. The pivot is taken in a regular sample of the range
+/// at the relative position of nth: top-k and percentile queries converge in few rounds.
+/// The range is small enough to finish with std::nth_element once it fits in a single grain
+///
+template <typename ExecPolicy, typename RandomIt, typename Compare>
+inline void __parallel_nth_element(const ExecPolicy& policy, RandomIt first, RandomIt nth, RandomIt last, Compare comp) {
+    using std::swap;
+
+    while (nth != last) {
+        const std::size_t n_elems = std::size_t(last - first);
+        const std::size_t n_parts = __get_partition_size(policy, n_elems);
+
+        if (n_parts <= 1) {
+            std::nth_element(first, nth, last, comp);
+            return;
+        }
+
+        // pivot selection, the sampled elements are referred by index: no copy of the values
+        const std::size_t n_samples = std::min(n_elems, 16 * n_parts + 1);
+        std::vector<std::size_t> samples(n_samples);
+        for (std::size_t i = 0; i < n_samples; ++i) {
+            samples[i] = i * n_elems / n_samples;
+        }
+
+        const std::size_t sample_rank = std::min(n_samples - 1, std::size_t(nth - first) * n_samples / n_elems);
+        std::nth_element(samples.begin(), samples.begin() + sample_rank, samples.end(),
+                         [&](std::size_t a, std::size_t b) { return comp(first[a], first[b]); });
+
+        RandomIt pivot = last - 1;
+        swap(first[samples[sample_rank]], *pivot);
+
+        // [first, lower) < pivot <= [lower + 1, last)
+        auto is_lower = [&](RandomIt it, std::size_t) -> bool { return comp(*it, *pivot); };
+        const RandomIt lower = first + __parallel_stable_partition(policy, first, pivot, is_lower, true);
+        swap(*lower, *pivot);
+        pivot = lower;
+
+        if (nth == pivot) {
+            return;
+        }
+        if (nth < pivot) {
+            last = pivot;
+            continue;
+        }
+
+        // group the elements equivalent to the pivot, the range can not stall on duplicated values
+        auto is_equivalent = [&](RandomIt it, std::size_t) -> bool { return !comp(*pivot, *it); };
+        const RandomIt upper = (pivot + 1) + __parallel_stable_partition(policy, pivot + 1, last, is_equivalent, true);
+        if (nth < upper) {
+            return;
+        }
+        first = upper;
+    }
+}
+
+
+///
+/// parallel partial sort: parallel selection of the (middle - first) smallest elements,
+/// then parallel sort of [first, middle)
+///
+template <typename ExecPolicy, typename RandomIt, typename Compare>
+inline void __parallel_partial_sort(const ExecPolicy& policy, RandomIt first, RandomIt middle, RandomIt last, Compare comp) {
+    if (first == middle) {
+        return;
+    }
+
+    __parallel_nth_element(policy, first, middle, last, comp);
+    __parallel_merge_sort(policy, first, middle, comp, std::false_type());
+}
+
+
+} // namespace detail
 
 // sort algorithm
 template <class ExecutionPolicy, class RandomIt>
 void sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last) {
-    // temporary dummy implementation
-    (void)policy;
-    std::sort(first, last);
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+    ::hadoken::parallel::sort(std::forward<ExecutionPolicy>(policy), first, last, std::less<value_type>());
 }
 
 // sort algorithm with comparator
 template <class ExecutionPolicy, class RandomIt, class Compare>
 void sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last, Compare comp) {
-    // temporary dummy implementation
-    (void)policy;
+    if (detail::is_parallel_policy(policy)) {
+        detail::__parallel_merge_sort(policy, first, last, comp, std::false_type());
+        return;
+    }
     std::sort(first, last, comp);
 }
 
+// stable_sort algorithm
+template <class ExecutionPolicy, class RandomIt>
+void stable_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last) {
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+    ::hadoken::parallel::stable_sort(std::forward<ExecutionPolicy>(policy), first, last, std::less<value_type>());
+}
+
+// stable_sort algorithm with comparator
+template <class ExecutionPolicy, class RandomIt, class Compare>
+void stable_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt last, Compare comp) {
+    if (detail::is_parallel_policy(policy)) {
+        detail::__parallel_merge_sort(policy, first, last, comp, std::true_type());
+        return;
+    }
+    std::stable_sort(first, last, comp);
+}
+
+
+// merge algorithm
+template <class ExecutionPolicy, class InputIt1, class InputIt2, class OutputIt>
+OutputIt merge(ExecutionPolicy&& policy, InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, OutputIt d_first) {
+    using value_type = typename std::iterator_traits<InputIt1>::value_type;
+
+    return ::hadoken::parallel::merge(std::forward<ExecutionPolicy>(policy), first1, last1, first2, last2, d_first,
+                                      std::less<value_type>());
+}
+
+// merge algorithm with comparator
+template <class ExecutionPolicy, class InputIt1, class InputIt2, class OutputIt, class Compare>
+OutputIt merge(ExecutionPolicy&& policy, InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2, OutputIt d_first,
+               Compare comp) {
+    return detail::__parallel_merge(policy, first1, last1, first2, last2, d_first, comp,
+                                    detail::__compaction_path<InputIt1, InputIt2, OutputIt>());
+}
+
+// inplace_merge algorithm
+template <class ExecutionPolicy, class BidirIt>
+void inplace_merge(ExecutionPolicy&& policy, BidirIt first, BidirIt middle, BidirIt last) {
+    using value_type = typename std::iterator_traits<BidirIt>::value_type;
+
+    ::hadoken::parallel::inplace_merge(std::forward<ExecutionPolicy>(policy), first, middle, last, std::less<value_type>());
+}
+
+// inplace_merge algorithm with comparator
+template <class ExecutionPolicy, class BidirIt, class Compare>
+void inplace_merge(ExecutionPolicy&& policy, BidirIt first, BidirIt middle, BidirIt last, Compare comp) {
+    detail::__parallel_inplace_merge(policy, first, middle, last, comp, detail::__compaction_path<BidirIt>());
+}
+
+// nth_element algorithm
+template <class ExecutionPolicy, class RandomIt>
+void nth_element(ExecutionPolicy&& policy, RandomIt first, RandomIt nth, RandomIt last) {
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+    ::hadoken::parallel::nth_element(std::forward<ExecutionPolicy>(policy), first, nth, last, std::less<value_type>());
+}
+
+// nth_element algorithm with comparator
+template <class ExecutionPolicy, class RandomIt, class Compare>
+void nth_element(ExecutionPolicy&& policy, RandomIt first, RandomIt nth, RandomIt last, Compare comp) {
+    if (detail::is_parallel_policy(policy)) {
+        detail::__parallel_nth_element(policy, first, nth, last, comp);
+        return;
+    }
+    std::nth_element(first, nth, last, comp);
+}
+
+// partial_sort algorithm
+template <class ExecutionPolicy, class RandomIt>
+void partial_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt middle, RandomIt last) {
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+    ::hadoken::parallel::partial_sort(std::forward<ExecutionPolicy>(policy), first, middle, last, std::less<value_type>());
+}
+
+// partial_sort algorithm with comparator
+template <class ExecutionPolicy, class RandomIt, class Compare>
+void partial_sort(ExecutionPolicy&& policy, RandomIt first, RandomIt middle, RandomIt last, Compare comp) {
+    if (detail::is_parallel_policy(policy)) {
+        detail::__parallel_partial_sort(policy, first, middle, last, comp);
+        return;
+    }
+    std::partial_sort(first, middle, last, comp);
+}
 
 } // namespace parallel
 
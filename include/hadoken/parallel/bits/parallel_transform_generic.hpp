@@ -39,6 +39,7 @@
 
 
 #include "parallel_generic_utils.hpp"
+#include "parallel_simd_utils.hpp"
 
 
 namespace hadoken {
@@ -49,10 +50,10 @@ namespace parallel {
 template <class ExecutionPolicy, class InputIterator1, class InputIterator2, class OutputIterator, class BinaryOperation>
 OutputIterator transform(ExecutionPolicy&& policy, InputIterator1 first1, InputIterator1 last1, InputIterator2 first2,
                          OutputIterator d_first, BinaryOperation binary_op) {
-    if (detail::is_parallel_policy(policy)) {
-        InputIterator1 d_last = d_first;
+    using use_simd = detail::__use_simd<ExecutionPolicy, InputIterator1, InputIterator2, OutputIterator>;
 
-        hadoken::parallel::for_range(policy, first1, last1, [&](InputIterator1 local_begin, InputIterator2 local_end) {
+    if (detail::is_parallel_policy(policy)) {
+        hadoken::parallel::for_range(policy, first1, last1, [&](InputIterator1 local_begin, InputIterator1 local_end) {
             const std::size_t pos = std::distance(first1, local_begin);
 
             InputIterator2 local_first2 = first2;
@@ -60,25 +61,35 @@ OutputIterator transform(ExecutionPolicy&& policy, InputIterator1 first1, InputI
             OutputIterator d_local_first = d_first;
             std::advance(d_local_first, pos);
 
-            std::transform(local_begin, local_end, local_first2, d_local_first, binary_op);
+            detail::__transform_block(local_begin, local_end, local_first2, d_local_first, binary_op, use_simd());
         });
-
-        std::advance(d_last, std::distance(first1, last1));
-        return d_last;
     } else {
-        return std::transform(first1, last1, first2, d_first, binary_op);
+        detail::__transform_block(first1, last1, first2, d_first, binary_op, use_simd());
     }
+
+    std::advance(d_first, std::distance(first1, last1));
+    return d_first;
 }
 
 
 
 template <class ExecutionPolicy, class InputIt, class OutputIt, class UnaryOperation>
 OutputIt transform(ExecutionPolicy&& policy, InputIt first1, InputIt last1, OutputIt d_first, UnaryOperation unary_op) {
-    using value_type = typename std::iterator_traits<InputIt>::value_type;
-    return transform(policy, first1, last1, first1, d_first, [&unary_op](const value_type& v1, const value_type& v2) {
-        (void)v2;
-        return unary_op(v1);
-    });
+    using use_simd = detail::__use_simd<ExecutionPolicy, InputIt, OutputIt>;
+
+    if (detail::is_parallel_policy(policy)) {
+        hadoken::parallel::for_range(policy, first1, last1, [&](InputIt local_begin, InputIt local_end) {
+            OutputIt d_local_first = d_first;
+            std::advance(d_local_first, std::distance(first1, local_begin));
+
+            detail::__transform_block(local_begin, local_end, d_local_first, unary_op, use_simd());
+        });
+    } else {
+        detail::__transform_block(first1, last1, d_first, unary_op, use_simd());
+    }
+
+    std::advance(d_first, std::distance(first1, last1));
+    return d_first;
 }
 
 } // namespace parallel
@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef _HADOKEN_EVENTCOUNT_HPP_
+#define _HADOKEN_EVENTCOUNT_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+#ifdef __linux__
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+
+namespace hadoken {
+
+namespace thread {
+
+///
+/// \brief eventcount class
+///
+/// condition variable for lock-free algorithms: a thread announces that it is
+/// going to sleep, re-checks its condition and then sleeps until notified.
+/// notify is a single atomic load when nobody waits.
+///
+/// waiter side:
+/// \code
+///   auto key = ec.prepare_wait();
+///   if (condition()) { ec.cancel_wait(); } else { ec.wait(key); }
+/// \endcode
+///
+/// notifier side: make the condition true, then call notify_one() or notify_all()
+///
+/// Use a futex on Linux, a mutex / condition variable pair otherwise
+///
+class eventcount {
+  public:
+    using key_type = std::uint32_t;
+
+    inline eventcount() : _epoch(0), _waiters(0) {}
+
+    ~eventcount() = default;
+
+    /// register the calling thread as waiter, return the key to give to wait()
+    inline key_type prepare_wait() {
+        _waiters.fetch_add(1, std::memory_order_seq_cst);
+        return _epoch.load(std::memory_order_seq_cst);
+    }
+
+    /// unregister the calling thread, the condition became true before wait()
+    inline void cancel_wait() { _waiters.fetch_sub(1, std::memory_order_seq_cst); }
+
+    /// block until a notification happened since prepare_wait()
+    inline void wait(key_type key) {
+        while (_epoch.load(std::memory_order_acquire) == key) {
+            __sleep(key);
+        }
+        _waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    /// wake up one waiting thread
+    inline void notify_one() { __notify(false); }
+
+    /// wake up all the waiting threads
+    inline void notify_all() { __notify(true); }
+
+  private:
+    eventcount(const eventcount&) = delete;
+    eventcount& operator=(const eventcount&) = delete;
+
+    inline void __notify(bool all) {
+        // pair with the seq_cst increment of prepare_wait()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_waiters.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+
+        _epoch.fetch_add(1, std::memory_order_seq_cst);
+        __wake(all);
+    }
+
+#ifdef __linux__
+    inline void __sleep(key_type key) {
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&_epoch), FUTEX_WAIT_PRIVATE, key, NULL, NULL, 0);
+    }
+
+    inline void __wake(bool all) {
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&_epoch), FUTEX_WAKE_PRIVATE, (all) ? INT_MAX : 1, NULL, NULL,
+                0);
+    }
+#else
+    inline void __sleep(key_type key) {
+        std::unique_lock<std::mutex> _l(_lock);
+        while (_epoch.load(std::memory_order_acquire) == key) {
+            _cond.wait(_l);
+        }
+    }
+
+    inline void __wake(bool all) {
+        // lock to not miss a thread between its epoch check and its wait
+        std::lock_guard<std::mutex> _l(_lock);
+        if (all) {
+            _cond.notify_all();
+        } else {
+            _cond.notify_one();
+        }
+    }
+
+    std::mutex _lock;
+    std::condition_variable _cond;
+#endif
+
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "futex requires a plain 32 bits word");
+
+    std::atomic<std::uint32_t> _epoch;
+    std::atomic<std::uint32_t> _waiters;
+};
+
+
+} // namespace thread
+
+
+} // namespace hadoken
+
+#endif // _HADOKEN_EVENTCOUNT_HPP_
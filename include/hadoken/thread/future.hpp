@@ -0,0 +1,637 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+#ifndef HADOKEN_FUTURE_HPP
+#define HADOKEN_FUTURE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <hadoken/thread/eventcount.hpp>
+
+namespace hadoken {
+
+template <typename T>
+class future;
+
+namespace details {
+
+// value type produced by a callable, as stored in a future
+template <typename Function>
+struct task_result {
+    using type = typename std::decay<decltype(std::declval<typename std::decay<Function>::type&>()())>::type;
+};
+
+// value type produced by a continuation called with a future
+template <typename Function, typename T>
+struct continuation_result {
+    using type =
+        typename std::decay<decltype(std::declval<typename std::decay<Function>::type&>()(std::declval<future<T>>()))>::type;
+};
+
+
+///
+/// callback executed once when a shared state becomes ready
+/// intrusive node, owned by the code that registers it
+///
+class continuation_base {
+  public:
+    inline continuation_base() : next(nullptr) {}
+
+    virtual ~continuation_base() {}
+
+    virtual void on_ready() = 0;
+
+    continuation_base* next;
+};
+
+
+///
+/// shared state of a future / promise pair
+/// intrusive reference counting, no mutex, waiters park on an eventcount
+/// continuations are pushed on a lock-free stack, closed when the state becomes ready
+///
+class future_state_base {
+  public:
+    inline future_state_base() : _ref(1), _ready(false), _exception(), _event(), _continuations(nullptr) {}
+
+    virtual ~future_state_base() {}
+
+    inline void add_ref() { _ref.fetch_add(1, std::memory_order_relaxed); }
+
+    inline void release() {
+        if (_ref.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    inline bool is_ready() const { return _ready.load(std::memory_order_acquire); }
+
+    inline void wait() {
+        while (is_ready() == false) {
+            const thread::eventcount::key_type key = _event.prepare_wait();
+            if (is_ready()) {
+                _event.cancel_wait();
+            } else {
+                _event.wait(key);
+            }
+        }
+    }
+
+    inline void set_exception(std::exception_ptr e) {
+        _exception = std::move(e);
+        mark_ready();
+    }
+
+    /// call c->on_ready() when the state becomes ready, immediately if it is already ready
+    inline void add_continuation(continuation_base* c) {
+        continuation_base* head = _continuations.load(std::memory_order_acquire);
+        do {
+            if (head == closed()) {
+                c->on_ready();
+                return;
+            }
+            c->next = head;
+        } while (_continuations.compare_exchange_weak(head, c, std::memory_order_release, std::memory_order_acquire) == false);
+    }
+
+  protected:
+    inline void mark_ready() {
+        _ready.store(true, std::memory_order_release);
+        _event.notify_all();
+
+        // continuations run in the completing thread, the setter still holds a reference
+        continuation_base* c = _continuations.exchange(closed(), std::memory_order_acq_rel);
+        while (c != nullptr) {
+            continuation_base* next = c->next;
+            c->on_ready();
+            c = next;
+        }
+    }
+
+    inline void rethrow_if_exception() {
+        if (_exception) {
+            std::rethrow_exception(_exception);
+        }
+    }
+
+  private:
+    future_state_base(const future_state_base&) = delete;
+    future_state_base& operator=(const future_state_base&) = delete;
+
+    std::atomic<int> _ref;
+    std::atomic<bool> _ready;
+    std::exception_ptr _exception;
+    thread::eventcount _event;
+    std::atomic<continuation_base*> _continuations;
+
+    static inline continuation_base* closed() { return reinterpret_cast<continuation_base*>(std::uintptr_t(1)); }
+};
+
+
+template <typename T>
+class future_state : public future_state_base {
+  public:
+    inline future_state() : _has_value(false) {}
+
+    inline ~future_state() {
+        if (_has_value) {
+            reinterpret_cast<T*>(&_storage)->~T();
+        }
+    }
+
+    template <typename Value>
+    inline void set_value(Value&& v) {
+        new (&_storage) T(std::forward<Value>(v));
+        _has_value = true;
+        mark_ready();
+    }
+
+    template <typename Function>
+    inline void set_from(Function& fun) {
+        set_value(fun());
+    }
+
+    template <typename Function, typename Arg>
+    inline void set_from(Function& fun, Arg&& arg) {
+        set_value(fun(std::forward<Arg>(arg)));
+    }
+
+    inline T get() {
+        wait();
+        rethrow_if_exception();
+        return std::move(*reinterpret_cast<T*>(&_storage));
+    }
+
+  private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type _storage;
+    bool _has_value;
+};
+
+
+template <>
+class future_state<void> : public future_state_base {
+  public:
+    inline void set_value() { mark_ready(); }
+
+    template <typename Function>
+    inline void set_from(Function& fun) {
+        fun();
+        set_value();
+    }
+
+    template <typename Function, typename Arg>
+    inline void set_from(Function& fun, Arg&& arg) {
+        fun(std::forward<Arg>(arg));
+        set_value();
+    }
+
+    inline void get() {
+        wait();
+        rethrow_if_exception();
+    }
+};
+
+
+///
+/// shared state which owns the callable producing the value
+/// task and result live in the same allocation
+///
+template <typename T, typename Function>
+class task_state : public future_state<T> {
+  public:
+    template <typename Fun>
+    explicit inline task_state(Fun&& fun) : _fun(std::forward<Fun>(fun)) {}
+
+    inline void run() {
+        try {
+            this->set_from(_fun);
+        } catch (...) {
+            this->set_exception(std::current_exception());
+        }
+    }
+
+  private:
+    Function _fun;
+};
+
+
+///
+/// move-only handle used to execute a task_state
+///
+/// a runner destroyed without being run, a task dropped by an executor,
+/// breaks the promise like an abandoned promise: the waiters get a future_error
+///
+template <typename T, typename Function>
+class task_runner {
+  public:
+    explicit inline task_runner(task_state<T, Function>* state) noexcept : _state(state), _ran(false) {}
+
+    inline task_runner(task_runner&& other) noexcept : _state(other._state), _ran(other._ran) { other._state = nullptr; }
+
+    inline ~task_runner() {
+        if (_state) {
+            if (_ran == false) {
+                _state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+            _state->release();
+        }
+    }
+
+    inline void operator()() {
+        _ran = true;
+        _state->run();
+    }
+
+  private:
+    task_runner(const task_runner&) = delete;
+    task_runner& operator=(const task_runner&) = delete;
+
+    task_state<T, Function>* _state;
+    bool _ran;
+};
+
+
+///
+/// shared state of a bulk execution: fun(i) for i in [0, n)
+/// runners claim chunks of indices from a shared counter, the last
+/// completed chunk counts the state down to zero and readies the future
+///
+template <typename Function>
+class bulk_state : public future_state<void> {
+  public:
+    template <typename Fun>
+    inline bulk_state(std::size_t n, std::size_t n_runners, Fun&& fun)
+        : _fun(std::forward<Fun>(fun)), _size(n), _chunk(std::max<std::size_t>(1, n / (n_runners * 8 + 1))), _next(0),
+          _remaining(n), _failed(false), _error() {}
+
+    inline void run() {
+        std::size_t done = 0;
+
+        while (1) {
+            const std::size_t first = _next.fetch_add(_chunk, std::memory_order_relaxed);
+            if (first >= _size) {
+                break;
+            }
+
+            const std::size_t last = std::min(first + _chunk, _size);
+            for (std::size_t i = first; i < last; ++i) {
+                try {
+                    _fun(i);
+                } catch (...) {
+                    // keep the first error, the other indices are still executed
+                    if (_failed.exchange(true) == false) {
+                        _error = std::current_exception();
+                    }
+                }
+            }
+            done += last - first;
+        }
+
+        if (done > 0 && _remaining.fetch_sub(done, std::memory_order_acq_rel) == done) {
+            if (_error) {
+                set_exception(_error);
+            } else {
+                set_value();
+            }
+        }
+    }
+
+  private:
+    Function _fun;
+    const std::size_t _size, _chunk;
+    std::atomic<std::size_t> _next, _remaining;
+    std::atomic<bool> _failed;
+    std::exception_ptr _error;
+};
+
+
+///
+/// copyable handle used to execute a bulk_state, one per worker
+///
+template <typename Function>
+class bulk_runner {
+  public:
+    explicit inline bulk_runner(bulk_state<Function>* state) noexcept : _state(state) { _state->add_ref(); }
+
+    inline bulk_runner(const bulk_runner& other) noexcept : _state(other._state) { _state->add_ref(); }
+
+    inline bulk_runner(bulk_runner&& other) noexcept : _state(other._state) { other._state = nullptr; }
+
+    inline ~bulk_runner() {
+        if (_state) {
+            _state->release();
+        }
+    }
+
+    inline void operator()() { _state->run(); }
+
+  private:
+    bulk_runner& operator=(const bulk_runner&) = delete;
+
+    bulk_state<Function>* _state;
+};
+
+
+// run continuations in the thread completing the future
+struct inline_continuation {
+    template <typename Function>
+    inline void execute(Function&& fun) {
+        fun();
+    }
+};
+
+
+///
+/// shared state of a future returned by then()
+/// the continuation, its callable and its result live in the same allocation
+/// one reference is held by the returned future, one by the pending continuation
+///
+template <typename R, typename T, typename Function, typename Executor>
+class continuation_state : public future_state<R>, public continuation_base {
+  public:
+    template <typename Fun>
+    inline continuation_state(future_state<T>* source, Executor* exec, Fun&& fun)
+        : _fun(std::forward<Fun>(fun)), _source(source), _exec(exec) {
+        this->add_ref();
+    }
+
+    inline void on_ready() override {
+        try {
+            _exec->execute([this]() { invoke(); });
+        } catch (...) {
+            // the executor refused the continuation
+            this->set_exception(std::current_exception());
+            drop_source();
+        }
+    }
+
+  private:
+    inline void invoke() {
+        future<T> source(_source);
+        _source = nullptr;
+        try {
+            this->set_from(_fun, std::move(source));
+        } catch (...) {
+            this->set_exception(std::current_exception());
+        }
+        this->release();
+    }
+
+    inline void drop_source() {
+        _source->release();
+        _source = nullptr;
+        this->release();
+    }
+
+    Function _fun;
+    future_state<T>* _source;
+    Executor* _exec;
+};
+
+
+// access to the shared state of a future, for the combinators
+struct future_access {
+    template <typename T>
+    static inline future_state<T>* state(const future<T>& f) {
+        return f._state;
+    }
+};
+
+
+} // namespace details
+
+
+///
+/// \brief lightweight future
+///
+/// equivalent of std::future, the shared state is a single allocation
+/// that can also contain the task producing the value
+///
+template <typename T>
+class future {
+  public:
+    using value_type = T;
+
+    inline future() noexcept : _state(nullptr) {}
+
+    /// take ownership of one reference on the state
+    explicit inline future(details::future_state<T>* state) noexcept : _state(state) {}
+
+    inline future(future&& other) noexcept : _state(other._state) { other._state = nullptr; }
+
+    inline future& operator=(future&& other) noexcept {
+        if (this != &other) {
+            reset();
+            _state = other._state;
+            other._state = nullptr;
+        }
+        return *this;
+    }
+
+    inline ~future() { reset(); }
+
+    /// true if the future refers to a shared state
+    inline bool valid() const noexcept { return _state != nullptr; }
+
+    /// true if the value or the exception is available
+    inline bool is_ready() const { return _state->is_ready(); }
+
+    /// block until the result is available
+    inline void wait() const { _state->wait(); }
+
+    ///
+    /// \brief attach a continuation, fun(future<T>) runs on exec once the result is available
+    ///
+    /// the continuation receives this future, ready, and its result is made available in the
+    /// returned future, exceptions included. No thread waits: the completing thread submits the
+    /// continuation to exec, or submits it directly if the result is already available.
+    /// Invalidate the future, exec must outlive the continuation
+    ///
+    template <typename Executor, typename Function>
+    inline future<typename details::continuation_result<Function, T>::type> then(Executor& exec, Function&& fun) {
+        return attach(&exec, std::forward<Function>(fun));
+    }
+
+    /// attach a continuation executed in the thread completing the future
+    template <typename Function>
+    inline future<typename details::continuation_result<Function, T>::type> then(Function&& fun) {
+        static details::inline_continuation inline_exec;
+        return attach(&inline_exec, std::forward<Function>(fun));
+    }
+
+    /// wait and return the result or rethrow the exception, invalidate the future
+    inline T get() {
+        if (_state == nullptr) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+
+        future_guard guard(_state);
+        _state = nullptr;
+        return guard.state->get();
+    }
+
+  private:
+    future(const future&) = delete;
+    future& operator=(const future&) = delete;
+
+    friend struct details::future_access;
+
+    template <typename Executor, typename Function>
+    inline future<typename details::continuation_result<Function, T>::type> attach(Executor* exec, Function&& fun) {
+        using result_type = typename details::continuation_result<Function, T>::type;
+        using state_type = details::continuation_state<result_type, T, typename std::decay<Function>::type, Executor>;
+
+        if (_state == nullptr) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+
+        // the reference of this future moves to the continuation
+        state_type* state = new state_type(_state, exec, std::forward<Function>(fun));
+        details::future_state<T>* source = _state;
+        _state = nullptr;
+        source->add_continuation(state);
+        return future<result_type>(state);
+    }
+
+    struct future_guard {
+        explicit future_guard(details::future_state<T>* s) : state(s) {}
+        ~future_guard() { state->release(); }
+        details::future_state<T>* state;
+    };
+
+    inline void reset() {
+        if (_state) {
+            _state->release();
+            _state = nullptr;
+        }
+    }
+
+    details::future_state<T>* _state;
+};
+
+
+///
+/// \brief lightweight promise, see future
+///
+template <typename T>
+class promise {
+  public:
+    inline promise() : _state(new details::future_state<T>()), _retrieved(false) {}
+
+    inline promise(promise&& other) noexcept : _state(other._state), _retrieved(other._retrieved) { other._state = nullptr; }
+
+    inline promise& operator=(promise&& other) noexcept {
+        if (this != &other) {
+            abandon();
+            _state = other._state;
+            _retrieved = other._retrieved;
+            other._state = nullptr;
+        }
+        return *this;
+    }
+
+    inline ~promise() { abandon(); }
+
+    inline future<T> get_future() {
+        if (_retrieved) {
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        }
+        _retrieved = true;
+        _state->add_ref();
+        return future<T>(_state);
+    }
+
+    template <typename... Value>
+    inline void set_value(Value&&... v) {
+        _state->set_value(std::forward<Value>(v)...);
+    }
+
+    inline void set_exception(std::exception_ptr e) { _state->set_exception(std::move(e)); }
+
+  private:
+    promise(const promise&) = delete;
+    promise& operator=(const promise&) = delete;
+
+    inline void abandon() {
+        if (_state) {
+            if (_state->is_ready() == false) {
+                _state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+            _state->release();
+            _state = nullptr;
+        }
+    }
+
+    details::future_state<T>* _state;
+    bool _retrieved;
+};
+
+
+///
+/// create a task_state for fun, return the future and the callable that executes fun
+///
+template <typename Function>
+inline std::pair<future<typename details::task_result<Function>::type>,
+                 details::task_runner<typename details::task_result<Function>::type, typename std::decay<Function>::type>>
+make_task(Function&& fun) {
+    using result_type = typename details::task_result<Function>::type;
+    using fun_type = typename std::decay<Function>::type;
+    using state_type = details::task_state<result_type, fun_type>;
+
+    state_type* state = new state_type(std::forward<Function>(fun));
+    state->add_ref();
+    return std::make_pair(future<result_type>(state), details::task_runner<result_type, fun_type>(state));
+}
+
+
+/// future with a value already available
+template <typename T>
+inline future<typename std::decay<T>::type> make_ready_future(T&& value) {
+    auto* state = new details::future_state<typename std::decay<T>::type>();
+    state->set_value(std::forward<T>(value));
+    return future<typename std::decay<T>::type>(state);
+}
+
+inline future<void> make_ready_future() {
+    auto* state = new details::future_state<void>();
+    state->set_value();
+    return future<void>(state);
+}
+
+
+} // namespace hadoken
+
+#endif // HADOKEN_FUTURE_HPP
@@ -29,7 +29,17 @@
 #ifndef HADOKEN_FUTURE_HELPERS_HPP
 #define HADOKEN_FUTURE_HELPERS_HPP
 
+#include <atomic>
+#include <cstddef>
 #include <future>
+#include <iterator>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <hadoken/thread/future.hpp>
 
 namespace hadoken {
 
@@ -48,6 +58,219 @@ void set_promise_from_result(std::promise<void>& p, F&& f) {
 }
 
 
+///
+/// result of when_any: index of the first ready future and all the futures
+///
+template <typename Sequence>
+struct when_any_result {
+    std::size_t index;
+    Sequence futures;
+};
+
+
+namespace details {
+
+
+template <typename T>
+struct is_future : public std::false_type {};
+
+template <typename T>
+struct is_future<future<T>> : public std::true_type {};
+
+
+// shared state of the input futures of a sequence, vector or tuple of hadoken::future
+template <typename T>
+inline void collect_states(std::vector<future<T>>& futures, std::vector<future_state_base*>& states) {
+    for (auto& f : futures) {
+        states.push_back(future_access::state(f));
+    }
+}
+
+template <std::size_t I, typename... Futures>
+inline typename std::enable_if<I == sizeof...(Futures)>::type collect_states_from(std::tuple<Futures...>&,
+                                                                                   std::vector<future_state_base*>&) {}
+
+template <std::size_t I, typename... Futures>
+inline typename std::enable_if<(I < sizeof...(Futures))>::type collect_states_from(std::tuple<Futures...>& futures,
+                                                                                    std::vector<future_state_base*>& states) {
+    states.push_back(future_access::state(std::get<I>(futures)));
+    collect_states_from<I + 1>(futures, states);
+}
+
+template <typename... Futures>
+inline void collect_states(std::tuple<Futures...>& futures, std::vector<future_state_base*>& states) {
+    collect_states_from<0>(futures, states);
+}
+
+
+///
+/// shared state of when_all / when_any, registered as a continuation on every input
+/// the input futures stay valid and owned by the state until the result is set
+///
+template <typename Sequence, typename Result, typename Derived>
+class when_state : public future_state<Result> {
+  public:
+    explicit inline when_state(Sequence&& futures) : _futures(std::move(futures)), _waiters() {}
+
+    // register on each input, one reference per pending input
+    inline void start() {
+        std::vector<future_state_base*> states;
+        collect_states(_futures, states);
+
+        _waiters.resize(states.size());
+        for (std::size_t i = 0; i < _waiters.size(); ++i) {
+            _waiters[i].parent = static_cast<Derived*>(this);
+            _waiters[i].index = i;
+            this->add_ref();
+        }
+
+        // an input may complete, and the result may be set, as soon as a waiter is registered
+        const std::size_t n = _waiters.size();
+        waiter* waiters = _waiters.data();
+        for (std::size_t i = 0; i < n; ++i) {
+            if (states[i] == nullptr) {
+                waiters[i].on_ready();
+            } else {
+                states[i]->add_continuation(&waiters[i]);
+            }
+        }
+    }
+
+  protected:
+    struct waiter : public continuation_base {
+        inline waiter() : parent(nullptr), index(0) {}
+
+        inline void on_ready() override {
+            Derived* p = parent;
+            p->input_ready(index);
+            p->release();
+        }
+
+        Derived* parent;
+        std::size_t index;
+    };
+
+    Sequence _futures;
+    std::vector<waiter> _waiters;
+};
+
+
+template <typename Sequence>
+class when_all_state : public when_state<Sequence, Sequence, when_all_state<Sequence>> {
+  public:
+    explicit inline when_all_state(Sequence&& futures, std::size_t n)
+        : when_state<Sequence, Sequence, when_all_state<Sequence>>(std::move(futures)), _remaining(n) {}
+
+    inline void input_ready(std::size_t) {
+        if (_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->set_value(std::move(this->_futures));
+        }
+    }
+
+  private:
+    std::atomic<std::size_t> _remaining;
+};
+
+
+template <typename Sequence>
+class when_any_state : public when_state<Sequence, when_any_result<Sequence>, when_any_state<Sequence>> {
+  public:
+    explicit inline when_any_state(Sequence&& futures, std::size_t)
+        : when_state<Sequence, when_any_result<Sequence>, when_any_state<Sequence>>(std::move(futures)), _done(false) {}
+
+    inline void input_ready(std::size_t index) {
+        if (_done.exchange(true, std::memory_order_acq_rel) == false) {
+            this->set_value(when_any_result<Sequence>{index, std::move(this->_futures)});
+        }
+    }
+
+  private:
+    std::atomic<bool> _done;
+};
+
+
+template <typename State, typename Result, typename Sequence>
+inline future<Result> make_when_state(Sequence&& futures, std::size_t n) {
+    State* state = new State(std::move(futures), n);
+    future<Result> res(state);
+    state->start();
+    return res;
+}
+
+
+} // namespace details
+
+
+///
+/// \brief future ready when all the futures of [first, last) are ready
+///
+/// the result holds the input futures, ready. No thread blocks: the last completing
+/// input sets the result. The input futures are moved
+///
+template <typename InputIterator, typename = typename std::enable_if<!details::is_future<InputIterator>::value>::type>
+inline future<std::vector<typename std::iterator_traits<InputIterator>::value_type>> when_all(InputIterator first,
+                                                                                              InputIterator last) {
+    using sequence = std::vector<typename std::iterator_traits<InputIterator>::value_type>;
+
+    sequence futures(std::make_move_iterator(first), std::make_move_iterator(last));
+    if (futures.empty()) {
+        return make_ready_future(std::move(futures));
+    }
+    const std::size_t n = futures.size();
+    return details::make_when_state<details::when_all_state<sequence>, sequence>(std::move(futures), n);
+}
+
+
+/// future ready when all the futures are ready, result is a tuple of the input futures
+template <typename... Futures>
+inline future<std::tuple<typename std::decay<Futures>::type...>> when_all(Futures&&... futures) {
+    using sequence = std::tuple<typename std::decay<Futures>::type...>;
+
+    sequence all(std::move(futures)...);
+    return details::make_when_state<details::when_all_state<sequence>, sequence>(std::move(all), sizeof...(Futures));
+}
+
+
+inline future<std::tuple<>> when_all() { return make_ready_future(std::tuple<>()); }
+
+
+///
+/// \brief future ready when any of the futures of [first, last) is ready
+///
+/// the result holds the index of the first ready future and all the input futures.
+/// The other futures remain usable: they can be waited for, or composed again.
+/// index is max size_t for an empty range
+///
+template <typename InputIterator, typename = typename std::enable_if<!details::is_future<InputIterator>::value>::type>
+inline future<when_any_result<std::vector<typename std::iterator_traits<InputIterator>::value_type>>>
+when_any(InputIterator first, InputIterator last) {
+    using sequence = std::vector<typename std::iterator_traits<InputIterator>::value_type>;
+
+    sequence futures(std::make_move_iterator(first), std::make_move_iterator(last));
+    if (futures.empty()) {
+        return make_ready_future(when_any_result<sequence>{std::numeric_limits<std::size_t>::max(), std::move(futures)});
+    }
+    const std::size_t n = futures.size();
+    return details::make_when_state<details::when_any_state<sequence>, when_any_result<sequence>>(std::move(futures), n);
+}
+
+
+/// future ready when any of the futures is ready, the futures are returned in a tuple
+template <typename... Futures>
+inline future<when_any_result<std::tuple<typename std::decay<Futures>::type...>>> when_any(Futures&&... futures) {
+    using sequence = std::tuple<typename std::decay<Futures>::type...>;
+
+    sequence all(std::move(futures)...);
+    return details::make_when_state<details::when_any_state<sequence>, when_any_result<sequence>>(std::move(all),
+                                                                                                   sizeof...(Futures));
+}
+
+
+inline future<when_any_result<std::tuple<>>> when_any() {
+    return make_ready_future(when_any_result<std::tuple<>>{std::numeric_limits<std::size_t>::max(), std::tuple<>()});
+}
+
+
 } // namespace hadoken
 
 #endif // FUTURE_HELPERS_HPP
@@ -29,8 +29,12 @@
 #ifndef _HADOKEN_UBLAS_HPP_
 #define _HADOKEN_UBLAS_HPP_
 
+#include <type_traits>
+
 #include <boost/numeric/ublas/matrix.hpp>
 
+#include <hadoken/parallel/algorithm.hpp>
+
 namespace hadoken {
 
 namespace ublas {
@@ -50,6 +54,24 @@ inline void for_each(boost::numeric::ublas::matrix<T>& mat, Fun f) {
 }
 
 
+///
+/// Execute a predicate on every element of the matrix with a hadoken::parallel execution policy,
+/// the matrix is processed by tiles sized for the L2 cache, following its storage order
+///
+template <typename ExecPolicy, typename T, typename Layout, typename Storage, typename Fun>
+inline void for_each(ExecPolicy&& policy, boost::numeric::ublas::matrix<T, Layout, Storage>& mat, Fun f) {
+    const bool column_major =
+        std::is_same<typename Layout::orientation_category, boost::numeric::ublas::column_major_tag>::value;
+
+    const parallel::extents space = column_major ? parallel::extents(mat.size2(), mat.size1())
+                                                 : parallel::extents(mat.size1(), mat.size2());
+
+    parallel::for_index(policy, space, parallel::cache_tile(space, sizeof(T)), [&](std::size_t outer, std::size_t inner) {
+        f(column_major ? mat(inner, outer) : mat(outer, inner));
+    });
+}
+
+
 ///
 /// set all element of the matrix to zero
 ///
@@ -30,6 +30,8 @@
 #define HADOKEN_OPTIONAL_HPP
 
 
+#include <type_traits>
+
 #include <boost/optional.hpp>
 
 namespace hadoken {
@@ -38,6 +40,23 @@ template <typename T>
 using optional = boost::optional<T>;
 
 
+///
+/// empty optional, with the storage of a scalar value initialized
+///
+/// boost stores scalars directly and copies the storage of an empty optional,
+/// gcc reports these copies with -Wmaybe-uninitialized
+///
+template <typename T>
+inline typename std::enable_if<std::is_scalar<T>::value, optional<T>>::type empty_optional() {
+    return optional<T>(false, T());
+}
+
+template <typename T>
+inline typename std::enable_if<!std::is_scalar<T>::value, optional<T>>::type empty_optional() {
+    return optional<T>();
+}
+
+
 
 } // namespace hadoken
 
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2019, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <boost/chrono.hpp>
+
+#include <hadoken/format/format.hpp>
+
+#include <hadoken/containers/concurrent_queue.hpp>
+#include <hadoken/executor/thread_pool_executor.hpp>
+
+
+using namespace boost::chrono;
+
+typedef steady_clock::time_point tp;
+typedef steady_clock cl;
+
+
+// reference pool: workers poll the shared queue with a 10ms timeout
+class polling_pool_executor {
+  public:
+    explicit polling_pool_executor(std::size_t n_thread) : _queue(), _finished(false), _workers() {
+        for (std::size_t i = 0; i < n_thread; ++i) {
+            _workers.emplace_back([this]() {
+                while (!_finished) {
+                    auto work_item = _queue.try_pop(std::chrono::milliseconds(10));
+                    if (work_item) {
+                        work_item.get()();
+                    }
+                }
+            });
+        }
+    }
+
+    ~polling_pool_executor() {
+        for (auto& w : _workers) {
+            _finished = true;
+            w.join();
+        }
+    }
+
+    void execute(std::function<void()> task) { _queue.push(std::move(task)); }
+
+  private:
+    hadoken::concurrent_queue<std::function<void()>> _queue;
+    std::atomic<bool> _finished;
+    std::vector<std::thread> _workers;
+};
+
+
+// user + system CPU time of the process in microseconds
+double process_cpu_time() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return double(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 + double(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+
+template <typename Executor>
+void warm_up(Executor& executor) {
+    std::atomic<bool> done(false);
+    executor.execute([&]() { done = true; });
+    while (!done) {
+        std::this_thread::yield();
+    }
+}
+
+
+template <typename Executor>
+void idle_cpu_test(std::size_t n_thread, std::size_t idle_ms, const std::string& executor_name) {
+    Executor executor(n_thread);
+    warm_up(executor);
+
+    const double cpu1 = process_cpu_time();
+    std::this_thread::sleep_for(std::chrono::milliseconds(idle_ms));
+    const double cpu2 = process_cpu_time();
+
+    std::cout << executor_name << "; idle_cpu; " << n_thread << "; " << (cpu2 - cpu1) / 1000.0 << " ms of cpu for " << idle_ms
+              << " ms idle;" << std::endl;
+}
+
+
+template <typename Executor>
+void teardown_test(std::size_t n_thread, std::size_t n_iter, const std::string& executor_name) {
+    double cumulated_time = 0;
+
+    for (std::size_t i = 0; i < n_iter; ++i) {
+        std::unique_ptr<Executor> executor(new Executor(n_thread));
+        warm_up(*executor);
+
+        // let the workers go idle
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        tp t1 = cl::now();
+        executor.reset();
+        tp t2 = cl::now();
+
+        cumulated_time += double(boost::chrono::duration_cast<microseconds>(t2 - t1).count());
+    }
+
+    std::cout << executor_name << "; teardown; " << n_thread << "; " << cumulated_time / n_iter << " us;" << std::endl;
+}
+
+
+
+int main() {
+    const std::size_t n_thread = std::max<std::size_t>(std::thread::hardware_concurrency(), 4);
+
+    hadoken::format::scat(std::cout, "\n# test idle executors with ", n_thread, " threads \n");
+    hadoken::format::scat(std::cout, "executor; test; threads; result; \n");
+
+    idle_cpu_test<polling_pool_executor>(n_thread, 1000, "polling_pool_executor");
+    idle_cpu_test<hadoken::thread_pool_executor>(n_thread, 1000, "pool_executor");
+
+    teardown_test<polling_pool_executor>(n_thread, 20, "polling_pool_executor");
+    teardown_test<hadoken::thread_pool_executor>(n_thread, 20, "pool_executor");
+}
@@ -28,8 +28,12 @@
  */
 
 
+#include <atomic>
+#include <cstdlib>
 #include <future>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <thread>
 
 #include <boost/test/floating_point_comparison.hpp>
@@ -40,9 +44,14 @@
 
 #include <hadoken/format/format.hpp>
 
+#include <hadoken/containers/concurrent_ring_queue.hpp>
+#include <hadoken/executor/priority_thread_pool_executor.hpp>
 #include <hadoken/executor/simple_thread_executor.hpp>
 #include <hadoken/executor/system_executor.hpp>
+#include <hadoken/executor/task_graph.hpp>
 #include <hadoken/executor/thread_pool_executor.hpp>
+#include <hadoken/executor/timer_service.hpp>
+#include <hadoken/thread/latch.hpp>
 
 
 using namespace boost::chrono;
@@ -50,6 +59,28 @@ using namespace boost::chrono;
 typedef system_clock::time_point tp;
 typedef system_clock cl;
 
+using ring_pool_executor = hadoken::basic_thread_pool_executor<hadoken::concurrent_ring_queue<hadoken::unique_task>>;
+
+using function_pool_executor = hadoken::basic_thread_pool_executor<hadoken::concurrent_queue<std::function<void()>>>;
+
+
+// count the heap allocations of the process
+// ( not inlined: gcc would report malloc / free as a mismatched new / delete pair )
+static std::atomic<std::size_t> allocation_counter(0);
+
+__attribute__((noinline)) void* operator new(std::size_t size) {
+    allocation_counter.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = std::malloc(size > 0 ? size : 1);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+__attribute__((noinline)) void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
 
 template <typename Executor>
 std::size_t executor_test(std::size_t n_exec, const std::string& executor_name) {
@@ -117,6 +148,305 @@ std::size_t executor_test_twoway(std::size_t n_exec, const std::string& executor
 
 
 
+// allocations per twoway task
+// reference: std::function task with a shared std::promise, as done before unique_task
+std::size_t executor_test_alloc_std_function(std::size_t n_exec, const std::string& executor_name) {
+
+    tp t1, t2;
+
+    std::size_t val = 0;
+
+    function_pool_executor executor;
+
+    const std::size_t alloc_start = allocation_counter.load();
+    t1 = cl::now();
+
+    for (std::size_t i = 0; i < n_exec; ++i) {
+        auto prom = std::make_shared<std::promise<std::size_t>>();
+        auto f = prom->get_future();
+
+        executor.execute([prom, i]() { prom->set_value(i + i); });
+
+        val += f.get();
+    }
+
+    t2 = cl::now();
+    const std::size_t n_alloc = allocation_counter.load() - alloc_start;
+
+    std::cout << executor_name << ": " << double(boost::chrono::duration_cast<microseconds>(t2 - t1).count()) / n_exec
+              << " us/task, " << double(n_alloc) / n_exec << " alloc/task" << std::endl;
+
+    return val;
+}
+
+
+template <typename Executor>
+std::size_t executor_test_alloc_twoway(std::size_t n_exec, const std::string& executor_name,
+                                       typename Executor::scheduling mode = Executor::scheduling::shared_queue) {
+
+    tp t1, t2;
+
+    std::size_t val = 0;
+
+    Executor executor(0, mode);
+
+    const std::size_t alloc_start = allocation_counter.load();
+    t1 = cl::now();
+
+    for (std::size_t i = 0; i < n_exec; ++i) {
+        auto f = executor.twoway_execute([i]() { return i + i; });
+
+        val += f.get();
+    }
+
+    t2 = cl::now();
+    const std::size_t n_alloc = allocation_counter.load() - alloc_start;
+
+    std::cout << executor_name << ": " << double(boost::chrono::duration_cast<microseconds>(t2 - t1).count()) / n_exec
+              << " us/task, " << double(n_alloc) / n_exec << " alloc/task" << std::endl;
+
+    return val;
+}
+
+
+// allocations per task submitted from a worker: the local queues of the work stealing pool
+template <typename Executor>
+std::size_t executor_test_alloc_local(std::size_t n_exec, typename Executor::scheduling mode,
+                                      const std::string& executor_name) {
+
+    tp t1, t2;
+
+    std::atomic<std::size_t> val(0);
+
+    Executor executor(0, mode);
+
+    hadoken::thread::latch done(n_exec);
+
+    const std::size_t alloc_start = allocation_counter.load();
+    t1 = cl::now();
+
+    executor.execute([&]() {
+        for (std::size_t i = 0; i < n_exec; ++i) {
+            executor.execute([&val, &done, i]() {
+                val.fetch_add(i + i, std::memory_order_relaxed);
+                done.count_down();
+            });
+        }
+    });
+
+    done.wait();
+
+    t2 = cl::now();
+    const std::size_t n_alloc = allocation_counter.load() - alloc_start;
+
+    std::cout << executor_name << ": " << double(boost::chrono::duration_cast<microseconds>(t2 - t1).count()) / n_exec
+              << " us/task, " << double(n_alloc) / n_exec << " alloc/task" << std::endl;
+
+    return val.load();
+}
+
+
+
+// launch cost of a fork-join over n_slices
+// mode 0: one twoway task per slice, 1: bulk_execute, 2: bulk_sync_execute ( caller participates )
+template <typename Executor>
+std::size_t executor_test_launch(std::size_t n_exec, std::size_t n_slices, int mode, const std::string& executor_name) {
+
+    tp t1, t2;
+
+    std::atomic<std::size_t> val(0);
+
+    Executor executor(n_slices);
+
+    t1 = cl::now();
+
+    for (std::size_t i = 0; i < n_exec; ++i) {
+        if (mode == 2) {
+            executor.bulk_sync_execute(n_slices, [&val](std::size_t id) { val.fetch_add(id, std::memory_order_relaxed); });
+        } else if (mode == 1) {
+            executor.bulk_execute(n_slices, [&val](std::size_t id) { val.fetch_add(id, std::memory_order_relaxed); }).get();
+        } else {
+            std::vector<typename Executor::template future<void>> futures;
+            for (std::size_t id = 0; id < n_slices; ++id) {
+                futures.emplace_back(executor.twoway_execute([&val, id]() { val.fetch_add(id, std::memory_order_relaxed); }));
+            }
+            for (auto& f : futures) {
+                f.get();
+            }
+        }
+    }
+
+    t2 = cl::now();
+
+    std::cout << executor_name << " " << n_slices << " slices: "
+              << double(boost::chrono::duration_cast<microseconds>(t2 - t1).count()) / n_exec << " us/launch" << std::endl;
+
+    return val.load();
+}
+
+
+
+// throughput of short tasks on all cores
+// each root task spawns its children from inside the pool
+template <typename Executor>
+std::size_t executor_test_throughput(typename Executor::scheduling mode, std::size_t n_root, std::size_t n_child,
+                                     const std::string& executor_name) {
+
+    tp t1, t2;
+
+    std::atomic<std::size_t> val(0);
+
+    Executor executor(std::thread::hardware_concurrency(), mode);
+
+    hadoken::thread::latch done(n_root * n_child);
+
+    t1 = cl::now();
+
+    for (std::size_t i = 0; i < n_root; ++i) {
+        executor.execute([&, i]() {
+            for (std::size_t j = 0; j < n_child; ++j) {
+                executor.execute([&, i, j]() {
+                    val.fetch_add(i + j, std::memory_order_relaxed);
+                    done.count_down();
+                });
+            }
+        });
+    }
+
+    done.wait();
+
+    t2 = cl::now();
+
+    const double n_tasks = double(n_root * n_child);
+    const double elapsed = double(boost::chrono::duration_cast<microseconds>(t2 - t1).count());
+
+    std::cout << executor_name << ": " << elapsed / n_tasks << " us/task, " << n_tasks / elapsed << " Mtasks/s" << std::endl;
+
+    return val.load();
+}
+
+
+
+// runs per second of a pipeline: one source, n_branch parallel stages, one sink
+// mode 0: stages chained with twoway futures, the source / sink joins block the caller
+// mode 1: task_graph built once, run n_exec times
+std::size_t executor_test_pipeline(std::size_t n_exec, std::size_t n_branch, int mode, const std::string& executor_name) {
+
+    tp t1, t2;
+
+    std::atomic<std::size_t> val(0);
+
+    hadoken::thread_pool_executor executor;
+
+    hadoken::task_graph graph;
+    const auto source = graph.emplace([&val]() { val.fetch_add(1, std::memory_order_relaxed); });
+    const auto sink = graph.emplace([&val]() { val.fetch_add(1, std::memory_order_relaxed); });
+    for (std::size_t b = 0; b < n_branch; ++b) {
+        const auto stage = graph.emplace([&val, b]() { val.fetch_add(b, std::memory_order_relaxed); });
+        graph.precede(source, stage);
+        graph.precede(stage, sink);
+    }
+
+    t1 = cl::now();
+
+    for (std::size_t i = 0; i < n_exec; ++i) {
+        if (mode == 1) {
+            graph.run(executor).get();
+        } else {
+            executor.twoway_execute([&val]() { val.fetch_add(1, std::memory_order_relaxed); }).get();
+
+            std::vector<hadoken::thread_pool_executor::future<void>> stages;
+            for (std::size_t b = 0; b < n_branch; ++b) {
+                stages.emplace_back(executor.twoway_execute([&val, b]() { val.fetch_add(b, std::memory_order_relaxed); }));
+            }
+            for (auto& f : stages) {
+                f.get();
+            }
+
+            executor.twoway_execute([&val]() { val.fetch_add(1, std::memory_order_relaxed); }).get();
+        }
+    }
+
+    t2 = cl::now();
+
+    const double elapsed = double(boost::chrono::duration_cast<microseconds>(t2 - t1).count());
+
+    std::cout << executor_name << " " << n_branch << " branches: " << elapsed / n_exec << " us/run, "
+              << n_exec / elapsed * 1e6 << " runs/s" << std::endl;
+
+    return val.load();
+}
+
+
+
+// latency of request path tasks submitted behind a burst of background tasks
+// FIFO pool against the highest priority lane of a priority pool
+template <typename Executor, typename Submit>
+void executor_test_burst_latency(Executor& executor, Submit submit_request, std::size_t n_background,
+                                 const std::string& executor_name) {
+
+    std::atomic<std::size_t> background_done(0);
+    for (std::size_t i = 0; i < n_background; ++i) {
+        executor.execute([&background_done]() {
+            volatile std::size_t spin = 0;
+            for (std::size_t j = 0; j < 2000; ++j) {
+                spin = spin + j;
+            }
+            background_done.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    const tp t1 = cl::now();
+    submit_request(executor, []() {}).get();
+    const tp t2 = cl::now();
+
+    std::cout << executor_name << " " << n_background << " background tasks: request latency "
+              << double(boost::chrono::duration_cast<microseconds>(t2 - t1).count()) << " us, "
+              << background_done.load() << " background tasks done before" << std::endl;
+
+    executor.wait();
+}
+
+
+
+// cost of insertion, cancellation and expiration for n timers spread over 100 ms
+void timer_test(std::size_t n_timers, const std::string& executor_name) {
+
+    hadoken::thread_pool_executor executor;
+    hadoken::timer_service timers(executor);
+
+    std::atomic<std::size_t> fired(0);
+    std::vector<hadoken::timer_handle> handles;
+    handles.reserve(n_timers);
+
+    const tp t1 = cl::now();
+    for (std::size_t i = 0; i < n_timers; ++i) {
+        handles.push_back(timers.execute_after(std::chrono::microseconds(i % 100000), [&fired]() {
+            fired.fetch_add(1, std::memory_order_relaxed);
+        }));
+    }
+    const tp t2 = cl::now();
+
+    for (std::size_t i = 0; i < n_timers; i += 2) {
+        handles[i].cancel();
+    }
+    const tp t3 = cl::now();
+
+    while (timers.pending() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    executor.wait();
+    const tp t4 = cl::now();
+
+    std::cout << executor_name << " " << n_timers << " timers: "
+              << double(boost::chrono::duration_cast<nanoseconds>(t2 - t1).count()) / n_timers << " ns/insert, "
+              << double(boost::chrono::duration_cast<nanoseconds>(t3 - t2).count()) / (n_timers / 2) << " ns/cancel, "
+              << double(boost::chrono::duration_cast<milliseconds>(t4 - t1).count()) << " ms until the last expiration, "
+              << fired.load() << " executed" << std::endl;
+}
+
+
+
 int main() {
 
     const std::size_t n_exec = 20000;
@@ -126,11 +456,79 @@ int main() {
 
     junk += executor_test<hadoken::thread_pool_executor>(n_exec, "pool_executor");
 
+    junk += executor_test<ring_pool_executor>(n_exec, "pool_executor_ring_queue");
+
     junk += executor_test<hadoken::simple_thread_executor>(n_exec, "simple_executor");
 
     junk += executor_test<hadoken::system_executor>(n_exec, "system_executor");
 
     junk += executor_test_twoway<hadoken::thread_pool_executor>(n_exec, "pool_executor_twoway");
 
+    junk += executor_test_twoway<ring_pool_executor>(n_exec, "pool_executor_ring_queue_twoway");
+
+    hadoken::format::scat(std::cout, "\ntest allocations for ", n_exec, " twoway tasks \n");
+
+    junk += executor_test_alloc_std_function(n_exec, "pool_executor_std_function_shared_promise");
+
+    junk += executor_test_alloc_twoway<hadoken::thread_pool_executor>(n_exec, "pool_executor_unique_task");
+
+    junk += executor_test_alloc_twoway<ring_pool_executor>(n_exec, "pool_executor_ring_queue_unique_task");
+
+    junk += executor_test_alloc_twoway<hadoken::thread_pool_executor>(n_exec, "pool_executor_work_stealing_unique_task",
+                                                                      hadoken::thread_pool_executor::scheduling::work_stealing);
+
+    junk += executor_test_alloc_local<hadoken::thread_pool_executor>(
+        n_exec, hadoken::thread_pool_executor::scheduling::shared_queue, "pool_executor_shared_queue_from_worker");
+
+    junk += executor_test_alloc_local<hadoken::thread_pool_executor>(
+        n_exec, hadoken::thread_pool_executor::scheduling::work_stealing, "pool_executor_work_stealing_from_worker");
+
+    hadoken::format::scat(std::cout, "\ntest fork-join launch cost \n");
+
+    for (std::size_t n_slices : {2, 8, 32}) {
+        junk += executor_test_launch<hadoken::thread_pool_executor>(n_exec / 10, n_slices, 0, "pool_executor_twoway_launch");
+        junk += executor_test_launch<hadoken::thread_pool_executor>(n_exec / 10, n_slices, 1, "pool_executor_bulk_launch");
+        junk += executor_test_launch<hadoken::thread_pool_executor>(n_exec / 10, n_slices, 2, "pool_executor_bulk_sync_launch");
+    }
+
+    hadoken::format::scat(std::cout, "\ntest throughput for ", std::thread::hardware_concurrency(), " cores \n");
+
+    junk += executor_test_throughput<hadoken::thread_pool_executor>(hadoken::thread_pool_executor::scheduling::shared_queue,
+                                                                    1000, 1000, "pool_executor_shared_queue_throughput");
+
+    junk += executor_test_throughput<ring_pool_executor>(ring_pool_executor::scheduling::shared_queue, 1000, 1000,
+                                                         "pool_executor_ring_queue_throughput");
+
+    junk += executor_test_throughput<hadoken::thread_pool_executor>(hadoken::thread_pool_executor::scheduling::work_stealing,
+                                                                    1000, 1000, "pool_executor_work_stealing_throughput");
+
+    hadoken::format::scat(std::cout, "\ntest pipeline of dependent stages \n");
+
+    for (std::size_t n_branch : {1, 8, 32}) {
+        junk += executor_test_pipeline(n_exec / 10, n_branch, 0, "pool_executor_chained_futures");
+        junk += executor_test_pipeline(n_exec / 10, n_branch, 1, "pool_executor_task_graph");
+    }
+
+    hadoken::format::scat(std::cout, "\ntest request latency behind a background burst \n");
+
+    {
+        hadoken::thread_pool_executor fifo_pool;
+        executor_test_burst_latency(
+            fifo_pool, [](hadoken::thread_pool_executor& exec, std::function<void()> f) { return exec.twoway_execute(f); },
+            n_exec * 5, "pool_executor_fifo");
+
+        hadoken::priority_thread_pool_executor priority_pool;
+        executor_test_burst_latency(
+            priority_pool,
+            [](hadoken::priority_thread_pool_executor& exec, std::function<void()> f) { return exec.twoway_execute(0, f); },
+            n_exec * 5, "priority_pool_executor_lane_0");
+    }
+
+    hadoken::format::scat(std::cout, "\ntest timer wheel \n");
+
+    for (std::size_t n_timers : {10000, 100000, 500000}) {
+        timer_test(n_timers, "timer_service");
+    }
+
     std::cout << "end junk " << junk << std::endl;
 }
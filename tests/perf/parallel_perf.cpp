@@ -28,8 +28,12 @@
  */
 
 
+#include <algorithm>
+#include <cstdint>
 #include <future>
 #include <mutex>
+#include <numeric>
+#include <random>
 #include <set>
 #include <thread>
 #include <vector>
@@ -152,6 +156,311 @@ std::size_t for_each_set(std::size_t s_set, std::size_t n_exec, const std::strin
 
 
 
+// 64 bytes record, sorted by key
+struct record64 {
+    std::uint64_t key;
+    std::uint64_t payload[7];
+
+    bool operator<(const record64& other) const { return key < other.key; }
+};
+
+template <typename Value>
+inline Value make_sort_value(std::uint64_t v) {
+    return Value(v);
+}
+
+template <>
+inline record64 make_sort_value<record64>(std::uint64_t v) {
+    record64 r;
+    r.key = v;
+    std::fill(r.payload, r.payload + 7, v);
+    return r;
+}
+
+
+// radix sort keys
+inline std::uint32_t sort_key(std::uint32_t v) { return v; }
+
+inline double sort_key(double v) { return v; }
+
+inline std::uint64_t sort_key(const record64& r) { return r.key; }
+
+
+template <typename Value, typename Sort>
+std::size_t sort_vector(std::size_t s_vector, std::size_t n_exec, Sort sort_fun, const std::string& sort_name) {
+
+    tp t1, t2;
+
+    std::mt19937_64 rng(s_vector);
+
+    std::vector<Value> reference(s_vector);
+    for (auto& v : reference) {
+        v = make_sort_value<Value>(rng() % (s_vector * 4 + 1));
+    }
+
+    std::size_t cumulated_time = 0;
+    std::size_t junk = 0;
+
+    for (std::size_t i = 0; i < n_exec; ++i) {
+        std::vector<Value> values(reference);
+
+        t1 = cl::now();
+
+        sort_fun(values.begin(), values.end());
+
+        t2 = cl::now();
+
+        cumulated_time += boost::chrono::duration_cast<microseconds>(t2 - t1).count();
+        junk += std::is_sorted(values.begin(), values.end()) ? 1 : 0;
+    }
+
+    std::cout << "" << sort_name << "; vector;  " << s_vector << "; " << double(cumulated_time) / n_exec << ";" << std::endl;
+
+    return junk;
+}
+
+
+template <typename Value>
+std::size_t sort_all(std::size_t s_vector, std::size_t n_exec, const std::string& prefix, const std::string& type_name) {
+    using iterator = typename std::vector<Value>::iterator;
+    using namespace hadoken;
+
+    std::size_t junk = 0;
+
+    junk += sort_vector<Value>(s_vector, n_exec, [](iterator b, iterator e) { std::sort(b, e); },
+                               fmt::scat(prefix, "std_sort_", type_name));
+
+    junk += sort_vector<Value>(s_vector, n_exec, [](iterator b, iterator e) { parallel::sort(parallel::par, b, e); },
+                               fmt::scat(prefix, "parallel_sort_", type_name));
+
+    junk += sort_vector<Value>(s_vector, n_exec, [](iterator b, iterator e) { std::stable_sort(b, e); },
+                               fmt::scat(prefix, "std_stable_sort_", type_name));
+
+    junk += sort_vector<Value>(s_vector, n_exec, [](iterator b, iterator e) { parallel::stable_sort(parallel::par, b, e); },
+                               fmt::scat(prefix, "parallel_stable_sort_", type_name));
+
+    junk += sort_vector<Value>(
+        s_vector, n_exec,
+        [](iterator b, iterator e) { parallel::radix_sort(parallel::par, b, e, [](const Value& v) { return sort_key(v); }); },
+        fmt::scat(prefix, "parallel_radix_sort_", type_name));
+
+    // median and top 1% selection
+    junk += sort_vector<Value>(s_vector, n_exec, [](iterator b, iterator e) { std::nth_element(b, b + (e - b) / 2, e); },
+                               fmt::scat(prefix, "std_nth_element_", type_name));
+
+    junk += sort_vector<Value>(s_vector, n_exec,
+                               [](iterator b, iterator e) { parallel::nth_element(parallel::par, b, b + (e - b) / 2, e); },
+                               fmt::scat(prefix, "parallel_nth_element_", type_name));
+
+    junk += sort_vector<Value>(s_vector, n_exec, [](iterator b, iterator e) { std::partial_sort(b, b + (e - b) / 100, e); },
+                               fmt::scat(prefix, "std_partial_sort_", type_name));
+
+    junk += sort_vector<Value>(s_vector, n_exec,
+                               [](iterator b, iterator e) { parallel::partial_sort(parallel::par, b, b + (e - b) / 100, e); },
+                               fmt::scat(prefix, "parallel_partial_sort_", type_name));
+    return junk;
+}
+
+
+
+template <typename Reduce>
+double reduce_vector(std::size_t s_vector, std::size_t n_exec, Reduce reduce_fun, const std::string& reduce_name) {
+
+    tp t1, t2;
+
+    std::vector<double> values(s_vector);
+    for (std::size_t i = 0; i < s_vector; ++i) {
+        values[i] = double(i % 1000) * 0.5;
+    }
+
+    std::size_t cumulated_time = 0;
+    double junk = 0;
+
+    for (std::size_t i = 0; i < n_exec; ++i) {
+        t1 = cl::now();
+
+        junk += reduce_fun(values.begin(), values.end());
+
+        t2 = cl::now();
+
+        cumulated_time += boost::chrono::duration_cast<microseconds>(t2 - t1).count();
+    }
+
+    std::cout << "" << reduce_name << "; vector;  " << s_vector << "; " << double(cumulated_time) / n_exec << ";" << std::endl;
+
+    return junk;
+}
+
+
+double reduce_all(std::size_t s_vector, std::size_t n_exec, const std::string& prefix) {
+    using iterator = std::vector<double>::iterator;
+    using namespace hadoken;
+
+    double junk = 0;
+
+    junk += reduce_vector(s_vector, n_exec, [](iterator b, iterator e) { return std::accumulate(b, e, 0.0); },
+                          fmt::scat(prefix, "std_accumulate"));
+
+    junk += reduce_vector(s_vector, n_exec, [](iterator b, iterator e) { return parallel::reduce(parallel::par, b, e, 0.0); },
+                          fmt::scat(prefix, "parallel_reduce"));
+
+    junk += reduce_vector(s_vector, n_exec,
+                          [](iterator b, iterator e) { return parallel::reduce(parallel::par_vec, b, e, 0.0); },
+                          fmt::scat(prefix, "parallel_vec_reduce"));
+
+    junk += reduce_vector(s_vector, n_exec, [](iterator b, iterator e) { return std::inner_product(b, e, b, 0.0); },
+                          fmt::scat(prefix, "std_inner_product"));
+
+    junk += reduce_vector(s_vector, n_exec,
+                          [](iterator b, iterator e) { return parallel::transform_reduce(parallel::par_vec, b, e, b, 0.0); },
+                          fmt::scat(prefix, "parallel_vec_transform_reduce"));
+    return junk;
+}
+
+
+template <typename Search>
+std::size_t search_vector(std::size_t s_vector, std::size_t n_exec, std::size_t match_pos, Search search_fun,
+                          const std::string& search_name) {
+
+    tp t1, t2;
+
+    std::vector<int> values(s_vector, 0);
+    if (match_pos < s_vector) {
+        values[match_pos] = 1;
+    }
+
+    std::size_t cumulated_time = 0;
+    std::size_t junk = 0;
+
+    for (std::size_t i = 0; i < n_exec; ++i) {
+        t1 = cl::now();
+
+        junk += search_fun(values.begin(), values.end()) ? 1 : 0;
+
+        t2 = cl::now();
+
+        cumulated_time += boost::chrono::duration_cast<microseconds>(t2 - t1).count();
+    }
+
+    std::cout << "" << search_name << "; vector;  " << s_vector << "; " << double(cumulated_time) / n_exec << ";" << std::endl;
+
+    return junk;
+}
+
+
+std::size_t search_all(std::size_t s_vector, std::size_t n_exec, const std::string& prefix) {
+    using iterator = std::vector<int>::iterator;
+    using namespace hadoken;
+
+    auto is_one = [](int v) { return v == 1; };
+    std::size_t junk = 0;
+
+    // match in the first percent of the range, then no match
+    for (std::size_t match_pos : {s_vector / 100, s_vector}) {
+        const std::string match_name = (match_pos < s_vector) ? "_early_match" : "_no_match";
+
+        junk += search_vector(s_vector, n_exec, match_pos, [&](iterator b, iterator e) { return std::any_of(b, e, is_one); },
+                              fmt::scat(prefix, "std_any_of", match_name));
+
+        junk += search_vector(s_vector, n_exec, match_pos,
+                              [&](iterator b, iterator e) { return parallel::any_of(parallel::par, b, e, is_one); },
+                              fmt::scat(prefix, "parallel_any_of", match_name));
+    }
+    return junk;
+}
+
+
+template <typename Compact>
+std::size_t compact_vector(std::size_t s_vector, std::size_t n_exec, Compact compact_fun, const std::string& compact_name) {
+
+    tp t1, t2;
+
+    std::vector<int> values(s_vector), output(s_vector);
+    std::mt19937 rng(s_vector);
+    std::generate(values.begin(), values.end(), [&rng]() { return int(rng() % 1000); });
+
+    std::size_t cumulated_time = 0;
+    std::size_t junk = 0;
+
+    for (std::size_t i = 0; i < n_exec; ++i) {
+        t1 = cl::now();
+
+        junk += std::size_t(compact_fun(values.begin(), values.end(), output.begin()) - output.begin());
+
+        t2 = cl::now();
+
+        cumulated_time += boost::chrono::duration_cast<microseconds>(t2 - t1).count();
+    }
+
+    std::cout << "" << compact_name << "; vector;  " << s_vector << "; " << double(cumulated_time) / n_exec << ";" << std::endl;
+
+    return junk;
+}
+
+
+std::size_t compact_all(std::size_t s_vector, std::size_t n_exec, const std::string& prefix) {
+    using iterator = std::vector<int>::iterator;
+    using namespace hadoken;
+
+    auto is_small = [](int v) { return v < 500; };
+    std::size_t junk = 0;
+
+    junk += compact_vector(s_vector, n_exec,
+                           [&](iterator b, iterator e, iterator d) { return std::copy_if(b, e, d, is_small); },
+                           fmt::scat(prefix, "std_copy_if"));
+
+    junk += compact_vector(s_vector, n_exec,
+                           [&](iterator b, iterator e, iterator d) {
+                               return parallel::copy_if(parallel::par, b, e, d, is_small);
+                           },
+                           fmt::scat(prefix, "parallel_copy_if"));
+    return junk;
+}
+
+
+template <typename Policy>
+float vector_all(const Policy& policy, std::size_t s_vector, std::size_t n_exec, const std::string& prefix) {
+    using namespace hadoken;
+
+    std::vector<float> values(s_vector, 1.0f), others(s_vector, 2.0f);
+    std::size_t t_for_each = 0, t_fill = 0, t_transform = 0, t_count_if = 0, t_reduce = 0;
+    float junk = 0;
+
+    auto timed = [](std::size_t& cumulated, tp t1) { cumulated += duration_cast<microseconds>(cl::now() - t1).count(); };
+
+    for (std::size_t i = 0; i < n_exec; ++i) {
+        tp t1 = cl::now();
+        parallel::for_each(policy, values.begin(), values.end(), [](float& v) { v = v * 0.5f + 1.0f; });
+        timed(t_for_each, t1);
+
+        t1 = cl::now();
+        parallel::fill(policy, others.begin(), others.end(), float(i));
+        timed(t_fill, t1);
+
+        t1 = cl::now();
+        parallel::transform(policy, values.begin(), values.end(), others.begin(), others.begin(),
+                            [](float a, float b) { return a * 2.0f + b; });
+        timed(t_transform, t1);
+
+        t1 = cl::now();
+        junk += float(parallel::count_if(policy, others.begin(), others.end(), [](float v) { return v > 3.0f; }));
+        timed(t_count_if, t1);
+
+        t1 = cl::now();
+        junk += parallel::reduce(policy, others.begin(), others.end(), 0.0f);
+        timed(t_reduce, t1);
+    }
+
+    const std::pair<const char*, std::size_t> timings[] = {
+        {"for_each", t_for_each}, {"fill", t_fill}, {"transform", t_transform}, {"count_if", t_count_if}, {"reduce", t_reduce}};
+
+    for (const auto& t : timings) {
+        std::cout << prefix << t.first << "; vector;  " << s_vector << "; " << double(t.second) / n_exec << ";" << std::endl;
+    }
+    return junk;
+}
+
+
 struct std_for_each {
 
     template <typename Iter, typename Fun>
@@ -188,10 +497,58 @@ int main() {
     const std::size_t n_exec = 100, max_size_vector = 200000000, limit_size_iter = 20000;
     std::size_t junk = 0;
 
+    hadoken::format::scat(std::cout, "\n# test sort algorithms \n");
+    hadoken::format::scat(std::cout, "theading; cores; algorithm; container; size; time; \n");
+
+    const std::size_t max_size_sort = 10000000;
+    for (std::size_t i = 1000; i <= max_size_sort; i *= 10) {
+        const std::size_t sort_n_exec = std::max<std::size_t>(1, 10000 / (i / 100));
+        const std::string prefix = fmt::scat(parallel_mode, "; ", ncore, "; ");
+
+        junk += sort_all<std::uint32_t>(i, sort_n_exec, prefix, "int");
+        junk += sort_all<double>(i, sort_n_exec, prefix, "double");
+        junk += sort_all<record64>(i, sort_n_exec, prefix, "record64");
+    }
+
+    hadoken::format::scat(std::cout, "\n# test reduce algorithms \n");
+    hadoken::format::scat(std::cout, "theading; cores; algorithm; container; size; time; \n");
+
+    const std::size_t max_size_reduce = 100000000;
+    for (std::size_t i = 1000; i <= max_size_reduce; i *= 10) {
+        const std::size_t reduce_n_exec = std::max<std::size_t>(1, 100000 / (i / 100));
+        junk += std::size_t(reduce_all(i, reduce_n_exec, fmt::scat(parallel_mode, "; ", ncore, "; ")) > 0);
+    }
+
+    hadoken::format::scat(std::cout, "\n# test vector execution, par against par_vec \n");
+    hadoken::format::scat(std::cout, "theading; cores; policy; algorithm; container; size; time; \n");
+
+    for (std::size_t i = 1000; i <= max_size_reduce; i *= 10) {
+        const std::size_t vector_n_exec = std::max<std::size_t>(1, 100000 / (i / 100));
+        const std::string prefix = fmt::scat(parallel_mode, "; ", ncore, "; ");
+
+        junk += std::size_t(vector_all(hadoken::parallel::par, i, vector_n_exec, fmt::scat(prefix, "par; ")) > 0);
+        junk += std::size_t(vector_all(hadoken::parallel::par_vec, i, vector_n_exec, fmt::scat(prefix, "par_vec; ")) > 0);
+    }
+
+    hadoken::format::scat(std::cout, "\n# test search algorithms \n");
+    hadoken::format::scat(std::cout, "theading; cores; algorithm; container; size; time; \n");
+
+    for (std::size_t i = 1000; i <= max_size_reduce; i *= 10) {
+        const std::size_t search_n_exec = std::max<std::size_t>(1, 100000 / (i / 100));
+        junk += search_all(i, search_n_exec, fmt::scat(parallel_mode, "; ", ncore, "; "));
+    }
+
+    hadoken::format::scat(std::cout, "\n# test stream compaction algorithms \n");
+    hadoken::format::scat(std::cout, "theading; cores; algorithm; container; size; time; \n");
+
+    for (std::size_t i = 1000; i <= max_size_reduce; i *= 10) {
+        const std::size_t compact_n_exec = std::max<std::size_t>(1, 100000 / (i / 100));
+        junk += compact_all(i, compact_n_exec, fmt::scat(parallel_mode, "; ", ncore, "; "));
+    }
+
     hadoken::format::scat(std::cout, "\n# test algorithms for vectors with ", n_exec, " iterations \n");
     hadoken::format::scat(std::cout, "theading; cores; executor; container; size; time; \n");
 
-
     std::size_t local_n_exec = n_exec;
     for (std::size_t i = 1; i < max_size_vector; i *= 10) {
         junk += for_each_vector<std_for_each>(i, local_n_exec, fmt::scat(parallel_mode, "; ", ncore, "; ", "serial_for_each"));
@@ -39,7 +39,9 @@
 
 
 #include <hadoken/containers/concurrent_queue.hpp>
+#include <hadoken/containers/concurrent_ring_queue.hpp>
 #include <hadoken/containers/small_vector.hpp>
+#include <hadoken/containers/work_stealing_deque.hpp>
 
 #include <hadoken/utility/range.hpp>
 
@@ -339,3 +341,150 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(concurrent_queue_test_pthread, T, small_vector_typ
     BOOST_CHECK_EQUAL(result_items.size(), nb_input_items);
     BOOST_CHECK_EQUAL(queue.size(), 0);
 }
+
+
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(concurrent_ring_queue_test, T, small_vector_types) {
+
+    using namespace hadoken;
+
+    constexpr std::size_t nb_input_items = 10000;
+
+    constexpr std::size_t producer_thread = 4, consummer_thread = 4;
+
+    content_generator<T> gen;
+
+    // small capacity, force producers to wait for free slots
+    concurrent_ring_queue<T, 64> queue;
+
+    BOOST_CHECK_EQUAL(queue.size(), 0);
+    BOOST_CHECK_EQUAL(queue.empty(), true);
+    BOOST_CHECK(!queue.try_pop());
+    BOOST_CHECK(!queue.try_pop(std::chrono::microseconds(100)));
+
+    // fill until full
+    for (std::size_t i = 0; i < queue.capacity(); ++i) {
+        T item = gen(i);
+        BOOST_CHECK(queue.try_push(item));
+    }
+    T extra_item = gen(0);
+    BOOST_CHECK(queue.try_push(extra_item) == false);
+    BOOST_CHECK_EQUAL(queue.size(), queue.capacity());
+
+    // FIFO order
+    for (std::size_t i = 0; i < queue.capacity(); ++i) {
+        auto item = queue.try_pop();
+        BOOST_CHECK(item);
+        BOOST_CHECK(item.get() == gen(i));
+    }
+    BOOST_CHECK_EQUAL(queue.empty(), true);
+
+    std::vector<std::thread> producers, consumers;
+    std::atomic<std::size_t> counter(0);
+    std::mutex result_lock;
+
+    for (std::size_t p = 0; p < producer_thread; ++p) {
+        producers.emplace_back([&, p]() {
+            for (std::size_t i = p; i < nb_input_items; i += producer_thread) {
+                queue.push(gen(i));
+            }
+        });
+    }
+
+    std::map<T, std::size_t> expected_items;
+    for (std::size_t i = 0; i < nb_input_items; ++i) {
+        expected_items[gen(i)] += 1;
+    }
+
+    std::map<T, std::size_t> result_items;
+
+    for (std::size_t c = 0; c < consummer_thread; ++c) {
+        consumers.emplace_back([&]() {
+            while (counter.load() < nb_input_items) {
+                auto item = queue.try_pop(std::chrono::microseconds(100));
+                if (item) {
+                    counter += 1;
+                    std::lock_guard<std::mutex> _l(result_lock);
+                    result_items[item.get()] += 1;
+                }
+            }
+        });
+    }
+
+    for (auto& t : producers) {
+        t.join();
+    }
+
+    for (auto& t : consumers) {
+        t.join();
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), nb_input_items);
+    BOOST_CHECK(result_items == expected_items);
+    BOOST_CHECK_EQUAL(queue.size(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(work_stealing_deque_test) {
+
+    using namespace hadoken;
+
+    constexpr std::size_t nb_input_items = 100000;
+
+    constexpr std::size_t thief_thread = 4;
+
+    // small initial capacity, force resize during the test
+    work_stealing_deque<std::size_t> deque(2);
+
+    BOOST_CHECK_EQUAL(deque.empty(), true);
+    BOOST_CHECK(!deque.pop());
+    BOOST_CHECK(!deque.steal());
+
+    // owner only: LIFO order
+    for (std::size_t i = 0; i < 16; ++i) {
+        deque.push(i);
+    }
+    BOOST_CHECK_EQUAL(deque.size(), 16);
+    BOOST_CHECK_EQUAL(deque.pop().get(), 15);
+    BOOST_CHECK_EQUAL(deque.steal().get(), 0);
+
+    while (deque.pop()) {
+    }
+    BOOST_CHECK_EQUAL(deque.empty(), true);
+
+    // owner push and pop, thieves steal concurrently
+    std::atomic<std::size_t> counter(0), sum(0);
+    std::atomic<bool> owner_done(false);
+
+    std::vector<std::thread> thieves;
+    for (std::size_t i = 0; i < thief_thread; ++i) {
+        thieves.emplace_back([&]() {
+            while (owner_done.load() == false || deque.empty() == false) {
+                auto item = deque.steal();
+                if (item) {
+                    counter += 1;
+                    sum += item.get();
+                }
+            }
+        });
+    }
+
+    for (std::size_t i = 1; i <= nb_input_items; ++i) {
+        deque.push(i);
+        if (i % 3 == 0) {
+            auto item = deque.pop();
+            if (item) {
+                counter += 1;
+                sum += item.get();
+            }
+        }
+    }
+    owner_done.store(true);
+
+    for (auto& t : thieves) {
+        t.join();
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), nb_input_items);
+    BOOST_CHECK_EQUAL(sum.load(), nb_input_items * (nb_input_items + 1) / 2);
+}
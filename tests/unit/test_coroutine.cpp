@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#define BOOST_TEST_MODULE coroutineTests
+#define BOOST_TEST_MAIN
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <hadoken/executor/coroutine.hpp>
+#include <hadoken/executor/thread_pool_executor.hpp>
+#include <hadoken/thread/future_helpers.hpp>
+
+
+namespace {
+
+hadoken::task<int> answer() { co_return 42; }
+
+hadoken::task<std::string> twice(int v) {
+    const int a = co_await answer();
+    co_return std::to_string(a + v);
+}
+
+hadoken::task<void> failing() {
+    co_await answer();
+    throw std::runtime_error("coroutine error");
+}
+
+hadoken::task<bool> recover() {
+    try {
+        co_await failing();
+    } catch (std::runtime_error&) {
+        co_return true;
+    }
+    co_return false;
+}
+
+hadoken::task<std::size_t> on_pool(hadoken::thread_pool_executor& pool, std::size_t i) {
+    co_await hadoken::schedule_on(pool);
+    if (pool.running_in_this_thread() == false) {
+        throw std::logic_error("not running in the pool");
+    }
+    const int a = co_await answer();
+    co_return i + std::size_t(a);
+}
+
+hadoken::task<int> await_future(hadoken::thread_pool_executor& pool) {
+    const int a = co_await pool.twoway_execute([]() { return 20; });
+    const int b = co_await hadoken::make_ready_future(1);
+    co_return a * 2 + b;
+}
+
+hadoken::task<std::size_t> long_chain(std::size_t n) {
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        sum += std::size_t(co_await answer());
+    }
+    co_return sum;
+}
+
+} // namespace
+
+
+BOOST_AUTO_TEST_CASE(coroutine_task_test) {
+    BOOST_CHECK_EQUAL(hadoken::sync_wait(answer()), 42);
+    BOOST_CHECK_EQUAL(hadoken::sync_wait(twice(1)), "43");
+    BOOST_CHECK_THROW(hadoken::sync_wait(failing()), std::runtime_error);
+    BOOST_CHECK(hadoken::sync_wait(recover()));
+
+    // symmetric transfer, no stack growth
+    BOOST_CHECK_EQUAL(hadoken::sync_wait(long_chain(100000)), 4200000);
+
+    // lazy start
+    hadoken::task<int> lazy = answer();
+    BOOST_CHECK(lazy.valid());
+    BOOST_CHECK(!lazy.done());
+}
+
+
+BOOST_AUTO_TEST_CASE(coroutine_executor_test) {
+    hadoken::thread_pool_executor pool(2);
+
+    BOOST_CHECK_EQUAL(hadoken::sync_wait(on_pool(pool, 1)), 43);
+    BOOST_CHECK_EQUAL(hadoken::sync_wait(await_future(pool)), 41);
+
+    // thousands of in-flight tasks on two threads
+    const std::size_t n = 5000;
+    std::vector<hadoken::future<std::size_t>> results;
+    for (std::size_t i = 0; i < n; ++i) {
+        results.push_back(hadoken::spawn(on_pool(pool, i)));
+    }
+
+    std::size_t sum = 0;
+    for (auto& f : hadoken::when_all(results.begin(), results.end()).get()) {
+        sum += f.get();
+    }
+    BOOST_CHECK_EQUAL(sum, n * (n - 1) / 2 + n * 42);
+}
@@ -40,6 +40,7 @@
 
 #include <hadoken/os/env.hpp>
 #include <hadoken/os/hostname.hpp>
+#include <hadoken/os/topology.hpp>
 
 #include "test_helpers.hpp"
 
@@ -66,3 +67,18 @@ BOOST_AUTO_TEST_CASE(getenv_check_simple) {
     hadoken::optional<std::string> unexisting = hadoken::get_env("BLOUBLOUBLOUBLOUBLOU_TOTALLY_EXISTING");
     BOOST_CHECK(!unexisting);
 }
+
+
+
+
+BOOST_AUTO_TEST_CASE(cache_size_check_simple) {
+
+    const std::size_t l1_size = hadoken::get_cache_size(1), l2_size = hadoken::get_cache_size(2);
+
+    // unknown on some virtual machines
+    if (l1_size > 0 && l2_size > 0) {
+        BOOST_CHECK(l1_size <= l2_size);
+    }
+
+    BOOST_CHECK_EQUAL(hadoken::get_cache_size(42), 0);
+}
@@ -31,18 +31,33 @@
 #define BOOST_TEST_MAIN
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <future>
 #include <iostream>
+#include <list>
+#include <memory>
 #include <numeric>
 #include <random>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <thread>
 
 #include <chrono>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <string>
 
 #include <boost/test/unit_test.hpp>
 
+#include <hadoken/executor/inline_executor.hpp>
+#include <hadoken/executor/priority_thread_pool_executor.hpp>
+#include <hadoken/executor/thread_pool_executor.hpp>
 #include <hadoken/parallel/algorithm.hpp>
+#include <hadoken/random/random.hpp>
+#include <hadoken/ublas/ublas.hpp>
 
 //#include <parallel/algorithm>
 
@@ -144,6 +159,162 @@ BOOST_AUTO_TEST_CASE(parallel_for_each_nested) {
 
 
 
+BOOST_AUTO_TEST_CASE(parallel_execution_parameters_test) {
+
+    using namespace hadoken;
+
+    // default and custom parameters
+    BOOST_CHECK_EQUAL(parallel::par.get_threads(), 0);
+    BOOST_CHECK_EQUAL(parallel::par.get_grain(), parallel::parallel_execution_policy::default_grain);
+    BOOST_CHECK(parallel::par.get_chunking() == parallel::chunking_strategy::static_chunk);
+
+    auto custom_policy = parallel::par.with(parallel::grain(4096), parallel::threads(8), parallel::guided_chunking);
+    BOOST_CHECK_EQUAL(custom_policy.get_threads(), 8);
+    BOOST_CHECK_EQUAL(custom_policy.get_grain(), 4096);
+    BOOST_CHECK(custom_policy.get_chunking() == parallel::chunking_strategy::guided_chunk);
+
+    // tiny input: serial execution on the calling thread
+    {
+        std::vector<int> values(10, 0);
+        const std::thread::id caller_id = std::this_thread::get_id();
+        std::size_t n_calls = 0;
+
+        parallel::for_range(parallel::par, values.begin(), values.end(), [&](std::vector<int>::iterator, std::vector<int>::iterator) {
+            BOOST_CHECK(std::this_thread::get_id() == caller_id);
+            n_calls++;
+        });
+        BOOST_CHECK_EQUAL(n_calls, 1);
+    }
+
+    const std::size_t n = 10007;
+    std::vector<std::size_t> values(n);
+    std::iota(values.begin(), values.end(), 0);
+
+    std::vector<std::size_t> scan_ref(n);
+    std::partial_sum(values.begin(), values.end(), scan_ref.begin());
+
+    for (auto strategy : {parallel::static_chunking, parallel::dynamic_chunking, parallel::guided_chunking}) {
+        for (std::size_t n_threads : {1, 3, 8}) {
+            for (std::size_t grain_size : {1, 7, 1000, 20000}) {
+                auto policy = parallel::par.with(strategy, parallel::threads(n_threads), parallel::grain(grain_size));
+
+                // each element is processed exactly once
+                std::vector<std::atomic<int>> visits(n);
+                for (auto& v : visits) {
+                    v.store(0);
+                }
+                parallel::for_each(policy, values.begin(), values.end(), [&visits](std::size_t i) { visits[i] += 1; });
+                BOOST_CHECK(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& v) { return v.load() == 1; }));
+
+                BOOST_CHECK_EQUAL(parallel::count_if(policy, values.begin(), values.end(), [](std::size_t v) { return v % 3 == 0; }),
+                                  (n + 2) / 3);
+
+                BOOST_CHECK(parallel::all_of(policy, values.begin(), values.end(), [n](std::size_t v) { return v < n; }));
+
+                std::vector<std::size_t> doubled(n);
+                parallel::transform(policy, values.begin(), values.end(), doubled.begin(), [](std::size_t v) { return 2 * v; });
+                BOOST_CHECK_EQUAL(doubled[n - 1], 2 * (n - 1));
+
+                std::vector<std::size_t> scan_res(n);
+                parallel::inclusive_scan(policy, values.begin(), values.end(), scan_res.begin());
+                BOOST_CHECK(scan_res == scan_ref);
+            }
+        }
+    }
+}
+
+
+namespace {
+
+// executor without bulk submission, counts the tasks it receives
+class counting_executor {
+  public:
+    explicit counting_executor(std::size_t n_threads) : pool(n_threads), counter(0) {}
+
+    template <typename Function>
+    void execute(Function&& fun) {
+        counter += 1;
+        pool.execute(std::forward<Function>(fun));
+    }
+
+    hadoken::thread_pool_executor pool;
+    std::atomic<std::size_t> counter;
+};
+
+} // namespace
+
+
+BOOST_AUTO_TEST_CASE(parallel_executor_policy_test) {
+
+    using namespace hadoken;
+
+    const std::size_t n = 100000;
+    std::vector<std::size_t> values(n);
+    std::iota(values.begin(), values.end(), 0);
+    const std::size_t expected = std::count_if(values.begin(), values.end(), [](std::size_t v) { return v % 7 == 0; });
+
+    // dedicated thread pool
+    {
+        auto pool_policy = parallel::par_on(std::make_shared<thread_pool_executor>(3));
+        BOOST_CHECK(parallel::detail::is_parallel_policy(pool_policy));
+        BOOST_CHECK_EQUAL(pool_policy.get_executor().size(), 3);
+
+        std::vector<std::size_t> res(n, 0);
+        parallel::transform(pool_policy, values.begin(), values.end(), res.begin(), [](std::size_t v) { return v + 1; });
+        BOOST_CHECK_EQUAL(res[n - 1], n);
+
+        BOOST_CHECK_EQUAL(parallel::count_if(pool_policy.with(parallel::dynamic_chunking), values.begin(), values.end(),
+                                             [](std::size_t v) { return v % 7 == 0; }),
+                          expected);
+    }
+
+    // inline executor: everything runs in the calling thread
+    {
+        auto inline_policy = parallel::par_on(std::make_shared<inline_executor>()).with(parallel::threads(4));
+        const std::thread::id caller_id = std::this_thread::get_id();
+        std::size_t n_ranges = 0;
+
+        parallel::for_range(inline_policy, values.begin(), values.end(),
+                            [&](std::vector<std::size_t>::iterator, std::vector<std::size_t>::iterator) {
+                                BOOST_CHECK(std::this_thread::get_id() == caller_id);
+                                n_ranges++;
+                            });
+        BOOST_CHECK_EQUAL(n_ranges, 4);
+    }
+
+    // generic executor, one task per slice
+    {
+        auto exec = std::make_shared<counting_executor>(2);
+        auto generic_policy = parallel::par_on(exec).with(parallel::threads(4));
+
+        BOOST_CHECK_EQUAL(parallel::count_if(generic_policy, values.begin(), values.end(), [](std::size_t v) { return v % 7 == 0; }),
+                          expected);
+        BOOST_CHECK_EQUAL(exec->counter.load(), 3);
+    }
+
+    // generic executor, nested calls from all the workers run inline and do not deadlock
+    {
+        auto pool = std::make_shared<priority_thread_pool_executor>(2);
+        auto nested_policy = parallel::par_on(pool).with(parallel::threads(4));
+        std::vector<std::vector<int>> blocks(2, std::vector<int>(10000, 1));
+
+        std::vector<future<void>> outer;
+        for (auto& block : blocks) {
+            outer.push_back(pool->twoway_execute([&nested_policy, &block]() {
+                parallel::for_each(nested_policy, block.begin(), block.end(), [](int& v) { v += 1; });
+            }));
+        }
+        for (auto& f : outer) {
+            f.get();
+        }
+
+        for (const auto& block : blocks) {
+            BOOST_CHECK_EQUAL(std::count(block.begin(), block.end(), 2), std::ptrdiff_t(block.size()));
+        }
+    }
+}
+
+
 BOOST_AUTO_TEST_CASE(parallel_fill_test) {
 
     using namespace hadoken;
@@ -174,6 +345,86 @@ BOOST_AUTO_TEST_CASE(parallel_fill_test) {
 
 
 
+BOOST_AUTO_TEST_CASE(parallel_generate_test) {
+
+    using namespace hadoken;
+
+    std::vector<int> values(10000, 0);
+    std::atomic<int> counter(0);
+
+    auto last = parallel::generate_n(parallel::par, values.begin(), 5000, [&counter]() { return ++counter; });
+    BOOST_CHECK(last == values.begin() + 5000);
+    BOOST_CHECK_EQUAL(counter.load(), 5000);
+    BOOST_CHECK(std::count(values.begin(), values.end(), 0) == 5000);
+
+    BOOST_CHECK(parallel::generate_n(parallel::seq, values.begin(), 0, [&counter]() { return ++counter; }) == values.begin());
+}
+
+
+template <typename Engine, typename Distribution>
+void check_generate_random(const Engine& engine, const Distribution& dist, std::size_t n) {
+    using namespace hadoken;
+    using value_type = typename Distribution::result_type;
+
+    const Engine engine_copy(engine);
+
+    std::vector<value_type> reference(n);
+    parallel::generate_random(parallel::seq, reference.begin(), reference.end(), engine, dist);
+
+    // bit-identical for any policy and any number of threads
+    std::vector<value_type> values(n);
+    parallel::generate_random(parallel::par, values.begin(), values.end(), engine, dist);
+    BOOST_CHECK(values == reference);
+
+    for (std::size_t n_threads : {1, 3, 8}) {
+        auto policy = parallel::par.with(parallel::threads(n_threads), parallel::grain(1));
+
+        std::fill(values.begin(), values.end(), value_type());
+        parallel::generate_random(policy, values.begin(), values.end(), engine, dist);
+        BOOST_CHECK(values == reference);
+
+        std::fill(values.begin(), values.end(), value_type());
+        parallel::generate_random(policy.with(parallel::dynamic_chunking), values.begin(), values.end(), engine, dist);
+        BOOST_CHECK(values == reference);
+    }
+
+    std::list<value_type> list_values(n);
+    parallel::generate_random(parallel::par, list_values.begin(), list_values.end(), engine, dist);
+    BOOST_CHECK(std::equal(list_values.begin(), list_values.end(), reference.begin()));
+
+    // a prefix gives the same numbers
+    std::vector<value_type> prefix(n / 3);
+    parallel::generate_random(parallel::par.with(parallel::grain(1)), prefix.begin(), prefix.end(), engine, dist);
+    BOOST_CHECK(std::equal(prefix.begin(), prefix.end(), reference.begin()));
+
+    BOOST_CHECK(engine == engine_copy);
+    if (n > 1) {
+        BOOST_CHECK(std::adjacent_find(reference.begin(), reference.end()) == reference.end());
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(parallel_generate_random) {
+
+    using namespace hadoken;
+    using engine_type = counter_engine<threefry4x64>;
+
+    for (std::size_t n : {0, 1, 1023, 1024, 1025, 100003}) {
+        check_generate_random(engine_type(42), std::uniform_real_distribution<double>(0, 1), n);
+        check_generate_random(counter_engine<threefry2x32>(7), std::normal_distribution<float>(0, 1), n);
+        check_generate_random(std::mt19937(1234), std::uniform_int_distribution<std::uint64_t>(), n);
+    }
+
+    // different engines, different streams
+    std::vector<double> v1(1000), v2(1000);
+    std::uniform_real_distribution<double> dist;
+    parallel::generate_random(parallel::par, v1.begin(), v1.end(), engine_type(1), dist);
+    parallel::generate_random(parallel::par, v2.begin(), v2.end(), engine_type(2), dist);
+    BOOST_CHECK(v1 != v2);
+}
+
+
+
 BOOST_AUTO_TEST_CASE(parallel_count_test) {
 
     using namespace hadoken;
@@ -512,6 +763,83 @@ bool is_ordered(Container& c) {
 }
 
 
+BOOST_AUTO_TEST_CASE(parallel_find_test) {
+
+    using namespace hadoken;
+
+    const std::size_t n = 100003;
+
+    std::mt19937 rng(42);
+    std::vector<int> values(n);
+    for (auto& v : values) {
+        v = int(rng() % 1000);
+    }
+    // several matches, the leftmost one is expected
+    for (std::size_t pos : {n - 1, std::size_t(70000), std::size_t(5000), std::size_t(70001)}) {
+        values[pos] = 1000 + int(pos % 3);
+    }
+
+    const std::vector<int> set = {1001, 1002, 2000};
+    auto is_large = [](int v) { return v >= 1000; };
+    auto is_small = [](int v) { return v < 1000; };
+
+    auto check_policy = [&](const parallel::parallel_execution_policy& policy) {
+        for (int target : {1000, 1001, 1002, 1003, 999}) {
+            BOOST_CHECK(parallel::find(policy, values.begin(), values.end(), target) ==
+                        std::find(values.begin(), values.end(), target));
+        }
+
+        BOOST_CHECK(parallel::find_if(policy, values.begin(), values.end(), is_large) ==
+                    std::find_if(values.begin(), values.end(), is_large));
+        BOOST_CHECK(parallel::find_if_not(policy, values.begin(), values.end(), is_small) ==
+                    std::find_if(values.begin(), values.end(), is_large));
+
+        BOOST_CHECK(parallel::find_first_of(policy, values.begin(), values.end(), set.begin(), set.end()) ==
+                    std::find_first_of(values.begin(), values.end(), set.begin(), set.end()));
+        BOOST_CHECK(parallel::find_first_of(policy, values.begin(), values.end(), set.begin(), set.end(),
+                                            [](int v, int s) { return v + 1 == s; }) ==
+                    std::find_first_of(values.begin(), values.end(), set.begin(), set.end(),
+                                       [](int v, int s) { return v + 1 == s; }));
+
+        BOOST_CHECK(parallel::find(policy, values.begin(), values.begin(), 1000) == values.begin());
+        BOOST_CHECK(parallel::find(policy, values.begin(), values.begin() + 4999, 1000) == values.begin() + 4999);
+    };
+
+    check_policy(parallel::par);
+    for (std::size_t n_threads : {1, 3, 8}) {
+        check_policy(parallel::par.with(parallel::threads(n_threads), parallel::grain(1)));
+        check_policy(parallel::par.with(parallel::threads(n_threads), parallel::dynamic_chunking));
+    }
+
+    BOOST_CHECK(parallel::find(parallel::seq, values.begin(), values.end(), 1001) ==
+                std::find(values.begin(), values.end(), 1001));
+
+    // early exit: the slices run one after the other on the inline executor,
+    // the ones scheduled after a match stop without scanning their part
+    auto inline_policy = parallel::par_on(std::make_shared<inline_executor>()).with(parallel::threads(4));
+    std::vector<int> big(10 * n, 0);
+    big[100] = 1;
+
+    std::atomic<std::size_t> n_calls(0);
+    auto counted_is_one = [&n_calls](int v) {
+        n_calls++;
+        return v == 1;
+    };
+
+    BOOST_CHECK(parallel::any_of(inline_policy, big.begin(), big.end(), counted_is_one));
+    BOOST_CHECK_LT(n_calls.load(), big.size() / 10);
+
+    n_calls = 0;
+    BOOST_CHECK(parallel::find_if(inline_policy, big.begin(), big.end(), counted_is_one) == big.begin() + 100);
+    BOOST_CHECK_LT(n_calls.load(), big.size() / 10);
+
+    n_calls = 0;
+    BOOST_CHECK(!parallel::none_of(inline_policy, big.begin(), big.end(), counted_is_one));
+    BOOST_CHECK(!parallel::all_of(inline_policy, big.begin(), big.end(), [](int v) { return v == 0; }));
+    BOOST_CHECK_LT(n_calls.load(), big.size() / 10);
+}
+
+
 BOOST_AUTO_TEST_CASE(parallel_sort) {
 
     using namespace hadoken;
@@ -546,6 +874,12 @@ BOOST_AUTO_TEST_CASE(parallel_sort) {
         BOOST_CHECK(is_ordered(v2) == true);
     }
 
+    {
+        auto v4 = values;
+        parallel::stable_sort(parallel::par, v4.begin(), v4.end());
+        BOOST_CHECK(is_ordered(v4) == true);
+    }
+
     {
 
         auto v3 = values;
@@ -565,6 +899,289 @@ BOOST_AUTO_TEST_CASE(parallel_sort) {
 
 
 
+// counts the live instances: the buffers of the algorithms construct and destroy every element
+struct counted {
+    static std::atomic<long>& live() {
+        static std::atomic<long> instances(0);
+        return instances;
+    }
+
+    counted(int v = 0) : value(v) { ++live(); }
+    counted(const counted& other) : value(other.value) { ++live(); }
+    counted& operator=(const counted& other) = default;
+    ~counted() { --live(); }
+
+    bool operator<(const counted& other) const { return value < other.value; }
+
+    int value;
+};
+
+
+BOOST_AUTO_TEST_CASE(parallel_sort_policies) {
+
+    using namespace hadoken;
+
+    std::mt19937_64 mt;
+    std::uniform_int_distribution<int> dist(0, 1000);
+
+    // key with many duplicates, payload to check the stability
+    using record = std::pair<int, std::size_t>;
+    auto key_less = [](const record& r1, const record& r2) { return r1.first < r2.first; };
+
+    for (std::size_t n : {0, 1, 100, 12345}) {
+        std::vector<record> values(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            values[i] = record(dist(mt), i);
+        }
+
+        std::vector<record> ref = values;
+        std::stable_sort(ref.begin(), ref.end(), key_less);
+
+        for (std::size_t n_threads : {2, 3, 8}) {
+            auto policy = parallel::par.with(parallel::threads(n_threads), parallel::grain(1));
+
+            auto v1 = values;
+            parallel::stable_sort(policy, v1.begin(), v1.end(), key_less);
+            BOOST_CHECK(v1 == ref);
+
+            auto v2 = values;
+            parallel::sort(policy, v2.begin(), v2.end(), key_less);
+            BOOST_CHECK(std::is_sorted(v2.begin(), v2.end(), key_less));
+
+            std::sort(v2.begin(), v2.end());
+            auto v3 = values;
+            std::sort(v3.begin(), v3.end());
+            BOOST_CHECK(v2 == v3);
+        }
+    }
+
+    // move only values
+    {
+        std::vector<std::unique_ptr<int>> ptrs;
+        for (int i = 0; i < 1000; ++i) {
+            ptrs.emplace_back(new int(dist(mt)));
+        }
+
+        parallel::sort(parallel::par.with(parallel::threads(4)), ptrs.begin(), ptrs.end(),
+                       [](const std::unique_ptr<int>& p1, const std::unique_ptr<int>& p2) { return *p1 < *p2; });
+        BOOST_CHECK(std::is_sorted(ptrs.begin(), ptrs.end(),
+                                   [](const std::unique_ptr<int>& p1, const std::unique_ptr<int>& p2) { return *p1 < *p2; }));
+    }
+
+    // the merge buffer constructs and destroys every element
+    {
+        std::vector<counted> values;
+        for (int i = 0; i < 10000; ++i) {
+            values.emplace_back(dist(mt));
+        }
+        const long live = counted::live();
+
+        parallel::stable_sort(parallel::par.with(parallel::threads(3), parallel::grain(1)), values.begin(), values.end());
+        BOOST_CHECK(std::is_sorted(values.begin(), values.end()));
+        BOOST_CHECK_EQUAL(counted::live(), live);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(parallel_merge_select) {
+
+    using namespace hadoken;
+
+    std::mt19937_64 mt;
+
+    using record = std::pair<int, std::size_t>;
+    auto key_less = [](const record& r1, const record& r2) { return r1.first < r2.first; };
+
+    for (std::size_t n : {0, 1, 2, 100, 12345}) {
+        // small key range: many duplicates for the stability and the selection on equal values
+        for (int max_key : {3, 1000000}) {
+            std::uniform_int_distribution<int> dist(0, max_key);
+
+            std::vector<record> left(n), right(n / 3 + 1);
+            for (std::size_t i = 0; i < left.size(); ++i) {
+                left[i] = record(dist(mt), i);
+            }
+            for (std::size_t i = 0; i < right.size(); ++i) {
+                right[i] = record(dist(mt), n + i);
+            }
+            std::stable_sort(left.begin(), left.end(), key_less);
+            std::stable_sort(right.begin(), right.end(), key_less);
+
+            std::vector<record> ref(left.size() + right.size());
+            std::merge(left.begin(), left.end(), right.begin(), right.end(), ref.begin(), key_less);
+
+            std::vector<record> values(left);
+            values.insert(values.end(), right.begin(), right.end());
+
+            for (std::size_t n_threads : {1, 2, 3, 8}) {
+                auto policy = parallel::par.with(parallel::threads(n_threads), parallel::grain(1));
+
+                std::vector<record> merged(ref.size());
+                auto merged_end =
+                    parallel::merge(policy, left.begin(), left.end(), right.begin(), right.end(), merged.begin(), key_less);
+                BOOST_CHECK(merged_end == merged.end());
+                BOOST_CHECK(merged == ref);
+
+                auto inplace = values;
+                parallel::inplace_merge(policy, inplace.begin(), inplace.begin() + std::ptrdiff_t(left.size()), inplace.end(),
+                                        key_less);
+                BOOST_CHECK(inplace == ref);
+
+                std::vector<record> sorted(values);
+                std::sort(sorted.begin(), sorted.end());
+
+                for (std::size_t k : {std::size_t(0), values.size() / 100, values.size() / 2, values.size() - 1}) {
+                    auto selected = values;
+                    parallel::nth_element(policy, selected.begin(), selected.begin() + std::ptrdiff_t(k), selected.end());
+                    BOOST_CHECK(selected[k] == sorted[k]);
+                    BOOST_CHECK(std::all_of(selected.begin(), selected.begin() + std::ptrdiff_t(k),
+                                            [&](const record& r) { return !(selected[k] < r); }));
+                    BOOST_CHECK(std::all_of(selected.begin() + std::ptrdiff_t(k), selected.end(),
+                                            [&](const record& r) { return !(r < selected[k]); }));
+
+                    auto partial = values;
+                    parallel::partial_sort(policy, partial.begin(), partial.begin() + std::ptrdiff_t(k), partial.end());
+                    BOOST_CHECK(std::equal(partial.begin(), partial.begin() + std::ptrdiff_t(k), sorted.begin()));
+                    std::sort(partial.begin(), partial.end());
+                    BOOST_CHECK(partial == sorted);
+                }
+            }
+        }
+    }
+
+    // sequential policy and non random access iterators
+    {
+        std::list<int> l1 = {1, 3, 5}, l2 = {2, 4};
+        std::vector<int> merged(5);
+        parallel::merge(parallel::par, l1.begin(), l1.end(), l2.begin(), l2.end(), merged.begin());
+        BOOST_CHECK(std::is_sorted(merged.begin(), merged.end()));
+
+        std::vector<int> values = {5, 1, 4, 2, 3};
+        parallel::partial_sort(parallel::seq, values.begin(), values.begin() + 2, values.end());
+        BOOST_CHECK(values[0] == 1 && values[1] == 2);
+    }
+
+    // move only values
+    {
+        std::vector<std::unique_ptr<int>> ptrs;
+        for (int i = 0; i < 1000; ++i) {
+            ptrs.emplace_back(new int(int(mt() % 100)));
+        }
+        auto ptr_less = [](const std::unique_ptr<int>& p1, const std::unique_ptr<int>& p2) { return *p1 < *p2; };
+
+        auto policy = parallel::par.with(parallel::threads(4), parallel::grain(1));
+        parallel::nth_element(policy, ptrs.begin(), ptrs.begin() + 500, ptrs.end(), ptr_less);
+        BOOST_CHECK(std::none_of(ptrs.begin(), ptrs.begin() + 500,
+                                 [&](const std::unique_ptr<int>& p) { return ptr_less(ptrs[500], p); }));
+
+        parallel::sort(policy, ptrs.begin(), ptrs.begin() + 500, ptr_less);
+        parallel::sort(policy, ptrs.begin() + 500, ptrs.end(), ptr_less);
+        parallel::inplace_merge(policy, ptrs.begin(), ptrs.begin() + 500, ptrs.end(), ptr_less);
+        BOOST_CHECK(std::is_sorted(ptrs.begin(), ptrs.end(), ptr_less));
+    }
+
+    // the merge buffer constructs and destroys every element
+    {
+        std::vector<counted> values;
+        for (int i = 0; i < 10000; ++i) {
+            values.emplace_back(int(mt() % 1000));
+        }
+        std::sort(values.begin(), values.begin() + 3000);
+        std::sort(values.begin() + 3000, values.end());
+        const long live = counted::live();
+
+        parallel::inplace_merge(parallel::par.with(parallel::threads(3), parallel::grain(1)), values.begin(),
+                                values.begin() + 3000, values.end());
+        BOOST_CHECK(std::is_sorted(values.begin(), values.end()));
+        BOOST_CHECK_EQUAL(counted::live(), live);
+    }
+}
+
+
+template <typename Key, typename Distribution>
+void check_radix_sort(Distribution dist, std::size_t n) {
+    using namespace hadoken;
+
+    std::mt19937_64 mt(n);
+    std::vector<Key> values(n);
+    std::generate(values.begin(), values.end(), [&]() { return Key(dist(mt)); });
+
+    std::vector<Key> ref = values;
+    std::sort(ref.begin(), ref.end());
+
+    auto v1 = values;
+    parallel::radix_sort(parallel::seq, v1.begin(), v1.end());
+    BOOST_CHECK(v1 == ref);
+
+    auto v2 = values;
+    parallel::radix_sort(parallel::par.with(parallel::threads(3), parallel::grain(1)), v2.begin(), v2.end());
+    BOOST_CHECK(v2 == ref);
+}
+
+
+BOOST_AUTO_TEST_CASE(parallel_radix_sort) {
+
+    using namespace hadoken;
+
+    for (std::size_t n : {0, 1, 17, 10000}) {
+        check_radix_sort<std::uint32_t>(std::uniform_int_distribution<std::uint32_t>(), n);
+        check_radix_sort<std::uint64_t>(std::uniform_int_distribution<std::uint64_t>(), n);
+        check_radix_sort<std::uint64_t>(std::uniform_int_distribution<std::uint64_t>(0, 100), n);
+        check_radix_sort<std::int32_t>(std::uniform_int_distribution<std::int32_t>(-100000, 100000), n);
+        check_radix_sort<std::int64_t>(std::uniform_int_distribution<std::int64_t>(), n);
+        check_radix_sort<std::int8_t>(std::uniform_int_distribution<int>(-128, 127), n);
+        check_radix_sort<float>(std::uniform_real_distribution<float>(-1000, 1000), n);
+        check_radix_sort<double>(std::normal_distribution<double>(0, 1e10), n);
+    }
+
+    // special floating point values
+    {
+        std::vector<double> values = {0.0, -0.0, std::numeric_limits<double>::infinity(), -1.5,
+                                      -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::denorm_min(), 1.5,
+                                      -std::numeric_limits<double>::max()};
+        parallel::radix_sort(parallel::par, values.begin(), values.end());
+        BOOST_CHECK(std::is_sorted(values.begin(), values.end()));
+        BOOST_CHECK_EQUAL(values.front(), -std::numeric_limits<double>::infinity());
+        BOOST_CHECK_EQUAL(values.back(), std::numeric_limits<double>::infinity());
+    }
+
+    // key extractor, radix sort is stable
+    {
+        using record = std::pair<std::int16_t, std::size_t>;
+        std::mt19937 mt;
+        std::uniform_int_distribution<int> dist(-50, 50);
+
+        std::vector<record> values(20000);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            values[i] = record(std::int16_t(dist(mt)), i);
+        }
+
+        auto ref = values;
+        std::stable_sort(ref.begin(), ref.end(), [](const record& r1, const record& r2) { return r1.first < r2.first; });
+
+        parallel::radix_sort(parallel::par.with(parallel::threads(4)), values.begin(), values.end(),
+                             [](const record& r) { return r.first; });
+        BOOST_CHECK(values == ref);
+    }
+
+    // the radix buffer constructs and destroys every element, also when the first passes are skipped
+    for (int max_key : {255, 1 << 20}) {
+        std::mt19937 mt;
+        std::uniform_int_distribution<int> dist(0, max_key);
+        std::vector<counted> values;
+        for (int i = 0; i < 10000; ++i) {
+            values.emplace_back(dist(mt) << 8);
+        }
+        const long live = counted::live();
+
+        parallel::radix_sort(parallel::par.with(parallel::threads(3), parallel::grain(1)), values.begin(), values.end(),
+                             [](const counted& c) { return std::uint32_t(c.value); });
+        BOOST_CHECK(std::is_sorted(values.begin(), values.end()));
+        BOOST_CHECK_EQUAL(counted::live(), live);
+    }
+}
+
+
 BOOST_AUTO_TEST_CASE(parallel_inclusive_scan) {
 
     using namespace hadoken;
@@ -618,3 +1235,503 @@ BOOST_AUTO_TEST_CASE(parallel_inclusive_scan) {
         res = v1[i];
     }
 }
+
+
+namespace {
+
+// affine function composition: associative, not commutative
+struct affine {
+    std::uint64_t a, b;
+
+    bool operator==(const affine& other) const { return a == other.a && b == other.b; }
+};
+
+struct affine_compose {
+    affine operator()(const affine& f, const affine& g) const { return affine{(f.a * g.a) % 1000003, (f.b * g.a + g.b) % 1000003}; }
+};
+
+} // namespace
+
+
+BOOST_AUTO_TEST_CASE(parallel_scan_variants) {
+
+    using namespace hadoken;
+
+    for (std::size_t n : {0, 1, 5, 1000, 100003}) {
+        std::vector<std::uint64_t> values(n);
+        std::iota(values.begin(), values.end(), 1);
+
+        std::vector<affine> functions(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            functions[i] = affine{i % 7 + 1, i % 13};
+        }
+
+        // serial references
+        std::vector<std::uint64_t> inclusive_ref(n), exclusive_ref(n), transform_ref(n);
+        std::uint64_t acc = 10;
+        for (std::size_t i = 0; i < n; ++i) {
+            exclusive_ref[i] = acc;
+            acc += values[i];
+            inclusive_ref[i] = acc - 10;
+        }
+        acc = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            acc += values[i] * values[i];
+            transform_ref[i] = acc;
+        }
+
+        std::vector<affine> compose_ref(functions);
+        std::partial_sum(functions.begin(), functions.end(), compose_ref.begin(), affine_compose());
+
+        auto square = [](std::uint64_t v) { return v * v; };
+
+        for (std::size_t n_threads : {1, 3, 8}) {
+            auto policy = parallel::par.with(parallel::threads(n_threads), parallel::grain(1));
+
+            std::vector<std::uint64_t> res(n);
+
+            BOOST_CHECK(parallel::inclusive_scan(policy, values.begin(), values.end(), res.begin()) == res.end());
+            BOOST_CHECK(res == inclusive_ref);
+
+            parallel::inclusive_scan(policy, values.begin(), values.end(), res.begin(), std::plus<std::uint64_t>(),
+                                     std::uint64_t(10));
+            for (std::size_t i = 0; i < n; ++i) {
+                BOOST_CHECK_EQUAL(res[i], inclusive_ref[i] + 10);
+            }
+
+            BOOST_CHECK(parallel::exclusive_scan(policy, values.begin(), values.end(), res.begin(), std::uint64_t(10)) ==
+                        res.end());
+            BOOST_CHECK(res == exclusive_ref);
+
+            parallel::transform_inclusive_scan(policy, values.begin(), values.end(), res.begin(), std::plus<std::uint64_t>(),
+                                               square);
+            BOOST_CHECK(res == transform_ref);
+
+            parallel::transform_exclusive_scan(policy, values.begin(), values.end(), res.begin(), std::uint64_t(0),
+                                               std::plus<std::uint64_t>(), square);
+            for (std::size_t i = 1; i < n; ++i) {
+                BOOST_CHECK_EQUAL(res[i], transform_ref[i - 1]);
+            }
+
+            // non commutative operation
+            std::vector<affine> compose_res(n);
+            parallel::inclusive_scan(policy, functions.begin(), functions.end(), compose_res.begin(), affine_compose());
+            BOOST_CHECK(compose_res == compose_ref);
+
+            // in place
+            res = values;
+            parallel::inclusive_scan(policy, res.begin(), res.end(), res.begin());
+            BOOST_CHECK(res == inclusive_ref);
+
+            res = values;
+            parallel::exclusive_scan(policy, res.begin(), res.end(), res.begin(), std::uint64_t(10));
+            BOOST_CHECK(res == exclusive_ref);
+        }
+    }
+
+    // an exception in a tile is rethrown, the tiles after it do not wait for its prefix
+    const std::size_t n = 100003;
+    std::vector<std::uint64_t> values(n), res(n);
+    std::iota(values.begin(), values.end(), 1);
+
+    for (std::uint64_t bad_value : {std::uint64_t(1), std::uint64_t(n / 2), std::uint64_t(n)}) {
+        auto throwing_plus = [bad_value](std::uint64_t a, std::uint64_t b) {
+            if (b == bad_value) {
+                throw std::runtime_error("scan error");
+            }
+            return a + b;
+        };
+        auto throwing_proj = [bad_value](std::uint64_t v) {
+            if (v == bad_value) {
+                throw std::runtime_error("projection error");
+            }
+            return v;
+        };
+
+        for (std::size_t n_threads : {1, 3, 8}) {
+            auto policy = parallel::par.with(parallel::threads(n_threads), parallel::grain(1));
+
+            BOOST_CHECK_THROW(parallel::inclusive_scan(policy, values.begin(), values.end(), res.begin(), throwing_plus,
+                                                       std::uint64_t(0)),
+                              std::runtime_error);
+            BOOST_CHECK_THROW(parallel::exclusive_scan(policy, values.begin(), values.end(), res.begin(), std::uint64_t(0),
+                                                       throwing_plus),
+                              std::runtime_error);
+            BOOST_CHECK_THROW(parallel::transform_inclusive_scan(policy, values.begin(), values.end(), res.begin(),
+                                                                 std::plus<std::uint64_t>(), throwing_proj),
+                              std::runtime_error);
+        }
+    }
+}
+
+
+
+template <typename Policy>
+void check_reduce(const Policy& policy, std::size_t n) {
+    std::vector<std::int64_t> values(n), others(n);
+    std::iota(values.begin(), values.end(), -std::int64_t(n / 2));
+    for (std::size_t i = 0; i < n; ++i) {
+        others[i] = std::int64_t(i % 11) - 5;
+    }
+
+    const std::int64_t sum_ref = std::accumulate(values.begin(), values.end(), std::int64_t(42));
+    const std::int64_t dot_ref = std::inner_product(values.begin(), values.end(), others.begin(), std::int64_t(0));
+
+    BOOST_CHECK_EQUAL(parallel::reduce(policy, values.begin(), values.end()), sum_ref - 42);
+    BOOST_CHECK_EQUAL(parallel::reduce(policy, values.begin(), values.end(), std::int64_t(42)), sum_ref);
+
+    std::int64_t max_ref = std::numeric_limits<std::int64_t>::min();
+    for (auto v : values) {
+        max_ref = std::max(max_ref, v * v);
+    }
+
+    BOOST_CHECK_EQUAL(parallel::reduce(policy, others.begin(), others.end(), std::numeric_limits<std::int64_t>::min(),
+                                       [](std::int64_t a, std::int64_t b) { return std::max(a, b); }),
+                      (n > 0) ? std::int64_t(std::min<std::size_t>(n - 1, 10)) - 5 : std::numeric_limits<std::int64_t>::min());
+
+    BOOST_CHECK_EQUAL(parallel::transform_reduce(policy, values.begin(), values.end(), others.begin(), std::int64_t(0)),
+                      dot_ref);
+
+    BOOST_CHECK_EQUAL(parallel::transform_reduce(policy, values.begin(), values.end(), others.begin(), std::int64_t(7),
+                                                 std::plus<std::int64_t>(),
+                                                 [](std::int64_t a, std::int64_t b) { return a - b; }),
+                      7 + (sum_ref - 42) - std::accumulate(others.begin(), others.end(), std::int64_t(0)));
+
+    BOOST_CHECK_EQUAL(parallel::transform_reduce(policy, values.begin(), values.end(), std::numeric_limits<std::int64_t>::min(),
+                                                 [](std::int64_t a, std::int64_t b) { return std::max(a, b); },
+                                                 [](std::int64_t v) { return v * v; }),
+                      max_ref);
+
+    // floating point, the order of the operations is unspecified
+    std::vector<double> reals(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        reals[i] = 1.0 / double(i + 1);
+    }
+    const double real_ref = std::accumulate(reals.begin(), reals.end(), 1.0);
+    BOOST_CHECK_CLOSE(parallel::reduce(policy, reals.begin(), reals.end(), 1.0), real_ref, 1e-9);
+}
+
+
+BOOST_AUTO_TEST_CASE(parallel_reduce) {
+
+    using namespace hadoken;
+
+    for (std::size_t n : {0, 1, 7, 100, 1031, 100003}) {
+        check_reduce(parallel::seq, n);
+        check_reduce(parallel::par, n);
+        check_reduce(parallel::par_vec, n);
+
+        for (std::size_t n_threads : {1, 3, 8}) {
+            check_reduce(parallel::par.with(parallel::threads(n_threads), parallel::grain(1)), n);
+            check_reduce(parallel::par_vec.with(parallel::threads(n_threads), parallel::grain(1)), n);
+            check_reduce(
+                parallel::par_vec.with(parallel::threads(n_threads), parallel::grain(16), parallel::dynamic_chunking), n);
+            check_reduce(parallel::par.with(parallel::threads(n_threads), parallel::guided_chunking), n);
+        }
+    }
+}
+
+
+
+// 12 bytes, does not divide the alignment of the vector loops
+struct point3f {
+    float x, y, z;
+};
+
+template <typename Policy>
+void check_vector_policy(const Policy& policy) {
+    static_assert(parallel::detail::__is_contiguous_iterator<std::vector<float>::iterator>::value, "vector iterator");
+    static_assert(parallel::detail::__is_contiguous_iterator<const double*>::value, "pointer");
+    static_assert(!parallel::detail::__is_contiguous_iterator<std::vector<bool>::iterator>::value, "vector<bool>");
+    static_assert(!parallel::detail::__is_contiguous_iterator<std::deque<float>::iterator>::value, "deque iterator");
+
+    // sizes around the width of a chunk, offsets around the alignment
+    for (std::size_t n : {0, 1, 15, 16, 17, 33, 1000, 10007}) {
+        for (std::size_t offset : {0, 1, 3}) {
+            std::vector<float> buffer(n + offset, -1.0f), out_buffer(n + offset, -1.0f);
+            const auto first = buffer.begin() + offset, last = buffer.end();
+            const auto d_first = out_buffer.begin() + offset;
+
+            parallel::fill(policy, first, last, 2);
+            BOOST_CHECK_EQUAL(std::count(buffer.begin(), buffer.end(), 2.0f), std::ptrdiff_t(n));
+            BOOST_CHECK_EQUAL(std::count(buffer.begin(), buffer.end(), -1.0f), std::ptrdiff_t(offset));
+
+            float* raw = buffer.data() + offset;
+            parallel::for_each(policy, raw, raw + n, [](float& v) { v += 1.0f; });
+            BOOST_CHECK_EQUAL(std::count(buffer.begin(), buffer.end(), 3.0f), std::ptrdiff_t(n));
+
+            std::iota(first, last, 0.0f);
+            BOOST_CHECK_EQUAL(parallel::count_if(policy, first, last, [](float v) { return int(v) % 3 == 0; }),
+                              std::ptrdiff_t((n + 2) / 3));
+
+            BOOST_CHECK(parallel::transform(policy, first, last, d_first, [](float v) { return v * 2.0f; }) ==
+                        out_buffer.end());
+            BOOST_CHECK(parallel::transform(policy, first, last, d_first, d_first,
+                                            [](float a, float b) { return a + b; }) == out_buffer.end());
+            BOOST_CHECK(parallel::transform(policy, first, last, first, d_first, [](float a, float b) { return a * b; }) ==
+                        out_buffer.end());
+            for (std::size_t i = 0; i < n; ++i) {
+                BOOST_CHECK_EQUAL(out_buffer[offset + i], float(i * i));
+            }
+
+            // in place
+            parallel::transform(policy, first, last, first, [](float v) { return v + 1.0f; });
+            parallel::transform(policy, first, last, first, first, [](float a, float b) { return a + b; });
+            for (std::size_t i = 0; i < n; ++i) {
+                BOOST_CHECK_EQUAL(buffer[offset + i], float(2 * (i + 1)));
+            }
+            if (offset > 0) {
+                BOOST_CHECK_EQUAL(out_buffer[0], -1.0f);
+            }
+        }
+    }
+
+    // non contiguous iterators take the generic path
+    std::deque<int> values(1000);
+    parallel::fill(policy, values.begin(), values.end(), 4);
+    parallel::for_each(policy, values.begin(), values.end(), [](int& v) { v *= 2; });
+    BOOST_CHECK_EQUAL(parallel::count_if(policy, values.begin(), values.end(), [](int v) { return v == 8; }), 1000);
+
+    // elements of a size not dividing the chunk take the generic path
+    static_assert(!parallel::detail::__use_simd<Policy, std::vector<point3f>::iterator>::value, "non arithmetic");
+    static_assert(parallel::detail::__use_simd<Policy, std::vector<float>::iterator>::value, "arithmetic");
+
+    for (std::size_t offset : {0, 1, 5}) {
+        std::vector<point3f> points(1000 + offset);
+        parallel::fill(policy, points.begin() + offset, points.end(), point3f{1.0f, 2.0f, 3.0f});
+        parallel::for_each(policy, points.begin() + offset, points.end(), [](point3f& p) { p.x += p.y + p.z; });
+        BOOST_CHECK_EQUAL(std::count_if(points.begin(), points.end(), [](const point3f& p) { return p.x == 6.0f; }),
+                          1000);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(parallel_vector_policies) {
+
+    using namespace hadoken;
+
+    check_vector_policy(parallel::par_vec);
+    check_vector_policy(parallel::unseq);
+    check_vector_policy(parallel::par_vec.with(parallel::threads(3), parallel::grain(1)));
+    check_vector_policy(parallel::par_vec.with(parallel::threads(4), parallel::grain(8), parallel::dynamic_chunking));
+
+    BOOST_CHECK(parallel::detail::is_vector_policy<decltype(parallel::unseq)>::value);
+    BOOST_CHECK(!parallel::detail::is_parallel_policy(parallel::unseq));
+    BOOST_CHECK(!parallel::detail::is_vector_policy<decltype(parallel::par)>::value);
+}
+
+
+
+template <typename Policy>
+void check_for_index(const Policy& policy) {
+    using namespace hadoken;
+
+    const std::size_t nx = 7, ny = 13, nz = 29;
+
+    std::vector<parallel::tile_shape> tiles = {parallel::tile_shape(1, 1, 1), parallel::tile_shape(3, 5, 7),
+                                               parallel::tile_shape(100, 100, 100), parallel::cache_tile({nx, ny, nz}, 4, 256)};
+
+    for (const parallel::tile_shape& tile : tiles) {
+        std::vector<std::atomic<int>> visits(nx * ny * nz);
+        parallel::for_index(policy, parallel::extents{nx, ny, nz}, tile,
+                            [&](std::size_t i, std::size_t j, std::size_t k) { visits[(i * ny + j) * nz + k] += 1; });
+        BOOST_CHECK(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& v) { return v.load() == 1; }));
+    }
+
+    std::vector<std::atomic<int>> visits(nx * nz);
+    parallel::for_index(policy, parallel::extents{nx, nz}, [&](std::size_t i, std::size_t j) { visits[i * nz + j] += 1; });
+    BOOST_CHECK(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& v) { return v.load() == 1; }));
+
+    std::vector<double> values(100003, 0);
+    parallel::for_index(policy, parallel::extents{values.size()}, [&](std::size_t i) { values[i] = double(i); });
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        BOOST_CHECK_EQUAL(values[i], double(i));
+    }
+
+    int calls = 0;
+    parallel::for_index(policy, parallel::extents{nx, 0, nz}, [&](std::size_t, std::size_t, std::size_t) { ++calls; });
+    BOOST_CHECK_EQUAL(calls, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(parallel_for_index) {
+
+    using namespace hadoken;
+
+    check_for_index(parallel::seq);
+    check_for_index(parallel::par);
+    check_for_index(parallel::par_vec);
+    check_for_index(parallel::unseq);
+
+    for (std::size_t n_threads : {1, 3, 8}) {
+        check_for_index(parallel::par.with(parallel::threads(n_threads), parallel::grain(1)));
+        check_for_index(parallel::par.with(parallel::threads(n_threads), parallel::grain(1), parallel::dynamic_chunking));
+    }
+
+    // the arity of the function has to match the rank of the space
+    BOOST_CHECK_THROW(parallel::for_index(parallel::par, parallel::extents{4, 4}, [](std::size_t) {}), std::invalid_argument);
+
+    // cache sized tiles, the contiguous dimension first
+    const parallel::tile_shape tile = parallel::cache_tile(parallel::extents{512, 512, 512}, 8, 1 << 20);
+    BOOST_CHECK_EQUAL(tile.rank(), 3);
+    BOOST_CHECK_EQUAL(tile[2], 512);
+    BOOST_CHECK(tile.size() * 8 <= (1 << 19));
+    BOOST_CHECK(tile.size() * 8 * 2 > (1 << 19));
+
+    const parallel::tile_shape row_tile = parallel::cache_tile(parallel::extents{4, 1000000}, 8, 1 << 20);
+    BOOST_CHECK(row_tile[0] == 1 && row_tile[1] == (1 << 16));
+
+    // parallel ublas for_each, in storage order
+    ublas::matrix<double> row_matrix(37, 53);
+    ublas::matrix<double, ublas::column_major> column_matrix(37, 53);
+    for (std::size_t i = 0; i < row_matrix.size1(); ++i) {
+        for (std::size_t j = 0; j < row_matrix.size2(); ++j) {
+            row_matrix(i, j) = column_matrix(i, j) = double(i * 100 + j);
+        }
+    }
+
+    auto twice = [](double& v) { v *= 2; };
+    ublas::for_each(parallel::par.with(parallel::grain(1)), row_matrix, twice);
+    ublas::for_each(parallel::par_vec.with(parallel::grain(1)), column_matrix, twice);
+    for (std::size_t i = 0; i < row_matrix.size1(); ++i) {
+        for (std::size_t j = 0; j < row_matrix.size2(); ++j) {
+            BOOST_CHECK_EQUAL(row_matrix(i, j), double(2 * (i * 100 + j)));
+            BOOST_CHECK_EQUAL(column_matrix(i, j), double(2 * (i * 100 + j)));
+        }
+    }
+}
+
+
+template <typename Policy>
+void check_compaction(const Policy& policy, std::size_t n) {
+    std::mt19937 rng(n);
+    std::vector<int> values(n);
+    for (auto& v : values) {
+        v = int(rng() % 16);
+    }
+
+    auto is_odd = [](int v) { return v % 2 != 0; };
+
+    // copy, move, copy_if
+    std::vector<int> res(n, -1), ref(n, -1);
+    BOOST_CHECK(parallel::copy(policy, values.begin(), values.end(), res.begin()) == res.end());
+    BOOST_CHECK(res == values);
+
+    std::fill(res.begin(), res.end(), -1);
+    BOOST_CHECK(parallel::copy_n(policy, values.begin(), n / 2, res.begin()) == res.begin() + n / 2);
+    BOOST_CHECK(std::equal(res.begin(), res.begin() + n / 2, values.begin()));
+    BOOST_CHECK(std::count(res.begin(), res.end(), -1) == std::ptrdiff_t(n - n / 2));
+
+    auto res_end = parallel::copy_if(policy, values.begin(), values.end(), res.begin(), is_odd);
+    auto ref_end = std::copy_if(values.begin(), values.end(), ref.begin(), is_odd);
+    BOOST_CHECK_EQUAL(res_end - res.begin(), ref_end - ref.begin());
+    BOOST_CHECK(std::equal(res.begin(), res_end, ref.begin()));
+
+    std::vector<int> back;
+    parallel::copy_if(policy, values.begin(), values.end(), std::back_inserter(back), is_odd);
+    BOOST_CHECK(std::equal(back.begin(), back.end(), ref.begin()) && back.size() == std::size_t(ref_end - ref.begin()));
+
+    // replace
+    res = values;
+    ref = values;
+    parallel::replace(policy, res.begin(), res.end(), 3, 42);
+    std::replace(ref.begin(), ref.end(), 3, 42);
+    BOOST_CHECK(res == ref);
+    parallel::replace_if(policy, res.begin(), res.end(), is_odd, 7);
+    std::replace_if(ref.begin(), ref.end(), is_odd, 7);
+    BOOST_CHECK(res == ref);
+
+    // remove, remove_if
+    res = values;
+    ref = values;
+    res_end = parallel::remove_if(policy, res.begin(), res.end(), is_odd);
+    ref_end = std::remove_if(ref.begin(), ref.end(), is_odd);
+    BOOST_CHECK_EQUAL(res_end - res.begin(), ref_end - ref.begin());
+    BOOST_CHECK(std::equal(res.begin(), res_end, ref.begin()));
+
+    res = values;
+    ref = values;
+    res_end = parallel::remove(policy, res.begin(), res.end(), 4);
+    ref_end = std::remove(ref.begin(), ref.end(), 4);
+    BOOST_CHECK(std::equal(res.begin(), res_end, ref.begin()) && (res_end - res.begin()) == (ref_end - ref.begin()));
+
+    // partitions, the parallel partition is stable
+    res = values;
+    ref = values;
+    res_end = parallel::stable_partition(policy, res.begin(), res.end(), is_odd);
+    ref_end = std::stable_partition(ref.begin(), ref.end(), is_odd);
+    BOOST_CHECK(res == ref && (res_end - res.begin()) == (ref_end - ref.begin()));
+
+    res = values;
+    res_end = parallel::partition(policy, res.begin(), res.end(), is_odd);
+    BOOST_CHECK(std::is_partitioned(res.begin(), res.end(), is_odd));
+    BOOST_CHECK(std::find_if_not(res.begin(), res.end(), is_odd) == res_end);
+    BOOST_CHECK(std::is_permutation(res.begin(), res.end(), values.begin()));
+
+    std::vector<int> odds(n, -1), evens(n, -1), ref_odds(n, -1), ref_evens(n, -1);
+    auto split = parallel::partition_copy(policy, values.begin(), values.end(), odds.begin(), evens.begin(), is_odd);
+    auto ref_split = std::partition_copy(values.begin(), values.end(), ref_odds.begin(), ref_evens.begin(), is_odd);
+    BOOST_CHECK(odds == ref_odds && evens == ref_evens);
+    BOOST_CHECK(split.first - odds.begin() == ref_split.first - ref_odds.begin());
+    BOOST_CHECK(split.second - evens.begin() == ref_split.second - ref_evens.begin());
+
+    // unique, unique_copy
+    std::vector<int> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+
+    std::fill(res.begin(), res.end(), -1);
+    std::fill(ref.begin(), ref.end(), -1);
+    res_end = parallel::unique_copy(policy, sorted.begin(), sorted.end(), res.begin());
+    ref_end = std::unique_copy(sorted.begin(), sorted.end(), ref.begin());
+    BOOST_CHECK(res == ref && (res_end - res.begin()) == (ref_end - ref.begin()));
+
+    auto same_parity = [](int a, int b) { return (a % 2) == (b % 2); };
+    res = values;
+    ref = values;
+    res_end = parallel::unique(policy, res.begin(), res.end(), same_parity);
+    ref_end = std::unique(ref.begin(), ref.end(), same_parity);
+    BOOST_CHECK(std::equal(res.begin(), res_end, ref.begin()) && (res_end - res.begin()) == (ref_end - ref.begin()));
+
+    // move only and non trivial types
+    std::vector<std::unique_ptr<int>> pointers;
+    std::vector<std::string> strings;
+    for (auto v : sorted) {
+        pointers.emplace_back(new int(v));
+        strings.push_back(std::to_string(v) + " and a string long enough to allocate");
+    }
+
+    auto pointers_end = parallel::unique(policy, pointers.begin(), pointers.end(),
+                                         [](const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) { return *a == *b; });
+    const std::size_t n_unique = std::size_t(std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+    BOOST_CHECK_EQUAL(std::size_t(pointers_end - pointers.begin()), n_unique);
+    for (std::size_t i = 0; i < n_unique; ++i) {
+        BOOST_CHECK_EQUAL(*pointers[i], sorted[i]);
+    }
+
+    std::vector<std::string> moved(n);
+    parallel::move(policy, strings.begin(), strings.end(), moved.begin());
+    auto strings_end = parallel::partition(policy, moved.begin(), moved.end(),
+                                           [](const std::string& s) { return (s[0] - '0') % 2 == 0; });
+    BOOST_CHECK(std::all_of(moved.begin(), strings_end, [](const std::string& s) { return (s[0] - '0') % 2 == 0; }));
+    BOOST_CHECK(std::none_of(strings_end, moved.end(), [](const std::string& s) { return (s[0] - '0') % 2 == 0; }));
+}
+
+
+BOOST_AUTO_TEST_CASE(parallel_compaction) {
+
+    using namespace hadoken;
+
+    for (std::size_t n : {0, 1, 2, 17, 1000, 100003}) {
+        check_compaction(parallel::seq, n);
+        check_compaction(parallel::par, n);
+
+        for (std::size_t n_threads : {1, 3, 8}) {
+            check_compaction(parallel::par.with(parallel::threads(n_threads), parallel::grain(1)), n);
+        }
+    }
+
+    // non random access iterators take the sequential path
+    std::list<int> values = {1, 1, 2, 3, 3, 3, 4};
+    auto values_end = parallel::unique(parallel::par, values.begin(), values.end());
+    BOOST_CHECK_EQUAL(std::distance(values.begin(), values_end), 4);
+}
@@ -30,6 +30,7 @@
 #define BOOST_TEST_MODULE containerTests
 #define BOOST_TEST_MAIN
 
+#include <array>
 #include <functional>
 #include <future>
 #include <iostream>
@@ -38,11 +39,26 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <hadoken/containers/concurrent_ring_queue.hpp>
+#include <hadoken/executor/numa_thread_pool_executor.hpp>
+#include <hadoken/executor/priority_thread_pool_executor.hpp>
 #include <hadoken/executor/simple_thread_executor.hpp>
+#include <hadoken/executor/system_executor.hpp>
+#include <hadoken/executor/task_graph.hpp>
+#include <hadoken/executor/timer_service.hpp>
 #include <hadoken/executor/thread_pool_executor.hpp>
+#include <hadoken/executor/unique_task.hpp>
+#include <hadoken/thread/eventcount.hpp>
+#include <hadoken/thread/future.hpp>
+#include <hadoken/thread/future_helpers.hpp>
 #include <hadoken/thread/latch.hpp>
 #include <hadoken/thread/spinlock.hpp>
+#include <hadoken/executor/inline_executor.hpp>
 #include <hadoken/executor/multiplexer_executor.hpp>
+#include <hadoken/os/topology.hpp>
+#include <hadoken/parallel/algorithm.hpp>
+
+#include <sched.h>
 
 
 BOOST_AUTO_TEST_CASE(spin_lock_simple_test) {
@@ -138,6 +154,943 @@ BOOST_AUTO_TEST_CASE(executor_pool_thread_wait) {
 }
 
 
+BOOST_AUTO_TEST_CASE(executor_pool_thread_wait_completion) {
+    const std::size_t iterations = 64;
+    std::atomic<std::size_t> counter(0);
+
+    hadoken::thread_pool_executor exec_thread(4);
+
+    // nothing submitted
+    exec_thread.wait();
+    BOOST_CHECK(exec_thread.wait_for(std::chrono::milliseconds(1)));
+
+    for (std::size_t i = 0; i < iterations; ++i) {
+        exec_thread.execute([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+            // submitted from a task, still part of the work to wait for
+            exec_thread.execute([&]() { counter += 1; });
+        });
+    }
+
+    // wait() returns only once the tasks finished running, not once they are dequeued
+    exec_thread.wait();
+    BOOST_CHECK_EQUAL(counter.load(), iterations);
+    BOOST_CHECK_EQUAL(exec_thread.in_flight(), 0);
+
+    std::atomic<bool> release(false);
+    exec_thread.execute([&]() {
+        while (release.load() == false) {
+            std::this_thread::yield();
+        }
+    });
+
+    BOOST_CHECK(exec_thread.wait_for(std::chrono::milliseconds(10)) == false);
+    BOOST_CHECK_EQUAL(exec_thread.in_flight(), 1);
+
+    release.store(true);
+    BOOST_CHECK(exec_thread.wait_for(std::chrono::seconds(60)));
+}
+
+
+BOOST_AUTO_TEST_CASE(executor_pool_thread_ring_queue) {
+    using ring_pool_executor = hadoken::basic_thread_pool_executor<hadoken::concurrent_ring_queue<hadoken::unique_task, 64>>;
+
+    const std::size_t iterations = 1024;
+    std::atomic<std::size_t> counter(0);
+
+    hadoken::thread::latch done(iterations);
+
+    {
+        ring_pool_executor exec_thread(4);
+
+        for (std::size_t i = 0; i < iterations; ++i) {
+            exec_thread.execute([&]() {
+                counter += 1;
+                done.count_down();
+            });
+        }
+
+        auto f = exec_thread.twoway_execute([]() { return 42; });
+        BOOST_CHECK_EQUAL(f.get(), 42);
+
+        done.wait();
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), iterations);
+}
+
+
+BOOST_AUTO_TEST_CASE(executor_pool_thread_work_stealing) {
+    const std::size_t n_root = 64, n_child = 64;
+    std::atomic<std::size_t> counter(0);
+
+    hadoken::thread::latch done(n_root * n_child);
+
+    {
+        hadoken::thread_pool_executor exec_thread(8, hadoken::thread_pool_executor::scheduling::work_stealing);
+
+        BOOST_CHECK(exec_thread.get_scheduling() == hadoken::thread_pool_executor::scheduling::work_stealing);
+
+        // tasks submitted from the workers go to the local queues and get stolen
+        for (std::size_t i = 0; i < n_root; ++i) {
+            exec_thread.execute([&]() {
+                for (std::size_t j = 0; j < n_child; ++j) {
+                    exec_thread.execute([&]() {
+                        counter += 1;
+                        done.count_down();
+                    });
+                }
+            });
+        }
+
+        done.wait();
+
+        // the recycled task slots release the state captured by the executed tasks
+        auto token = std::make_shared<int>(0);
+        for (std::size_t i = 0; i < n_root; ++i) {
+            exec_thread.execute([&exec_thread, token]() {
+                for (std::size_t j = 0; j < n_child; ++j) {
+                    exec_thread.execute([token]() { (void)token; });
+                }
+            });
+        }
+        exec_thread.wait();
+        BOOST_CHECK_EQUAL(token.use_count(), 1);
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), n_root * n_child);
+}
+
+
+BOOST_AUTO_TEST_CASE(unique_task_test) {
+    int value = 0;
+
+    // small callable, stored inline
+    auto small_fun = [&value]() { value += 1; };
+    BOOST_CHECK(hadoken::unique_task::is_inline<decltype(small_fun)>::value);
+
+    hadoken::unique_task t1(small_fun);
+    BOOST_CHECK(static_cast<bool>(t1));
+    t1();
+    BOOST_CHECK_EQUAL(value, 1);
+
+    // move only callable
+    struct move_only_fun {
+        int* value;
+        std::unique_ptr<int> p;
+        void operator()() { *value = *p + 1; }
+    };
+    hadoken::unique_task t2(move_only_fun{&value, std::unique_ptr<int>(new int(41))});
+    hadoken::unique_task t3(std::move(t2));
+    BOOST_CHECK(!t2);
+    t3();
+    BOOST_CHECK_EQUAL(value, 42);
+
+    // large callable, stored on the heap
+    std::array<std::size_t, 32> large_capture;
+    large_capture.fill(2);
+    auto large_fun = [&value, large_capture]() {
+        value = 0;
+        for (auto v : large_capture) {
+            value += int(v);
+        }
+    };
+    BOOST_CHECK(!hadoken::unique_task::is_inline<decltype(large_fun)>::value);
+
+    hadoken::unique_task t4(large_fun);
+    t1 = std::move(t4);
+    t1();
+    BOOST_CHECK_EQUAL(value, 64);
+
+    t1.reset();
+    BOOST_CHECK(!t1);
+}
+
+
+BOOST_AUTO_TEST_CASE(future_promise_test) {
+    {
+        hadoken::promise<std::string> prom;
+        hadoken::future<std::string> fut = prom.get_future();
+        BOOST_CHECK(fut.valid());
+        BOOST_CHECK(!fut.is_ready());
+
+        std::thread setter([&prom]() { prom.set_value("hello"); });
+        BOOST_CHECK_EQUAL(fut.get(), "hello");
+        BOOST_CHECK(!fut.valid());
+        setter.join();
+    }
+
+    {
+        hadoken::future<void> broken;
+        {
+            hadoken::promise<void> prom;
+            broken = prom.get_future();
+        }
+        BOOST_CHECK(broken.is_ready());
+        BOOST_CHECK_THROW(broken.get(), std::future_error);
+    }
+
+    {
+        // a task dropped without being run, by an executor at shutdown or a full queue, breaks its promise
+        bool continued = false;
+        hadoken::future<int> dropped_then;
+        {
+            auto task = hadoken::make_task([]() { return 42; });
+            dropped_then = task.first.then([&continued](hadoken::future<int> f) {
+                continued = true;
+                return f.get();
+            });
+            hadoken::unique_task queued(std::move(task.second));
+        }
+        BOOST_CHECK(continued);
+        BOOST_CHECK(dropped_then.is_ready());
+        BOOST_CHECK_THROW(dropped_then.get(), std::future_error);
+
+        // a task run then destroyed keeps its value
+        auto task = hadoken::make_task([]() { return 42; });
+        auto result = std::move(task.first);
+        {
+            auto runner = std::move(task.second);
+            runner();
+        }
+        BOOST_CHECK_EQUAL(result.get(), 42);
+    }
+
+    {
+        auto ready = hadoken::make_ready_future(12);
+        BOOST_CHECK(ready.is_ready());
+        BOOST_CHECK_EQUAL(ready.get(), 12);
+    }
+
+    {
+        hadoken::thread_pool_executor exec_thread(4);
+
+        auto f_value = exec_thread.twoway_execute([]() { return std::string("result"); });
+        auto f_except = exec_thread.twoway_execute([]() -> int { throw std::runtime_error("task error"); });
+
+        // nested twoway executions run inline
+        auto f_nested = exec_thread.twoway_execute([&exec_thread]() {
+            auto f = exec_thread.twoway_execute([]() { return 21; });
+            return f.get() * 2;
+        });
+
+        BOOST_CHECK_EQUAL(f_value.get(), "result");
+        BOOST_CHECK_THROW(f_except.get(), std::runtime_error);
+        BOOST_CHECK_EQUAL(f_nested.get(), 42);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(future_continuation_test) {
+    hadoken::thread_pool_executor exec_thread(4);
+
+    {
+        // continuation registered before the completion runs in the completing thread
+        hadoken::promise<int> prom;
+        std::thread::id continuation_thread;
+        auto f = prom.get_future().then([&continuation_thread](hadoken::future<int> v) {
+            continuation_thread = std::this_thread::get_id();
+            return std::to_string(v.get() * 2);
+        });
+        BOOST_CHECK(!f.is_ready());
+
+        std::thread setter([&prom]() { prom.set_value(21); });
+        const std::thread::id setter_id = setter.get_id();
+        setter.join();
+
+        BOOST_CHECK(f.is_ready());
+        BOOST_CHECK_EQUAL(f.get(), "42");
+        BOOST_CHECK(continuation_thread == setter_id);
+
+        // already ready: runs immediately, invalid future
+        auto g = hadoken::make_ready_future(1).then([](hadoken::future<int> v) { v.get(); });
+        BOOST_CHECK(g.is_ready());
+        auto h = g.then([](hadoken::future<void>) {});
+        BOOST_CHECK(!g.valid());
+        BOOST_CHECK_THROW(g.then([](hadoken::future<void>) {}), std::future_error);
+        h.get();
+    }
+
+    {
+        // chain on the pool, exceptions are forwarded
+        auto chain = exec_thread.twoway_execute([]() { return 1; })
+                         .then(exec_thread, [&exec_thread](hadoken::future<int> v) {
+                             BOOST_CHECK(exec_thread.running_in_this_thread());
+                             return v.get() + 1;
+                         })
+                         .then(exec_thread,
+                               [](hadoken::future<int> v) -> int { throw std::runtime_error(std::to_string(v.get())); })
+                         .then(exec_thread, [](hadoken::future<int> v) {
+                             try {
+                                 return v.get();
+                             } catch (std::runtime_error& e) {
+                                 return std::stoi(e.what()) * 10;
+                             }
+                         });
+        BOOST_CHECK_EQUAL(chain.get(), 20);
+
+        // many continuations in flight, the pool threads never block
+        std::vector<hadoken::future<std::size_t>> results;
+        for (std::size_t i = 0; i < 1000; ++i) {
+            auto f = exec_thread.twoway_execute([i]() { return i; });
+            results.push_back(f.then(exec_thread, [](hadoken::future<std::size_t> v) { return v.get() * 2; }));
+        }
+
+        // when_all on a range
+        auto all = hadoken::when_all(results.begin(), results.end());
+        std::vector<hadoken::future<std::size_t>> done = all.get();
+        BOOST_CHECK_EQUAL(done.size(), 1000);
+        std::size_t sum = 0;
+        for (auto& f : done) {
+            BOOST_CHECK(f.is_ready());
+            sum += f.get();
+        }
+        BOOST_CHECK_EQUAL(sum, 999 * 1000);
+    }
+
+    {
+        // when_all on a tuple, joined by a continuation instead of a blocking get
+        auto a = exec_thread.twoway_execute([]() { return 2; });
+        auto b = exec_thread.twoway_execute([]() { return std::string("x"); });
+        auto joined = hadoken::when_all(std::move(a), std::move(b))
+                          .then([](hadoken::future<std::tuple<hadoken::future<int>, hadoken::future<std::string>>> t) {
+                              auto values = t.get();
+                              return std::string(std::size_t(std::get<0>(values).get()), std::get<1>(values).get()[0]);
+                          });
+        BOOST_CHECK_EQUAL(joined.get(), "xx");
+
+        BOOST_CHECK(hadoken::when_all().is_ready());
+        std::vector<hadoken::future<int>> none;
+        BOOST_CHECK(hadoken::when_all(none.begin(), none.end()).get().empty());
+    }
+
+    {
+        // when_any: the first ready future, the others stay usable
+        hadoken::promise<int> slow;
+        std::vector<hadoken::future<int>> inputs;
+        inputs.push_back(slow.get_future());
+        inputs.push_back(exec_thread.twoway_execute([]() { return 7; }));
+
+        auto any = hadoken::when_any(inputs.begin(), inputs.end()).get();
+        BOOST_CHECK_EQUAL(any.index, 1);
+        BOOST_CHECK_EQUAL(any.futures[1].get(), 7);
+        BOOST_CHECK(!any.futures[0].is_ready());
+
+        auto late = any.futures[0].then([](hadoken::future<int> v) { return v.get() + 1; });
+        slow.set_value(1);
+        BOOST_CHECK_EQUAL(late.get(), 2);
+
+        hadoken::promise<void> never;
+        auto any_tuple = hadoken::when_any(never.get_future(), hadoken::make_ready_future(std::string("now"))).get();
+        BOOST_CHECK_EQUAL(any_tuple.index, 1);
+        BOOST_CHECK_EQUAL(std::get<1>(any_tuple.futures).get(), "now");
+
+        std::vector<hadoken::future<int>> none;
+        BOOST_CHECK_EQUAL(hadoken::when_any(none.begin(), none.end()).get().index, std::size_t(-1));
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(executor_bulk_execute_test) {
+    const std::size_t n = 10000;
+
+    {
+        hadoken::thread_pool_executor exec_thread(4);
+
+        std::vector<int> values(n, 0);
+        auto f = exec_thread.bulk_execute(n, [&values](std::size_t i) { values[i] += int(i); });
+        f.get();
+
+        for (std::size_t i = 0; i < n; ++i) {
+            BOOST_CHECK_EQUAL(values[i], int(i));
+        }
+
+        // empty bulk is ready immediately
+        auto f_empty = exec_thread.bulk_execute(0, [](std::size_t) {});
+        BOOST_CHECK(f_empty.is_ready());
+
+        // first exception is propagated, all the indices are executed
+        std::atomic<std::size_t> counter(0);
+        auto f_except = exec_thread.bulk_execute(n, [&counter](std::size_t i) {
+            counter += 1;
+            if (i % 1000 == 0) {
+                throw std::runtime_error("bulk error");
+            }
+        });
+        BOOST_CHECK_THROW(f_except.get(), std::runtime_error);
+        BOOST_CHECK_EQUAL(counter.load(), n);
+
+        // nested bulk execution from inside the pool
+        std::atomic<std::size_t> nested_counter(0);
+        exec_thread
+            .bulk_execute(16,
+                          [&](std::size_t) {
+                              exec_thread.bulk_execute(16, [&](std::size_t) { nested_counter += 1; }).get();
+                          })
+            .get();
+        BOOST_CHECK_EQUAL(nested_counter.load(), 16 * 16);
+    }
+
+    {
+        hadoken::thread_pool_executor exec_thread(4, hadoken::thread_pool_executor::scheduling::work_stealing);
+
+        std::atomic<std::size_t> counter(0);
+        exec_thread
+            .bulk_execute(64, [&](std::size_t) { exec_thread.bulk_execute(64, [&](std::size_t) { counter += 1; }).get(); })
+            .get();
+        BOOST_CHECK_EQUAL(counter.load(), 64 * 64);
+    }
+
+    {
+        hadoken::system_executor sys_exec;
+
+        std::atomic<std::size_t> sum(0);
+        sys_exec.bulk_execute(n, [&sum](std::size_t i) { sum += i; }).get();
+        BOOST_CHECK_EQUAL(sum.load(), n * (n - 1) / 2);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(executor_bulk_sync_execute_test) {
+    hadoken::thread_pool_executor exec_thread(1);
+
+    // keep the only worker busy: the caller has to execute the whole batch
+    std::atomic<bool> release(false);
+    exec_thread.execute([&release]() {
+        while (release.load() == false) {
+            std::this_thread::yield();
+        }
+    });
+
+    const std::thread::id caller_id = std::this_thread::get_id();
+    std::atomic<std::size_t> on_caller(0);
+
+    exec_thread.bulk_sync_execute(100, [&](std::size_t) {
+        if (std::this_thread::get_id() == caller_id) {
+            on_caller += 1;
+        }
+    });
+    BOOST_CHECK_EQUAL(on_caller.load(), 100);
+
+    release.store(true);
+
+    // nested synchronous batches from the workers
+    std::atomic<std::size_t> counter(0);
+    exec_thread.bulk_sync_execute(8, [&](std::size_t) { exec_thread.bulk_sync_execute(8, [&](std::size_t) { counter += 1; }); });
+    BOOST_CHECK_EQUAL(counter.load(), 64);
+
+    BOOST_CHECK_THROW(exec_thread.bulk_sync_execute(8, [](std::size_t) { throw std::runtime_error("bulk error"); }),
+                      std::runtime_error);
+}
+
+
+// number of cpus the calling thread can run on
+static std::size_t current_affinity_size() {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+        return 0;
+    }
+    return std::size_t(CPU_COUNT(&cpu_set));
+}
+
+
+BOOST_AUTO_TEST_CASE(numa_topology_test) {
+    const std::vector<hadoken::numa_node> nodes = hadoken::get_numa_nodes();
+    BOOST_REQUIRE(nodes.empty() == false);
+
+    std::vector<std::size_t> all_cpus;
+    for (const hadoken::numa_node& node : nodes) {
+        BOOST_CHECK(node.cpus.empty() == false);
+        all_cpus.insert(all_cpus.end(), node.cpus.begin(), node.cpus.end());
+    }
+
+    // a cpu belongs to a single node
+    std::sort(all_cpus.begin(), all_cpus.end());
+    BOOST_CHECK(std::adjacent_find(all_cpus.begin(), all_cpus.end()) == all_cpus.end());
+
+    BOOST_CHECK(hadoken::set_current_thread_affinity(std::vector<std::size_t>()) == false);
+
+    std::thread pinned([&]() {
+        if (hadoken::set_current_thread_affinity({all_cpus.front()})) {
+            BOOST_CHECK_EQUAL(current_affinity_size(), 1);
+            BOOST_CHECK_EQUAL(std::size_t(sched_getcpu()), all_cpus.front());
+        }
+    });
+    pinned.join();
+}
+
+
+BOOST_AUTO_TEST_CASE(executor_pool_thread_affinity) {
+    using pool = hadoken::thread_pool_executor;
+
+    const std::vector<hadoken::numa_node> nodes = hadoken::get_numa_nodes();
+    const std::size_t first_cpu = nodes.front().cpus.front();
+
+    bool pinning_supported = false;
+    std::thread probe([&]() { pinning_supported = hadoken::set_current_thread_affinity({first_cpu}); });
+    probe.join();
+
+    for (pool::affinity placement : {pool::affinity::cpu, pool::affinity::numa_node}) {
+        pool exec_thread(2, pool::scheduling::shared_queue, placement, {first_cpu});
+        BOOST_CHECK_EQUAL(exec_thread.size(), 2);
+        BOOST_CHECK(exec_thread.running_in_this_thread() == false);
+
+        std::atomic<std::size_t> affinity_size(0);
+        std::atomic<bool> inside(false);
+        exec_thread.bulk_execute(2, [&](std::size_t) {
+                       affinity_size.store(current_affinity_size());
+                       inside.store(exec_thread.running_in_this_thread());
+                   })
+            .get();
+
+        BOOST_CHECK(inside.load());
+        if (pinning_supported) {
+            BOOST_CHECK_EQUAL(affinity_size.load(), 1);
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(executor_numa_pool_test) {
+    const std::vector<hadoken::numa_node> nodes = hadoken::get_numa_nodes();
+    const std::size_t first_cpu = nodes.front().cpus.front();
+
+    // two shards on the same cpu, any machine
+    hadoken::numa_thread_pool_executor exec_thread({hadoken::numa_node{0, {first_cpu}}, hadoken::numa_node{1, {first_cpu}}},
+                                                   hadoken::numa_thread_pool_executor::scheduling::shared_queue,
+                                                   hadoken::numa_thread_pool_executor::affinity::cpu, 2);
+    BOOST_CHECK_EQUAL(exec_thread.shards(), 2);
+    BOOST_CHECK_EQUAL(exec_thread.size(), 4);
+    BOOST_CHECK_EQUAL(exec_thread.node(1).id, 1);
+    BOOST_CHECK_EQUAL(exec_thread.current_shard(), 2);
+
+    // contiguous range of indices per shard
+    const std::size_t n = 1000;
+    std::vector<std::size_t> shard_of(n, 42);
+    exec_thread.bulk_sync_execute(n, [&](std::size_t i) { shard_of[i] = exec_thread.current_shard(); });
+    BOOST_CHECK(std::count(shard_of.begin(), shard_of.begin() + n / 2, 0) == n / 2);
+    BOOST_CHECK(std::count(shard_of.begin() + n / 2, shard_of.end(), 1) == n / 2);
+
+    // nested execution from a worker, exceptions
+    std::atomic<std::size_t> counter(0);
+    exec_thread.bulk_sync_execute(8, [&](std::size_t) {
+        exec_thread.bulk_sync_execute(8, [&](std::size_t) { counter += 1; });
+    });
+    BOOST_CHECK_EQUAL(counter.load(), 64);
+
+    BOOST_CHECK_THROW(exec_thread.bulk_sync_execute(8, [](std::size_t i) {
+        if (i == 7) {
+            throw std::runtime_error("bulk error");
+        }
+    }),
+                      std::runtime_error);
+
+    exec_thread.twoway_execute([&]() { counter += 1; }).get();
+    exec_thread.execute([&]() { counter += 1; });
+    exec_thread.wait();
+    BOOST_CHECK_EQUAL(counter.load(), 66);
+
+    // parallel algorithms, the same slice of the range runs on the same shard at each call
+    auto pool_ptr = std::make_shared<hadoken::numa_thread_pool_executor>(
+        std::vector<hadoken::numa_node>{hadoken::numa_node{0, {first_cpu}}, hadoken::numa_node{1, {first_cpu}}});
+    auto policy = hadoken::parallel::par_on(pool_ptr).with(hadoken::parallel::grain(1));
+
+    std::vector<std::size_t> values(n, 0), fill_shard(n), for_each_shard(n);
+    hadoken::parallel::fill(policy.with(hadoken::parallel::dynamic_chunking), values.begin(), values.end(), 1);
+    BOOST_CHECK(std::count(values.begin(), values.end(), 1) == n);
+
+    hadoken::parallel::for_range(policy, values.begin(), values.end(),
+                                 [&](std::vector<std::size_t>::iterator b, std::vector<std::size_t>::iterator e) {
+                                     for (; b != e; ++b) {
+                                         fill_shard[std::size_t(b - values.begin())] = pool_ptr->current_shard();
+                                     }
+                                 });
+    hadoken::parallel::for_each(policy, values.begin(), values.end(), [&](std::size_t& v) {
+        for_each_shard[std::size_t(&v - values.data())] = pool_ptr->current_shard();
+    });
+    BOOST_CHECK(fill_shard == for_each_shard);
+    BOOST_CHECK(std::count(fill_shard.begin(), fill_shard.end(), 0) == n / 2);
+}
+
+
+BOOST_AUTO_TEST_CASE(executor_priority_pool_test) {
+    using pool = hadoken::priority_thread_pool_executor;
+
+    // one worker, blocked while the lanes fill up
+    pool exec_thread(1, 3, std::chrono::seconds(10));
+    BOOST_CHECK_EQUAL(exec_thread.lanes(), 3);
+    BOOST_CHECK(exec_thread.has_deadline_lane());
+
+    hadoken::promise<void> release;
+    hadoken::future<void> released = release.get_future();
+    exec_thread.twoway_execute(0, [&released]() { released.wait(); });
+    while (exec_thread.status(0).executed != 1) {
+        std::this_thread::yield();
+    }
+
+    std::mutex order_lock;
+    std::vector<std::string> order;
+    auto record = [&order, &order_lock](std::string name) {
+        return [&order, &order_lock, name]() {
+            std::lock_guard<std::mutex> _l(order_lock);
+            order.push_back(name);
+        };
+    };
+
+    for (int i = 0; i < 3; ++i) {
+        exec_thread.execute(record("low"));
+    }
+    exec_thread.execute(1, record("mid"));
+    exec_thread.execute(0, record("high"));
+
+    const auto now = pool::clock::now();
+    exec_thread.execute_before(now + std::chrono::seconds(2), record("deadline_2"));
+    exec_thread.execute_before(now + std::chrono::seconds(1), record("deadline_1"));
+    auto deadline_result = exec_thread.twoway_execute_before(now + std::chrono::seconds(3), []() { return 3; });
+
+    // occupancy of the lanes
+    BOOST_CHECK_EQUAL(exec_thread.status(0).queued, 1);
+    BOOST_CHECK_EQUAL(exec_thread.status(1).queued, 1);
+    BOOST_CHECK_EQUAL(exec_thread.status(2).queued, 3);
+    BOOST_CHECK_EQUAL(exec_thread.deadline_status().queued, 3);
+    BOOST_CHECK(exec_thread.status(2).oldest_wait.count() > 0);
+    BOOST_CHECK_EQUAL(exec_thread.in_flight(), 9);
+
+    release.set_value();
+    BOOST_CHECK_EQUAL(deadline_result.get(), 3);
+    exec_thread.wait();
+
+    const std::vector<std::string> expected = {"deadline_1", "deadline_2", "high", "mid", "low", "low", "low"};
+    BOOST_CHECK(order == expected);
+    BOOST_CHECK_EQUAL(exec_thread.status(0).executed, 2);
+    BOOST_CHECK_EQUAL(exec_thread.status(2).executed, 3);
+    BOOST_CHECK_EQUAL(exec_thread.status(2).queued, 0);
+    BOOST_CHECK_EQUAL(exec_thread.status(2).oldest_wait.count(), 0);
+    BOOST_CHECK_EQUAL(exec_thread.deadline_status().executed, 3);
+
+    BOOST_CHECK_THROW(exec_thread.execute(3, []() {}), std::out_of_range);
+
+    // aging: background tasks waiting for many periods come before new high priority tasks
+    pool aging_pool(1, 2, std::chrono::milliseconds(1), false);
+    BOOST_CHECK_THROW(aging_pool.execute_before(pool::clock::now(), []() {}), std::logic_error);
+
+    hadoken::promise<void> aging_release;
+    hadoken::future<void> aging_released = aging_release.get_future();
+    aging_pool.execute(0, [&aging_released]() { aging_released.wait(); });
+    while (aging_pool.status(0).executed != 1) {
+        std::this_thread::yield();
+    }
+
+    order.clear();
+    aging_pool.execute(record("background"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    aging_pool.execute(0, record("urgent"));
+
+    aging_release.set_value();
+    aging_pool.wait();
+    BOOST_CHECK(order == std::vector<std::string>({"background", "urgent"}));
+
+    // deadline lane at scale: the oldest task has the latest deadline and stays queued until the end
+    pool deadline_pool(1, 1);
+    hadoken::promise<void> deadline_release;
+    hadoken::future<void> deadline_released = deadline_release.get_future();
+    deadline_pool.execute([&deadline_released]() { deadline_released.wait(); });
+    while (deadline_pool.status(0).executed != 1) {
+        std::this_thread::yield();
+    }
+
+    const std::size_t n_deadlines = 50000;
+    const auto deadline_origin = pool::clock::now() + std::chrono::hours(1);
+    std::vector<std::size_t> deadline_order;
+    deadline_order.reserve(n_deadlines);
+    for (std::size_t i = 0; i < n_deadlines; ++i) {
+        deadline_pool.execute_before(deadline_origin - std::chrono::seconds(i),
+                                     [&deadline_order, i]() { deadline_order.push_back(i); });
+    }
+    BOOST_CHECK_EQUAL(deadline_pool.deadline_status().queued, n_deadlines);
+    BOOST_CHECK(deadline_pool.deadline_status().oldest_wait.count() > 0);
+
+    deadline_release.set_value();
+    deadline_pool.wait();
+    BOOST_CHECK_EQUAL(deadline_order.size(), n_deadlines);
+    BOOST_CHECK(std::is_sorted(deadline_order.rbegin(), deadline_order.rend()));
+    BOOST_CHECK_EQUAL(deadline_pool.deadline_status().executed, n_deadlines);
+    BOOST_CHECK_EQUAL(deadline_pool.deadline_status().oldest_wait.count(), 0);
+
+    // many tasks from many lanes, submitted from inside and outside of the pool
+    pool exec_many(4, 4, std::chrono::milliseconds(1));
+    std::atomic<std::size_t> counter(0);
+    for (std::size_t i = 0; i < 1000; ++i) {
+        exec_many.execute(i % 4, [&exec_many, &counter, i]() {
+            exec_many.execute((i + 1) % 4, [&counter]() { counter += 1; });
+            counter += 1;
+        });
+    }
+    auto nested = exec_many.twoway_execute(0, [&exec_many]() { return exec_many.twoway_execute(1, []() { return 2; }).get(); });
+    BOOST_CHECK_EQUAL(nested.get(), 2);
+    exec_many.wait();
+    BOOST_CHECK_EQUAL(counter.load(), 2000);
+
+    // same completion interface as thread_pool_executor
+    std::atomic<bool> blocked(true);
+    std::atomic<std::size_t> completed(0);
+    {
+        pool exec_flags(1, 2);
+        BOOST_CHECK(exec_flags.wait_for(std::chrono::milliseconds(1)));
+        BOOST_CHECK(exec_flags.get_flag(pool::flags::complete_all_before_delete) == false);
+        exec_flags.set_flags(pool::flags::complete_all_before_delete, true);
+        BOOST_CHECK(exec_flags.get_flag(pool::flags::complete_all_before_delete));
+
+        exec_flags.execute(0, [&blocked, &completed]() {
+            while (blocked.load()) {
+                std::this_thread::yield();
+            }
+            completed += 1;
+        });
+        exec_flags.execute(1, [&completed]() { completed += 1; });
+
+        BOOST_CHECK(exec_flags.wait_for(std::chrono::milliseconds(10)) == false);
+        BOOST_CHECK_EQUAL(exec_flags.in_flight(), 2);
+        blocked.store(false);
+    }
+    BOOST_CHECK_EQUAL(completed.load(), 2);
+}
+
+
+BOOST_AUTO_TEST_CASE(timer_wheel_test) {
+    // expiration order and cascades through all the levels, without thread
+    hadoken::details::timer_wheel wheel;
+    const std::vector<std::uint64_t> expiries = {1, 2, 255, 256, 257, 65535, 65536, 70000, 1 << 24, (1ull << 32) + 5};
+
+    std::vector<hadoken::details::timer_node*> nodes;
+    for (std::uint64_t expiry : expiries) {
+        auto* node = new hadoken::details::timer_node([]() {}, 0);
+        node->expiry = expiry;
+        node->add_ref();
+        nodes.push_back(node);
+        wheel.insert(node);
+    }
+    BOOST_CHECK_EQUAL(wheel.size(), expiries.size());
+    BOOST_CHECK_EQUAL(wheel.next_tick(), 1);
+
+    // cancelled timers are dropped, never expired
+    nodes[3]->cancel();
+
+    std::vector<hadoken::details::timer_node*> due;
+    std::vector<std::uint64_t> expired_at;
+    while (wheel.size() > 0) {
+        const std::uint64_t tick = wheel.next_tick();
+        BOOST_REQUIRE(tick != hadoken::details::timer_wheel::no_tick);
+        wheel.advance(tick, due);
+        for (auto* node : due) {
+            BOOST_CHECK_EQUAL(node->expiry, wheel.now());
+            expired_at.push_back(wheel.now());
+            node->release();
+        }
+        due.clear();
+    }
+
+    std::vector<std::uint64_t> expected = expiries;
+    expected.erase(expected.begin() + 3);
+    BOOST_CHECK(expired_at == expected);
+
+    for (auto* node : nodes) {
+        node->release();
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(timer_service_test) {
+    using clock = std::chrono::steady_clock;
+
+    hadoken::thread_pool_executor exec_thread(2);
+    hadoken::timer_service timers(exec_thread);
+    BOOST_CHECK(timers.resolution() == std::chrono::milliseconds(1));
+
+    // one-shot timers, in deadline order, never early
+    std::mutex order_lock;
+    std::vector<int> order;
+    hadoken::promise<void> last_done;
+    auto last_fired = last_done.get_future();
+
+    const auto start = clock::now();
+    std::atomic<bool> early(false);
+    for (int i = 3; i >= 1; --i) {
+        timers.execute_after(std::chrono::milliseconds(10 * i), [&, i]() {
+            if (clock::now() < start + std::chrono::milliseconds(10 * i)) {
+                early = true;
+            }
+            std::lock_guard<std::mutex> _l(order_lock);
+            order.push_back(i);
+        });
+    }
+    timers.execute_at(start + std::chrono::milliseconds(40), [&last_done]() { last_done.set_value(); });
+
+    // cancellation
+    std::atomic<int> cancelled_runs(0);
+    auto cancelled = timers.execute_after(std::chrono::milliseconds(20), [&cancelled_runs]() { cancelled_runs += 1; });
+    BOOST_CHECK(cancelled.active());
+    BOOST_CHECK(cancelled.cancel());
+    BOOST_CHECK(!cancelled.active());
+    BOOST_CHECK(!cancelled.cancel());
+
+    last_fired.get();
+    BOOST_CHECK(order == std::vector<int>({1, 2, 3}));
+    BOOST_CHECK(!early);
+    BOOST_CHECK_EQUAL(cancelled_runs.load(), 0);
+
+    // deadline in the past: executed at once
+    hadoken::promise<void> past_done;
+    auto past_fired = past_done.get_future();
+    auto past_timer = timers.execute_at(start - std::chrono::seconds(1), [&past_done]() { past_done.set_value(); });
+    past_fired.get();
+    BOOST_CHECK(!past_timer.active());
+    BOOST_CHECK(!past_timer.cancel());
+
+    // periodic timer, cancelled from its own execution
+    std::atomic<int> periodic_runs(0);
+    hadoken::promise<void> periodic_done;
+    auto periodic_fired = periodic_done.get_future();
+    hadoken::timer_handle periodic;
+    std::mutex periodic_lock;
+    {
+        std::lock_guard<std::mutex> _l(periodic_lock);
+        periodic = timers.execute_periodic(std::chrono::milliseconds(2), [&]() {
+            if (++periodic_runs == 5) {
+                std::lock_guard<std::mutex> _l2(periodic_lock);
+                BOOST_CHECK(periodic.cancel());
+                periodic_done.set_value();
+            }
+        });
+    }
+    periodic_fired.get();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    BOOST_CHECK_EQUAL(periodic_runs.load(), 5);
+    BOOST_CHECK(!periodic.active());
+
+    // many timers, half of them cancelled
+    const std::size_t n = 100000;
+    std::atomic<std::size_t> fired(0);
+    std::vector<hadoken::timer_handle> handles;
+    handles.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        handles.push_back(timers.execute_after(std::chrono::microseconds(i % 50000), [&fired]() { fired += 1; }));
+    }
+    std::size_t n_cancelled = 0;
+    for (std::size_t i = 0; i < n; i += 2) {
+        n_cancelled += handles[i].cancel() ? 1 : 0;
+    }
+
+    while (timers.pending() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    exec_thread.wait();
+    BOOST_CHECK_EQUAL(fired.load() + n_cancelled, n);
+
+    // timers left at destruction are cancelled
+    hadoken::timer_handle never;
+    {
+        hadoken::timer_service short_lived(exec_thread, std::chrono::microseconds(100));
+        never = short_lived.execute_after(std::chrono::hours(1), []() { BOOST_ERROR("timer executed"); });
+        short_lived.execute_periodic(std::chrono::milliseconds(1), []() {});
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK(!never.active());
+}
+
+
+BOOST_AUTO_TEST_CASE(task_graph_test) {
+    hadoken::thread_pool_executor exec_thread(4);
+
+    // diamond a -> (b, c) -> d, followed by a chain of 16 nodes
+    std::atomic<int> step_a(0), step_b(0), step_c(0), step_d(0);
+    std::atomic<int> clock(0);
+    std::vector<int> chain(16, 0);
+    bool ordered = true;
+
+    hadoken::task_graph graph;
+    BOOST_CHECK(graph.empty());
+
+    const auto a = graph.emplace([&]() { step_a = ++clock; });
+    const auto b = graph.emplace([&]() { step_b = ++clock; });
+    const auto c = graph.emplace([&]() { step_c = ++clock; });
+    const auto d = graph.emplace([&]() {
+        step_d = ++clock;
+        ordered = ordered && step_a < step_b && step_a < step_c && step_b < step_d && step_c < step_d;
+    });
+    graph.precede(a, b);
+    graph.precede(a, c);
+    graph.precede(b, d);
+    graph.precede(c, d);
+
+    auto previous = d;
+    for (std::size_t i = 0; i < chain.size(); ++i) {
+        const auto next = graph.emplace([&chain, i]() { chain[i] = (i == 0) ? 1 : chain[i - 1] + 1; });
+        graph.precede(previous, next);
+        previous = next;
+    }
+
+    BOOST_CHECK_EQUAL(graph.size(), 20);
+    BOOST_CHECK_EQUAL(graph.successors(a), 2);
+    BOOST_CHECK_EQUAL(graph.predecessors(d), 2);
+    BOOST_CHECK_THROW(graph.precede(a, 42), std::out_of_range);
+
+    // same graph, many runs
+    for (int run = 0; run < 200; ++run) {
+        std::fill(chain.begin(), chain.end(), 0);
+        graph.run(exec_thread).get();
+        BOOST_CHECK_EQUAL(chain.back(), 16);
+    }
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_EQUAL(clock.load(), 200 * 4);
+
+    // runs in the calling thread with an inline executor
+    hadoken::inline_executor exec_inline;
+    auto res = graph.run(exec_inline);
+    BOOST_CHECK(res.is_ready());
+    res.get();
+
+    // an exception skips the remaining nodes and is propagated, the graph stays usable
+    std::atomic<int> after_error(0);
+    hadoken::task_graph failing;
+    const auto first = failing.emplace([]() { throw std::runtime_error("node error"); });
+    const auto second = failing.emplace([&]() { after_error += 1; });
+    const auto independent = failing.emplace([]() {});
+    failing.precede(first, second);
+    failing.precede(independent, second);
+
+    BOOST_CHECK_THROW(failing.run(exec_thread).get(), std::runtime_error);
+    BOOST_CHECK_THROW(failing.run(exec_thread).get(), std::runtime_error);
+    BOOST_CHECK_EQUAL(after_error.load(), 0);
+
+    // an executor refusing the submissions fails the run instead of leaving it running
+    struct refusing_executor {
+        void execute(std::function<void()>) { throw std::runtime_error("executor shutdown"); }
+    } refusing;
+
+    hadoken::task_graph refused;
+    const auto refused_first = refused.emplace([&]() { after_error += 1; });
+    refused.precede(refused_first, refused.emplace([&]() { after_error += 1; }));
+    refused.emplace([&]() { after_error += 1; });
+
+    auto refused_res = refused.run(refusing);
+    BOOST_CHECK(refused_res.is_ready());
+    BOOST_CHECK_THROW(refused_res.get(), std::runtime_error);
+    BOOST_CHECK_EQUAL(after_error.load(), 0);
+    refused.run(exec_thread).get();
+    BOOST_CHECK_EQUAL(after_error.load(), 3);
+
+    // cycles are rejected
+    failing.precede(second, first);
+    BOOST_CHECK_THROW(failing.run(exec_thread), std::invalid_argument);
+
+    hadoken::task_graph empty_graph;
+    empty_graph.run(exec_thread).get();
+}
+
+
 BOOST_AUTO_TEST_CASE(multiplexer_test) {
     const std::size_t iterations = 256;
 
@@ -256,6 +1209,10 @@ BOOST_AUTO_TEST_CASE(multiplexer_test) {
             });
         }
 
+        exec_thread.wait();
+
+        BOOST_CHECK_EQUAL(res.size(), iterations);
+
         for(auto & f : res){
             BOOST_CHECK_THROW({
             int v = f.get();
@@ -334,3 +1291,69 @@ BOOST_AUTO_TEST_CASE(latch_test) {
         BOOST_CHECK_EQUAL(l2.is_ready(), true);
     }
 }
+
+
+
+BOOST_AUTO_TEST_CASE(eventcount_test) {
+    hadoken::thread::eventcount event;
+
+    // notify without waiter does nothing
+    event.notify_one();
+    event.notify_all();
+
+    // notified between prepare_wait and wait: does not block
+    {
+        auto key = event.prepare_wait();
+        event.notify_one();
+        event.wait(key);
+    }
+
+    // producer / consumers
+    const std::size_t n_items = 1000, n_consumers = 4;
+    std::atomic<std::size_t> available(0), consumed(0);
+    std::atomic<bool> stop(false);
+
+    std::vector<std::thread> consumers;
+    for (std::size_t i = 0; i < n_consumers; ++i) {
+        consumers.emplace_back([&]() {
+            while (1) {
+                std::size_t v = available.load();
+                if (v > 0) {
+                    if (available.compare_exchange_weak(v, v - 1)) {
+                        consumed += 1;
+                    }
+                    continue;
+                }
+
+                if (stop.load()) {
+                    return;
+                }
+
+                auto key = event.prepare_wait();
+                if (available.load() > 0 || stop.load()) {
+                    event.cancel_wait();
+                } else {
+                    event.wait(key);
+                }
+            }
+        });
+    }
+
+    for (std::size_t i = 0; i < n_items; ++i) {
+        available += 1;
+        event.notify_one();
+    }
+
+    while (consumed.load() < n_items) {
+        std::this_thread::yield();
+    }
+
+    stop.store(true);
+    event.notify_all();
+
+    for (auto& t : consumers) {
+        t.join();
+    }
+
+    BOOST_CHECK_EQUAL(consumed.load(), n_items);
+}